@@ -0,0 +1,187 @@
+////////////////////////////////////////////////////////////
+//
+// SFML - Simple and Fast Multimedia Library
+// Copyright (C) 2007-2018 Laurent Gomila (laurent@sfml-dev.org)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef SFML_FLATHASHMAP_HPP
+#define SFML_FLATHASHMAP_HPP
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include <SFML/Config.hpp>
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+
+namespace sf
+{
+namespace priv
+{
+////////////////////////////////////////////////////////////
+/// \brief Open addressing hash map for integer keys
+///
+/// The keys live in a flat array that is probed linearly,
+/// so a lookup usually touches a single cache line. The
+/// values are stored separately and never move, references
+/// to them stay valid until the map is cleared.
+/// Elements can't be erased one by one.
+///
+////////////////////////////////////////////////////////////
+template <typename Key, typename Value>
+class FlatHashMap
+{
+public:
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Default constructor, creates an empty map
+    ///
+    ////////////////////////////////////////////////////////////
+    FlatHashMap();
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Find the value of a key
+    ///
+    /// \param key Key to search for
+    ///
+    /// \return Pointer to the value, or NULL if the key isn't in the map
+    ///
+    ////////////////////////////////////////////////////////////
+    Value* find(Key key);
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Find the value of a key
+    ///
+    /// \param key Key to search for
+    ///
+    /// \return Pointer to the value, or NULL if the key isn't in the map
+    ///
+    ////////////////////////////////////////////////////////////
+    const Value* find(Key key) const;
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Insert a value if the key isn't in the map yet
+    ///
+    /// \param key   Key of the value
+    /// \param value Value to insert
+    ///
+    /// \return Reference to the value stored for the key
+    ///
+    ////////////////////////////////////////////////////////////
+    Value& insert(Key key, const Value& value);
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the value of a key, inserting a default one if needed
+    ///
+    /// \param key Key of the value
+    ///
+    /// \return Reference to the value stored for the key
+    ///
+    ////////////////////////////////////////////////////////////
+    Value& operator [](Key key);
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Make room for a number of elements
+    ///
+    /// \param count Number of elements the map should hold without growing
+    ///
+    ////////////////////////////////////////////////////////////
+    void reserve(std::size_t count);
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the number of elements
+    ///
+    /// \return Number of elements in the map
+    ///
+    ////////////////////////////////////////////////////////////
+    std::size_t size() const;
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Remove all the elements
+    ///
+    ////////////////////////////////////////////////////////////
+    void clear();
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Swap the contents with another map
+    ///
+    /// \param right Map to swap with
+    ///
+    ////////////////////////////////////////////////////////////
+    void swap(FlatHashMap& right);
+
+private:
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Entry of the probing array
+    ///
+    ////////////////////////////////////////////////////////////
+    struct Slot
+    {
+        Key    key;   ///< Key of the element
+        Uint32 index; ///< Index of the value + 1, 0 if the slot is empty
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Find the slot of a key, or the empty slot where it would go
+    ///
+    /// \param key Key to search for
+    ///
+    /// \return Index of the slot
+    ///
+    ////////////////////////////////////////////////////////////
+    std::size_t findSlot(Key key) const;
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Find the slot of a key to insert, growing the probing array if needed
+    ///
+    /// \param key Key to insert
+    ///
+    /// \return The slot of the key, or the empty slot where it goes
+    ///
+    ////////////////////////////////////////////////////////////
+    Slot& insertSlot(Key key);
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Rebuild the probing array with a new size
+    ///
+    /// \param slotCount New number of slots, a power of two
+    ///
+    ////////////////////////////////////////////////////////////
+    void rehash(std::size_t slotCount);
+
+    ////////////////////////////////////////////////////////////
+    // Member data
+    ////////////////////////////////////////////////////////////
+    std::vector<Slot> m_slots;  ///< Probing array, its size is a power of two (or zero)
+    std::deque<Value> m_values; ///< Values in insertion order, a deque never moves them
+};
+
+#include <SFML/Graphics/FlatHashMap.inl>
+
+} // namespace priv
+
+} // namespace sf
+
+
+#endif // SFML_FLATHASHMAP_HPP
@@ -0,0 +1,197 @@
+////////////////////////////////////////////////////////////
+//
+// SFML - Simple and Fast Multimedia Library
+// Copyright (C) 2007-2018 Laurent Gomila (laurent@sfml-dev.org)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+
+
+////////////////////////////////////////////////////////////
+/// \brief Scramble an integer key so that neighboring keys spread over the table
+///
+////////////////////////////////////////////////////////////
+inline std::size_t hashKey(Uint64 key)
+{
+    Uint32 hash = static_cast<Uint32>(key) ^ (static_cast<Uint32>(key >> 32) * 0x9E3779B1u);
+
+    // MurmurHash3 finalizer
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6Bu;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35u;
+    hash ^= hash >> 16;
+
+    return hash;
+}
+
+
+////////////////////////////////////////////////////////////
+template <typename Key, typename Value>
+FlatHashMap<Key, Value>::FlatHashMap() :
+m_slots (),
+m_values()
+{
+
+}
+
+
+////////////////////////////////////////////////////////////
+template <typename Key, typename Value>
+Value* FlatHashMap<Key, Value>::find(Key key)
+{
+    if (m_slots.empty())
+        return NULL;
+
+    const Slot& slot = m_slots[findSlot(key)];
+    return slot.index ? &m_values[slot.index - 1] : NULL;
+}
+
+
+////////////////////////////////////////////////////////////
+template <typename Key, typename Value>
+const Value* FlatHashMap<Key, Value>::find(Key key) const
+{
+    if (m_slots.empty())
+        return NULL;
+
+    const Slot& slot = m_slots[findSlot(key)];
+    return slot.index ? &m_values[slot.index - 1] : NULL;
+}
+
+
+////////////////////////////////////////////////////////////
+template <typename Key, typename Value>
+Value& FlatHashMap<Key, Value>::insert(Key key, const Value& value)
+{
+    Slot& slot = insertSlot(key);
+    if (!slot.index)
+    {
+        m_values.push_back(value);
+        slot.key = key;
+        slot.index = static_cast<Uint32>(m_values.size());
+    }
+
+    return m_values[slot.index - 1];
+}
+
+
+////////////////////////////////////////////////////////////
+template <typename Key, typename Value>
+Value& FlatHashMap<Key, Value>::operator [](Key key)
+{
+    if (Value* value = find(key))
+        return *value;
+
+    // The value is default constructed in place rather than copied from a temporary,
+    // values like font pages hold a texture which is expensive to copy
+    Slot& slot = insertSlot(key);
+    m_values.resize(m_values.size() + 1);
+    slot.key = key;
+    slot.index = static_cast<Uint32>(m_values.size());
+
+    return m_values.back();
+}
+
+
+////////////////////////////////////////////////////////////
+template <typename Key, typename Value>
+void FlatHashMap<Key, Value>::reserve(std::size_t count)
+{
+    std::size_t slotCount = m_slots.empty() ? 16 : m_slots.size();
+    while (count * 2 > slotCount)
+        slotCount *= 2;
+
+    if (slotCount != m_slots.size())
+        rehash(slotCount);
+}
+
+
+////////////////////////////////////////////////////////////
+template <typename Key, typename Value>
+std::size_t FlatHashMap<Key, Value>::size() const
+{
+    return m_values.size();
+}
+
+
+////////////////////////////////////////////////////////////
+template <typename Key, typename Value>
+void FlatHashMap<Key, Value>::clear()
+{
+    m_slots.clear();
+    m_values.clear();
+}
+
+
+////////////////////////////////////////////////////////////
+template <typename Key, typename Value>
+void FlatHashMap<Key, Value>::swap(FlatHashMap& right)
+{
+    m_slots.swap(right.m_slots);
+    m_values.swap(right.m_values);
+}
+
+
+////////////////////////////////////////////////////////////
+template <typename Key, typename Value>
+std::size_t FlatHashMap<Key, Value>::findSlot(Key key) const
+{
+    const std::size_t mask = m_slots.size() - 1;
+
+    // There is always at least one empty slot, so this terminates
+    std::size_t index = hashKey(static_cast<Uint64>(key)) & mask;
+    while (m_slots[index].index && (m_slots[index].key != key))
+        index = (index + 1) & mask;
+
+    return index;
+}
+
+
+////////////////////////////////////////////////////////////
+template <typename Key, typename Value>
+typename FlatHashMap<Key, Value>::Slot& FlatHashMap<Key, Value>::insertSlot(Key key)
+{
+    // Keep the load factor at or below 1/2, so that the probe sequences stay short
+    if ((m_values.size() + 1) * 2 > m_slots.size())
+        rehash(m_slots.empty() ? 16 : m_slots.size() * 2);
+
+    return m_slots[findSlot(key)];
+}
+
+
+////////////////////////////////////////////////////////////
+template <typename Key, typename Value>
+void FlatHashMap<Key, Value>::rehash(std::size_t slotCount)
+{
+    Slot empty;
+    empty.key = Key();
+    empty.index = 0;
+
+    std::vector<Slot> slots(slotCount, empty);
+    m_slots.swap(slots);
+
+    // Reinsert the old slots, the values themselves stay where they are
+    for (std::size_t i = 0; i < slots.size(); ++i)
+    {
+        if (slots[i].index)
+            m_slots[findSlot(slots[i].key)] = slots[i];
+    }
+}
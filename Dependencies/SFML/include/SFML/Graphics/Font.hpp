@@ -29,12 +29,13 @@
 // Headers
 ////////////////////////////////////////////////////////////
 #include <SFML/Graphics/Export.hpp>
+#include <SFML/Graphics/FlatHashMap.hpp>
 #include <SFML/Graphics/Glyph.hpp>
 #include <SFML/Graphics/Texture.hpp>
 #include <SFML/Graphics/Rect.hpp>
 #include <SFML/System/Vector2.hpp>
 #include <SFML/System/String.hpp>
-#include <map>
+#include <deque>
 #include <string>
 #include <vector>
 
@@ -179,6 +180,35 @@ public:
     ////////////////////////////////////////////////////////////
     const Glyph& getGlyph(Uint32 codePoint, unsigned int characterSize, bool bold, float outlineThickness = 0) const;
 
+    ////////////////////////////////////////////////////////////
+    /// \brief Load a whole range of glyphs in advance
+    ///
+    /// getGlyph loads glyphs lazily, so the first frame that
+    /// displays new characters pays for rasterizing them. This
+    /// function rasterizes all the code points of a range up
+    /// front, for example at start-up or on a loading screen.
+    /// Code points that the font doesn't contain are skipped.
+    ///
+    /// Large ranges of a font loaded from a file or from memory
+    /// are rasterized by several threads, each with its own
+    /// FreeType face, and the new glyphs are written to the
+    /// textures in one go. Fonts loaded from a stream are
+    /// rasterized by the calling thread only, as a stream can't
+    /// be read concurrently.
+    ///
+    /// \param first            First code point of the range
+    /// \param last             Last code point of the range (included)
+    /// \param characterSize    Reference character size
+    /// \param bold             Load the bold versions or the regular ones?
+    /// \param outlineThickness Thickness of outline (when != 0 the glyphs will not be filled)
+    ///
+    /// \return Number of glyphs of the range that the font contains
+    ///
+    /// \see getGlyph
+    ///
+    ////////////////////////////////////////////////////////////
+    std::size_t preloadGlyphs(Uint32 first, Uint32 last, unsigned int characterSize, bool bold = false, float outlineThickness = 0) const;
+
     ////////////////////////////////////////////////////////////
     /// \brief Get the kerning offset of two glyphs
     ///
@@ -246,6 +276,9 @@ public:
     /// are requested, thus it is not very relevant. It is mainly
     /// used internally by sf::Text.
     ///
+    /// This is the first texture of the size, see getTextureCount
+    /// for fonts with more glyphs than fit into one texture.
+    ///
     /// \param characterSize Reference character size
     ///
     /// \return Texture containing the glyphs of the requested size
@@ -253,6 +286,34 @@ public:
     ////////////////////////////////////////////////////////////
     const Texture& getTexture(unsigned int characterSize) const;
 
+    ////////////////////////////////////////////////////////////
+    /// \brief Retrieve one of the textures containing the loaded glyphs of a certain size
+    ///
+    /// When the texture of a size is full, the glyphs that don't
+    /// fit anymore go to an additional texture instead of
+    /// growing the existing one. Glyph::textureIndex tells
+    /// which texture contains a glyph.
+    ///
+    /// \param characterSize Reference character size
+    /// \param index         Index of the texture, the first one is returned if it is out of range
+    ///
+    /// \return Texture containing glyphs of the requested size
+    ///
+    /// \see getTextureCount
+    ///
+    ////////////////////////////////////////////////////////////
+    const Texture& getTexture(unsigned int characterSize, unsigned int index) const;
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the number of textures used by the glyphs of a certain size
+    ///
+    /// \param characterSize Reference character size
+    ///
+    /// \return Number of textures, at least 1
+    ///
+    ////////////////////////////////////////////////////////////
+    unsigned int getTextureCount(unsigned int characterSize) const;
+
     ////////////////////////////////////////////////////////////
     /// \brief Overload of assignment operator
     ///
@@ -266,22 +327,30 @@ public:
 private:
 
     ////////////////////////////////////////////////////////////
-    /// \brief Structure defining a row of glyphs
+    /// \brief Horizontal segment of the skyline of a texture
+    ///
+    /// The skyline is the upper edge of the area used by the
+    /// glyphs so far, new glyphs are placed on top of it.
     ///
     ////////////////////////////////////////////////////////////
-    struct Row
+    struct SkylineNode
     {
-        Row(unsigned int rowTop, unsigned int rowHeight) : width(0), top(rowTop), height(rowHeight) {}
+        SkylineNode(unsigned int nodeX, unsigned int nodeY, unsigned int nodeWidth) : x(nodeX), y(nodeY), width(nodeWidth) {}
 
-        unsigned int width;  ///< Current width of the row
-        unsigned int top;    ///< Y position of the row into the texture
-        unsigned int height; ///< Height of the row
+        unsigned int x;     ///< Left end of the segment
+        unsigned int y;     ///< Height of the used area over the segment
+        unsigned int width; ///< Width of the segment
     };
 
     ////////////////////////////////////////////////////////////
     // Types
     ////////////////////////////////////////////////////////////
-    typedef std::map<Uint64, Glyph> GlyphTable; ///< Table mapping a codepoint to its glyph
+    typedef std::vector<SkylineNode> Skyline; ///< Segments from left to right, covering the whole texture width
+
+    ////////////////////////////////////////////////////////////
+    // Types
+    ////////////////////////////////////////////////////////////
+    typedef priv::FlatHashMap<Uint64, Glyph> GlyphTable; ///< Table mapping a codepoint to its glyph
 
     ////////////////////////////////////////////////////////////
     /// \brief Structure defining a page of glyphs
@@ -291,10 +360,9 @@ private:
     {
         Page();
 
-        GlyphTable       glyphs;  ///< Table mapping code points to their corresponding glyph
-        Texture          texture; ///< Texture containing the pixels of the glyphs
-        unsigned int     nextRow; ///< Y position of the next new row in the texture
-        std::vector<Row> rows;    ///< List containing the position of all the existing rows
+        GlyphTable           glyphs;    ///< Table mapping code points to their corresponding glyph
+        std::deque<Texture>  textures;  ///< Textures containing the pixels of the glyphs, a deque never moves them
+        std::vector<Skyline> skylines;  ///< Skyline of each texture
     };
 
     ////////////////////////////////////////////////////////////
@@ -317,16 +385,30 @@ private:
     Glyph loadGlyph(Uint32 codePoint, unsigned int characterSize, bool bold, float outlineThickness) const;
 
     ////////////////////////////////////////////////////////////
-    /// \brief Find a suitable rectangle within the texture for a glyph
+    /// \brief Reserve the texture area of a rasterized glyph
+    ///
+    /// \param page   Page of glyphs to place the glyph in
+    /// \param glyph  Glyph whose texture rectangle and index are set
+    /// \param width  Width of the glyph's pixels, padding included
+    /// \param height Height of the glyph's pixels, padding included
+    ///
+    /// \return Rectangle of the texture the pixels must be written to
+    ///
+    ////////////////////////////////////////////////////////////
+    IntRect placeGlyph(Page& page, Glyph& glyph, unsigned int width, unsigned int height) const;
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Find a suitable rectangle within the textures for a glyph
     ///
-    /// \param page   Page of glyphs to search in
-    /// \param width  Width of the rectangle
-    /// \param height Height of the rectangle
+    /// \param page         Page of glyphs to search in
+    /// \param width        Width of the rectangle
+    /// \param height       Height of the rectangle
+    /// \param textureIndex Receives the index of the texture that contains the rectangle
     ///
     /// \return Found rectangle within the texture
     ///
     ////////////////////////////////////////////////////////////
-    IntRect findGlyphRect(Page& page, unsigned int width, unsigned int height) const;
+    IntRect findGlyphRect(Page& page, unsigned int width, unsigned int height, unsigned int& textureIndex) const;
 
     ////////////////////////////////////////////////////////////
     /// \brief Make sure that the given size is the current one
@@ -341,7 +423,7 @@ private:
     ////////////////////////////////////////////////////////////
     // Types
     ////////////////////////////////////////////////////////////
-    typedef std::map<unsigned int, Page> PageTable; ///< Table mapping a character size to its page (texture)
+    typedef priv::FlatHashMap<unsigned int, Page> PageTable; ///< Table mapping a character size to its page (texture)
 
     ////////////////////////////////////////////////////////////
     // Member data
@@ -354,6 +436,9 @@ private:
     Info                       m_info;        ///< Information about the font
     mutable PageTable          m_pages;       ///< Table containing the glyphs pages by character size
     mutable std::vector<Uint8> m_pixelBuffer; ///< Pixel buffer holding a glyph's pixels before being written to the texture
+    std::string                m_sourceFile;  ///< File the font was loaded from, if any (worker threads open their own face from it)
+    const void*                m_sourceData;  ///< Memory the font was loaded from, if any
+    std::size_t                m_sourceSize;  ///< Size of the memory the font was loaded from
     #ifdef SFML_SYSTEM_ANDROID
     void*                      m_stream; ///< Asset file streamer (if loaded from file)
     #endif
@@ -46,14 +46,15 @@ public:
     /// \brief Default constructor
     ///
     ////////////////////////////////////////////////////////////
-    Glyph() : advance(0) {}
+    Glyph() : advance(0), textureIndex(0) {}
 
     ////////////////////////////////////////////////////////////
     // Member data
     ////////////////////////////////////////////////////////////
-    float     advance;     ///< Offset to move horizontally to the next character
-    FloatRect bounds;      ///< Bounding rectangle of the glyph, in coordinates relative to the baseline
-    IntRect   textureRect; ///< Texture coordinates of the glyph inside the font's texture
+    float        advance;      ///< Offset to move horizontally to the next character
+    FloatRect    bounds;       ///< Bounding rectangle of the glyph, in coordinates relative to the baseline
+    IntRect      textureRect;  ///< Texture coordinates of the glyph inside the font's texture
+    unsigned int textureIndex; ///< Index of the font's texture that contains the glyph (see Font::getTexture)
 };
 
 } // namespace sf
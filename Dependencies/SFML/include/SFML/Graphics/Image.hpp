@@ -29,6 +29,7 @@
 // Headers
 ////////////////////////////////////////////////////////////
 #include <SFML/Graphics/Export.hpp>
+#include <SFML/Graphics/BlendMode.hpp>
 #include <SFML/Graphics/Color.hpp>
 #include <SFML/Graphics/Rect.hpp>
 #include <string>
@@ -39,6 +40,11 @@ namespace sf
 {
 class InputStream;
 
+namespace priv
+{
+    class LoadedPixels;
+}
+
 ////////////////////////////////////////////////////////////
 /// \brief Class for loading, manipulating and saving images
 ///
@@ -47,6 +53,17 @@ class SFML_GRAPHICS_API Image
 {
 public:
 
+    ////////////////////////////////////////////////////////////
+    /// \brief Filters available to resize an image
+    ///
+    ////////////////////////////////////////////////////////////
+    enum ResizeFilter
+    {
+        Box,      ///< Average of the covered pixels, nearest pixel when enlarging
+        Bilinear, ///< Linear interpolation between neighbour pixels
+        Lanczos   ///< Windowed sinc over 3 pixels on each side, sharpest but slowest
+    };
+
     ////////////////////////////////////////////////////////////
     /// \brief Default constructor
     ///
@@ -55,12 +72,30 @@ public:
     ////////////////////////////////////////////////////////////
     Image();
 
+    ////////////////////////////////////////////////////////////
+    /// \brief Copy constructor
+    ///
+    /// \param copy instance to copy
+    ///
+    ////////////////////////////////////////////////////////////
+    Image(const Image& copy);
+
     ////////////////////////////////////////////////////////////
     /// \brief Destructor
     ///
     ////////////////////////////////////////////////////////////
     ~Image();
 
+    ////////////////////////////////////////////////////////////
+    /// \brief Overload of assignment operator
+    ///
+    /// \param right Instance to assign
+    ///
+    /// \return Reference to self
+    ///
+    ////////////////////////////////////////////////////////////
+    Image& operator =(const Image& right);
+
     ////////////////////////////////////////////////////////////
     /// \brief Create the image and fill it with a unique color
     ///
@@ -90,10 +125,20 @@ public:
     /// \brief Load the image from a file on disk
     ///
     /// The supported image formats are bmp, png, tga, jpg, gif,
-    /// psd, hdr and pic. Some format options are not supported,
-    /// like progressive jpeg.
+    /// psd, hdr, pic and pam. The file is mapped into memory
+    /// rather than read. A pam file with 8-bit RGBA pixels
+    /// (TUPLTYPE RGB_ALPHA) isn't decoded at all, the image
+    /// uses its pixels straight from the mapping and only the
+    /// parts that get modified are copied. Some format options
+    /// are not supported, like progressive jpeg.
     /// If this function fails, the image is left unchanged.
     ///
+    /// \warning The file must not be truncated or rewritten as
+    /// long as the image uses the mapping: reading pixels that
+    /// are no longer in the file raises SIGBUS, which ends the
+    /// program. Copying the image, or calling create on it,
+    /// makes it independent from the file.
+    ///
     /// \param filename Path of the image file to load
     ///
     /// \return True if loading was successful
@@ -107,7 +152,8 @@ public:
     /// \brief Load the image from a file in memory
     ///
     /// The supported image formats are bmp, png, tga, jpg, gif,
-    /// psd, hdr and pic. Some format options are not supported,
+    /// psd, hdr, pic and pam (8-bit RGBA only, its pixels are
+    /// copied as they are). Some format options are not supported,
     /// like progressive jpeg.
     /// If this function fails, the image is left unchanged.
     ///
@@ -125,7 +171,8 @@ public:
     /// \brief Load the image from a custom stream
     ///
     /// The supported image formats are bmp, png, tga, jpg, gif,
-    /// psd, hdr and pic. Some format options are not supported,
+    /// psd, hdr, pic and pam (8-bit RGBA only, its pixels are
+    /// read as they are). Some format options are not supported,
     /// like progressive jpeg.
     /// If this function fails, the image is left unchanged.
     ///
@@ -143,7 +190,7 @@ public:
     ///
     /// The format of the image is automatically deduced from
     /// the extension. The supported image formats are bmp, png,
-    /// tga and jpg. The destination file is overwritten
+    /// tga, jpg and pam. The destination file is overwritten
     /// if it already exists. This function fails if the image is empty.
     ///
     /// \param filename Path of the file to save
@@ -198,6 +245,81 @@ public:
     ////////////////////////////////////////////////////////////
     void copy(const Image& source, unsigned int destX, unsigned int destY, const IntRect& sourceRect = IntRect(0, 0, 0, 0), bool applyAlpha = false);
 
+    ////////////////////////////////////////////////////////////
+    /// \brief Blend pixels from another image onto this one
+    ///
+    /// The pixels are combined like sf::RenderTarget combines
+    /// them with \a blendMode, with 8-bit integer math:
+    /// each component is (src * srcFactor + dst * dstFactor) / 255
+    /// rounded down and clamped (or the difference, depending on
+    /// the equation). copy with \a applyAlpha set to true is the
+    /// same as copy with sf::BlendAlpha.
+    ///
+    /// If \a sourceRect is empty, the whole image is copied.
+    ///
+    /// \param source     Source image to copy
+    /// \param destX      X coordinate of the destination position
+    /// \param destY      Y coordinate of the destination position
+    /// \param sourceRect Sub-rectangle of the source image to copy
+    /// \param blendMode  Blending mode that combines the source and destination pixels
+    ///
+    ////////////////////////////////////////////////////////////
+    void copy(const Image& source, unsigned int destX, unsigned int destY, const IntRect& sourceRect, const BlendMode& blendMode);
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Copy pixels from another image, except the ones of a color-key
+    ///
+    /// The source pixels that are exactly \a colorKey (alpha
+    /// included) leave the destination pixels unchanged, the
+    /// others are copied unchanged.
+    ///
+    /// If \a sourceRect is empty, the whole image is copied.
+    ///
+    /// \param source     Source image to copy
+    /// \param destX      X coordinate of the destination position
+    /// \param destY      Y coordinate of the destination position
+    /// \param colorKey   Color of the source pixels that are not copied
+    /// \param sourceRect Sub-rectangle of the source image to copy
+    ///
+    /// \see createMaskFromColor
+    ///
+    ////////////////////////////////////////////////////////////
+    void copy(const Image& source, unsigned int destX, unsigned int destY, const Color& colorKey, const IntRect& sourceRect = IntRect(0, 0, 0, 0));
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Set all the pixels of a rectangle to a color
+    ///
+    /// The rectangle is clipped to the image.
+    ///
+    /// \param rectangle Area of the image to fill
+    /// \param color     Color to fill it with
+    ///
+    ////////////////////////////////////////////////////////////
+    void fillRect(const IntRect& rectangle, const Color& color);
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Multiply the color of every pixel by its alpha
+    ///
+    /// Each color component becomes round(component * alpha / 255).
+    ///
+    /// \see unpremultiplyAlpha
+    ///
+    ////////////////////////////////////////////////////////////
+    void premultiplyAlpha();
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Divide the color of every pixel by its alpha
+    ///
+    /// Each color component becomes round(component * 255 / alpha),
+    /// at most 255. Fully transparent pixels are left unchanged.
+    /// Premultiplying loses precision, so this doesn't restore
+    /// the exact colors of translucent pixels.
+    ///
+    /// \see premultiplyAlpha
+    ///
+    ////////////////////////////////////////////////////////////
+    void unpremultiplyAlpha();
+
     ////////////////////////////////////////////////////////////
     /// \brief Change the color of a pixel
     ///
@@ -258,13 +380,74 @@ public:
     ////////////////////////////////////////////////////////////
     void flipVertically();
 
+    ////////////////////////////////////////////////////////////
+    /// \brief Resample the image to a new size
+    ///
+    /// The image is filtered horizontally then vertically, with
+    /// colors weighted by their alpha so that transparent pixels
+    /// don't bleed into their neighbours. When shrinking, the
+    /// filter covers all the source pixels that fall into each
+    /// target pixel. Large images are processed by several
+    /// threads. Nothing happens if the image is empty or if
+    /// one of the new dimensions is 0.
+    ///
+    /// \param width  New width of the image
+    /// \param height New height of the image
+    /// \param filter Filter to use
+    ///
+    /// \see generateMipmaps
+    ///
+    ////////////////////////////////////////////////////////////
+    void resize(unsigned int width, unsigned int height, ResizeFilter filter = Bilinear);
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Build the mipmap chain of the image
+    ///
+    /// Each level is half the size of the previous one (rounded
+    /// down, at least 1 pixel), down to 1x1. The first level
+    /// stored in \a levels is half the size of this image, which
+    /// itself is left unchanged. Each level is resized from the
+    /// one before it, see resize.
+    ///
+    /// \param levels Vector to fill with the levels
+    /// \param filter Filter to use
+    ///
+    ////////////////////////////////////////////////////////////
+    void generateMipmaps(std::vector<Image>& levels, ResizeFilter filter = Box) const;
+
 private:
 
+    ////////////////////////////////////////////////////////////
+    /// \brief Get a pointer to the pixels, wherever they are stored
+    ///
+    /// \return Pointer to the first pixel, or null if the image is empty
+    ///
+    ////////////////////////////////////////////////////////////
+    Uint8* getPixelData();
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get a read-only pointer to the pixels, wherever they are stored
+    ///
+    /// \return Pointer to the first pixel, or null if the image is empty
+    ///
+    ////////////////////////////////////////////////////////////
+    const Uint8* getPixelData() const;
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Replace the pixels by loaded ones
+    ///
+    /// \param pixels Loaded pixels, or null to use m_pixels again
+    /// \param size   Size of the loaded image
+    ///
+    ////////////////////////////////////////////////////////////
+    void setLoadedPixels(priv::LoadedPixels* pixels, const Vector2u& size);
+
     ////////////////////////////////////////////////////////////
     // Member data
     ////////////////////////////////////////////////////////////
-    Vector2u           m_size;   ///< Image size
-    std::vector<Uint8> m_pixels; ///< Pixels of the image
+    Vector2u            m_size;         ///< Image size
+    std::vector<Uint8>  m_pixels;       ///< Pixels of the image, unless it uses loaded pixels
+    priv::LoadedPixels* m_loadedPixels; ///< Pixels the image was loaded into, used in place (may be null)
 };
 
 } // namespace sf
@@ -38,6 +38,7 @@
 #include <SFML/Graphics/PrimitiveType.hpp>
 #include <SFML/Graphics/Vertex.hpp>
 #include <SFML/System/NonCopyable.hpp>
+#include <vector>
 
 
 namespace sf
@@ -53,6 +54,33 @@ class SFML_GRAPHICS_API RenderTarget : NonCopyable
 {
 public:
 
+    ////////////////////////////////////////////////////////////
+    /// \brief Counters of the work a render target submitted to OpenGL
+    ///
+    /// The counters accumulate until resetStatistics is called,
+    /// usually once per frame.
+    ///
+    ////////////////////////////////////////////////////////////
+    struct Statistics
+    {
+        ////////////////////////////////////////////////////////////
+        /// \brief Default constructor, all counters are zero
+        ///
+        ////////////////////////////////////////////////////////////
+        Statistics();
+
+        Uint64 drawCalls;         ///< glDrawArrays calls
+        Uint64 vertices;          ///< Vertices passed to glDrawArrays
+        Uint64 vertexCacheDraws;  ///< Vertex array draws that were pre-transformed into the vertex cache
+        Uint64 directDraws;       ///< Vertex array draws that used the vertices and the transform as they are
+        Uint64 batchedDraws;      ///< Draws that were merged into a batch instead of being drawn right away
+        Uint64 textureBinds;      ///< Texture bindings, including unbinding
+        Uint64 shaderSwitches;    ///< Shader bindings, including unbinding
+        Uint64 blendModeChanges;  ///< Blend mode changes
+        Uint64 matrixUploads;     ///< glLoadMatrixf calls for the view and the transform
+        Uint64 contextSwitches;   ///< Times the target was activated or deactivated in a context
+    };
+
     ////////////////////////////////////////////////////////////
     /// \brief Destructor
     ///
@@ -366,6 +394,95 @@ public:
     ////////////////////////////////////////////////////////////
     void resetGLStates();
 
+    ////////////////////////////////////////////////////////////
+    /// \brief Enable or disable automatic draw call batching
+    ///
+    /// When batching is enabled, consecutive draws of vertex
+    /// arrays that use the same texture and blend mode and no
+    /// shader are not sent to OpenGL right away. Their vertices
+    /// are transformed on the CPU and appended to a single
+    /// vertex stream, which is drawn with one call when the
+    /// states change, when something else is drawn or the view
+    /// changes, and at the latest in display().
+    ///
+    /// Strips, fans and quads are converted to independent
+    /// triangles (line strips to lines) so that they can be
+    /// merged with each other. Draws of more than 1024 vertices
+    /// and vertex buffers are never batched, they flush the
+    /// pending draws and are drawn right away.
+    ///
+    /// Because the draws are deferred, textures used by pending
+    /// draws must stay alive and unchanged until the batch is
+    /// flushed. Call flush() before updating such a texture or
+    /// before issuing your own OpenGL commands.
+    ///
+    /// Batching is disabled by default. Disabling it flushes
+    /// the pending draws.
+    ///
+    /// \param enabled True to enable batching, false to disable it
+    ///
+    /// \see isBatchingEnabled, flush
+    ///
+    ////////////////////////////////////////////////////////////
+    void setBatchingEnabled(bool enabled);
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Tell whether automatic draw call batching is enabled
+    ///
+    /// \return True if batching is enabled
+    ///
+    /// \see setBatchingEnabled
+    ///
+    ////////////////////////////////////////////////////////////
+    bool isBatchingEnabled() const;
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Draw the pending batched vertices
+    ///
+    /// This function does nothing if batching is disabled or
+    /// if nothing is pending. It is called automatically
+    /// whenever the batch can't be extended and in display().
+    ///
+    /// \see setBatchingEnabled
+    ///
+    ////////////////////////////////////////////////////////////
+    void flush();
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the counters accumulated since the last reset
+    ///
+    /// \return Statistics of the render target
+    ///
+    /// \see resetStatistics
+    ///
+    ////////////////////////////////////////////////////////////
+    const Statistics& getStatistics() const;
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Reset all the statistics counters to zero
+    ///
+    /// Call this once per frame (after display) to get per
+    /// frame counters. If logging is enabled, the counters
+    /// are written to sf::err() before they are reset.
+    ///
+    /// \see getStatistics, setStatisticsLogging
+    ///
+    ////////////////////////////////////////////////////////////
+    void resetStatistics();
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Enable or disable logging of the statistics
+    ///
+    /// When enabled, resetStatistics writes one line with all
+    /// the counters to sf::err(). Logging is disabled by default.
+    ///
+    /// \param enabled True to enable logging, false to disable it
+    ///
+    /// \see resetStatistics
+    ///
+    ////////////////////////////////////////////////////////////
+    void setStatisticsLogging(bool enabled);
+
 protected:
 
     ////////////////////////////////////////////////////////////
@@ -385,6 +502,32 @@ protected:
 
 private:
 
+    ////////////////////////////////////////////////////////////
+    /// \brief Draw primitives defined by an array of vertices right away
+    ///
+    /// \param vertices    Pointer to the vertices
+    /// \param vertexCount Number of vertices in the array
+    /// \param type        Type of primitives to draw
+    /// \param states      Render states to use for drawing
+    ///
+    ////////////////////////////////////////////////////////////
+    void drawVertices(const Vertex* vertices, std::size_t vertexCount,
+                      PrimitiveType type, const RenderStates& states);
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Append primitives to the pending batch
+    ///
+    /// \param vertices    Pointer to the vertices
+    /// \param vertexCount Number of vertices in the array
+    /// \param type        Type of primitives to draw
+    /// \param states      Render states to use for drawing
+    ///
+    /// \return False if the primitives can't be batched
+    ///
+    ////////////////////////////////////////////////////////////
+    bool batchVertices(const Vertex* vertices, std::size_t vertexCount,
+                       PrimitiveType type, const RenderStates& states);
+
     ////////////////////////////////////////////////////////////
     /// \brief Apply the current view
     ///
@@ -475,6 +618,13 @@ private:
     View        m_view;        ///< Current view
     StatesCache m_cache;       ///< Render states cache
     Uint64      m_id;          ///< Unique number that identifies the RenderTarget
+    bool                m_batching;       ///< Is draw call batching enabled?
+    std::vector<Vertex> m_batch;          ///< Pending pre-transformed vertices
+    PrimitiveType       m_batchType;      ///< Primitive type of the pending vertices
+    const Texture*      m_batchTexture;   ///< Texture of the pending vertices
+    BlendMode           m_batchBlendMode; ///< Blend mode of the pending vertices
+    Statistics          m_statistics;     ///< Work submitted since the last reset
+    bool                m_logStatistics;  ///< Write the statistics to sf::err() when they are reset?
 };
 
 } // namespace sf
@@ -505,6 +655,15 @@ private:
 /// OpenGL states are not messed up by calling the
 /// pushGLStates/popGLStates functions.
 ///
+/// The amount of work a target submits to OpenGL (draw calls,
+/// state changes, ...) can be queried with getStatistics,
+/// for example to keep an eye on it from frame to frame:
+/// \code
+/// window.display();
+/// std::cout << window.getStatistics().drawCalls << " draw calls" << std::endl;
+/// window.resetStatistics();
+/// \endcode
+///
 /// \see sf::RenderWindow, sf::RenderTexture, sf::View
 ///
 ////////////////////////////////////////////////////////////
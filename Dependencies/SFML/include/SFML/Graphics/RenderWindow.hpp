@@ -130,6 +130,15 @@ public:
     ////////////////////////////////////////////////////////////
     bool setActive(bool active = true);
 
+    ////////////////////////////////////////////////////////////
+    /// \brief Display on screen what has been rendered to the window so far
+    ///
+    /// Same as Window::display, but draws the pending batched
+    /// vertices first (see RenderTarget::setBatchingEnabled).
+    ///
+    ////////////////////////////////////////////////////////////
+    void display();
+
     ////////////////////////////////////////////////////////////
     /// \brief Copy the current contents of the window to an image
     ///
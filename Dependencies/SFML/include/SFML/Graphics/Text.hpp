@@ -41,6 +41,11 @@
 
 namespace sf
 {
+namespace priv
+{
+    class TextLayoutCache;
+}
+
 ////////////////////////////////////////////////////////////
 /// \brief Graphical text that can be drawn to a render target
 ///
@@ -87,6 +92,20 @@ public:
     ////////////////////////////////////////////////////////////
     Text(const String& string, const Font& font, unsigned int characterSize = 30);
 
+    ////////////////////////////////////////////////////////////
+    /// \brief Copy constructor
+    ///
+    /// \param copy Instance to copy
+    ///
+    ////////////////////////////////////////////////////////////
+    Text(const Text& copy);
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Destructor
+    ///
+    ////////////////////////////////////////////////////////////
+    ~Text();
+
     ////////////////////////////////////////////////////////////
     /// \brief Set the text's string
     ///
@@ -412,8 +431,50 @@ public:
     ////////////////////////////////////////////////////////////
     FloatRect getGlobalBounds() const;
 
+    ////////////////////////////////////////////////////////////
+    /// \brief Overload of assignment operator
+    ///
+    /// \param right Instance to assign
+    ///
+    /// \return Reference to self
+    ///
+    ////////////////////////////////////////////////////////////
+    Text& operator =(const Text& right);
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Set the size of the layout cache shared by all texts
+    ///
+    /// Texts with the same string, font, character size, style,
+    /// spacing, outline and colors share a single geometry: the
+    /// first one lays it out and the others reference it instead
+    /// of looking up the glyphs and kerning again. This makes
+    /// many identical labels (unit names, map markers...) cost
+    /// one layout. The least recently used layouts are dropped
+    /// when the cache holds more vertices than \a vertexCount.
+    /// A size of 0 disables the cache. The default size is
+    /// 65536 vertices.
+    ///
+    /// \param vertexCount Maximum number of vertices in the cache
+    ///
+    /// \see getLayoutCacheSize
+    ///
+    ////////////////////////////////////////////////////////////
+    static void setLayoutCacheSize(std::size_t vertexCount);
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the size of the layout cache shared by all texts
+    ///
+    /// \return Maximum number of vertices in the cache
+    ///
+    /// \see setLayoutCacheSize
+    ///
+    ////////////////////////////////////////////////////////////
+    static std::size_t getLayoutCacheSize();
+
 private:
 
+    friend class priv::TextLayoutCache;
+
     ////////////////////////////////////////////////////////////
     /// \brief Draw the text to a render target
     ///
@@ -428,10 +489,65 @@ private:
     ///
     /// All the attributes related to rendering are cached, such
     /// that the geometry is only updated when necessary.
+    /// When only the end of the string changed, the layout
+    /// resumes after the characters that are still the same.
     ///
     ////////////////////////////////////////////////////////////
     void ensureGeometryUpdate() const;
 
+    ////////////////////////////////////////////////////////////
+    /// \brief Remember the layout state before a character
+    ///
+    /// \param index    Index of the character in the string
+    /// \param x        Horizontal pen position
+    /// \param y        Vertical pen position
+    /// \param minX     Left of the bounds so far
+    /// \param minY     Top of the bounds so far
+    /// \param maxX     Right of the bounds so far
+    /// \param maxY     Bottom of the bounds so far
+    /// \param prevChar Previous character, for kerning
+    ///
+    ////////////////////////////////////////////////////////////
+    void saveCheckpoint(std::size_t index, float x, float y, float minX, float minY, float maxX, float maxY, Uint32 prevChar) const;
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Consecutive vertices that use the same font texture
+    ///
+    /// A run ends where the next one starts (or at the end of
+    /// the vertex array).
+    ///
+    ////////////////////////////////////////////////////////////
+    struct TextureRun
+    {
+        TextureRun(std::size_t runFirst, unsigned int runTexture) : first(runFirst), texture(runTexture) {}
+
+        std::size_t  first;   ///< Index of the first vertex of the run
+        unsigned int texture; ///< Index of the font texture (see Font::getTexture)
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Layout state before a character of the string
+    ///
+    /// Changing the end of the string truncates the geometry to
+    /// the checkpoint of the first changed character and lays
+    /// out the rest from there.
+    ///
+    ////////////////////////////////////////////////////////////
+    struct LayoutCheckpoint
+    {
+        float       x;                  ///< Horizontal pen position
+        float       y;                  ///< Vertical pen position
+        float       minX;               ///< Left of the bounds so far
+        float       minY;               ///< Top of the bounds so far
+        float       maxX;               ///< Right of the bounds so far
+        float       maxY;               ///< Bottom of the bounds so far
+        Uint32      prevChar;           ///< Previous character, for kerning
+        std::size_t vertexCount;        ///< Number of fill vertices so far
+        std::size_t outlineVertexCount; ///< Number of outline vertices so far
+        std::size_t runCount;           ///< Number of fill texture runs so far
+        std::size_t outlineRunCount;    ///< Number of outline texture runs so far
+    };
+
     ////////////////////////////////////////////////////////////
     // Member data
     ////////////////////////////////////////////////////////////
@@ -446,9 +562,14 @@ private:
     float               m_outlineThickness;    ///< Thickness of the text's outline
     mutable VertexArray m_vertices;            ///< Vertex array containing the fill geometry
     mutable VertexArray m_outlineVertices;     ///< Vertex array containing the outline geometry
+    mutable std::vector<TextureRun> m_runs;        ///< Font textures used by the fill geometry
+    mutable std::vector<TextureRun> m_outlineRuns; ///< Font textures used by the outline geometry
     mutable FloatRect   m_bounds;              ///< Bounding rectangle of the text (in local coordinates)
     mutable bool        m_geometryNeedUpdate;  ///< Does the geometry need to be recomputed?
     mutable Uint64      m_fontTextureId;       ///< The font texture id
+    mutable std::vector<LayoutCheckpoint> m_checkpoints; ///< Layout state before each character, and after the last one
+    mutable std::size_t m_validLength;         ///< Number of leading characters whose geometry is still up to date
+    mutable const Text* m_sharedLayout;        ///< Cached text whose geometry is drawn instead of ours, if any (see setLayoutCacheSize)
 };
 
 } // namespace sf
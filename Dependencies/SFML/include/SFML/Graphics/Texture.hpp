@@ -277,6 +277,22 @@ public:
     ////////////////////////////////////////////////////////////
     void update(const Uint8* pixels, unsigned int width, unsigned int height, unsigned int x, unsigned int y);
 
+    ////////////////////////////////////////////////////////////
+    /// \brief Update several parts of the texture from arrays of pixels
+    ///
+    /// Same as calling update(pixels[i], rectangles[i].width,
+    /// rectangles[i].height, rectangles[i].left, rectangles[i].top)
+    /// for every part, but the texture is bound and OpenGL is
+    /// flushed only once. This is much faster for many small
+    /// updates, like adding glyphs to a font texture.
+    ///
+    /// \param pixels     Arrays of 32-bits RGBA pixels, one per part
+    /// \param rectangles Area of the texture each array is copied to
+    /// \param count      Number of parts
+    ///
+    ////////////////////////////////////////////////////////////
+    void update(const Uint8* const* pixels, const IntRect* rectangles, std::size_t count);
+
     ////////////////////////////////////////////////////////////
     /// \brief Update a part of this texture from another texture
     ///
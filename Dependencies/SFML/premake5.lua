@@ -16,7 +16,6 @@ project "SFML"
 
     removefiles {
         "examples/**",
-        "**/Unix/**",
         "**/OSX/**",
         "**/OpenBSD/**",
         "**/Android/**",
@@ -37,4 +36,16 @@ project "SFML"
         "extlibs/headers/AL",
         "extlibs/headers/freetype2",
         "extlibs/headers/stb_image"
-    }
\ No newline at end of file
+    }
+
+    filter "system:windows"
+        removefiles {
+            "**/Unix/**"
+        }
+
+    filter "system:linux"
+        removefiles {
+            "**/Win32/**"
+        }
+
+    filter {}
@@ -27,17 +27,20 @@
 ////////////////////////////////////////////////////////////
 #include <SFML/Graphics/Font.hpp>
 #include <SFML/Graphics/GLCheck.hpp>
+#include <SFML/Graphics/ProcessorCount.hpp>
 #ifdef SFML_SYSTEM_ANDROID
     #include <SFML/System/Android/ResourceStream.hpp>
 #endif
 #include <SFML/System/InputStream.hpp>
 #include <SFML/System/Err.hpp>
+#include <SFML/System/Thread.hpp>
 #include <ft2build.h>
 #include FT_FREETYPE_H
 #include FT_GLYPH_H
 #include FT_OUTLINE_H
 #include FT_BITMAP_H
 #include FT_STROKER_H
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 
@@ -76,6 +79,290 @@ namespace
     {
         return (static_cast<sf::Uint64>(reinterpret<sf::Uint32>(outlineThickness)) << 32) | (static_cast<sf::Uint64>(bold) << 31) | index;
     }
+
+    // Size of the glyph textures once they stop growing, more glyphs go to additional textures
+    const unsigned int maxPageSize = 1024;
+
+    // Find the bottom-left position of a rectangle on a skyline, i.e. the one whose top edge
+    // ends up lowest (ties go to the narrowest segment, it wastes the least space), and raise
+    // the skyline over it. The cost only depends on the number of segments, not on the number of glyphs.
+    template <typename Skyline>
+    bool placeOnSkyline(Skyline& skyline, unsigned int width, unsigned int height, unsigned int textureHeight, unsigned int& x, unsigned int& y)
+    {
+        std::size_t bestIndex = skyline.size();
+        unsigned int bestTop = 0;
+        unsigned int bestWidth = 0;
+
+        for (std::size_t i = 0; i < skyline.size(); ++i)
+        {
+            // The rectangle rests on the highest segment it spans
+            unsigned int top = 0;
+            unsigned int spanned = 0;
+            std::size_t j = i;
+            for (; (j < skyline.size()) && (spanned < width); ++j)
+            {
+                top = std::max(top, skyline[j].y);
+                spanned += skyline[j].width;
+            }
+
+            if ((spanned < width) || (top + height > textureHeight))
+                continue;
+
+            if ((bestIndex == skyline.size()) || (top < bestTop) || ((top == bestTop) && (skyline[i].width < bestWidth)))
+            {
+                bestIndex = i;
+                bestTop = top;
+                bestWidth = skyline[i].width;
+            }
+        }
+
+        if (bestIndex == skyline.size())
+            return false;
+
+        x = skyline[bestIndex].x;
+        y = bestTop;
+
+        // Insert the new segment and cut away what it covers of the following ones
+        skyline.insert(skyline.begin() + bestIndex, typename Skyline::value_type(x, y + height, width));
+        for (std::size_t i = bestIndex + 1; i < skyline.size(); )
+        {
+            unsigned int end = skyline[i - 1].x + skyline[i - 1].width;
+            if (skyline[i].x >= end)
+                break;
+
+            unsigned int covered = end - skyline[i].x;
+            if (covered >= skyline[i].width)
+            {
+                skyline.erase(skyline.begin() + i);
+                continue;
+            }
+
+            skyline[i].x += covered;
+            skyline[i].width -= covered;
+            break;
+        }
+
+        // Merge neighbors at the same height
+        for (std::size_t i = 1; i < skyline.size(); )
+        {
+            if (skyline[i - 1].y == skyline[i].y)
+            {
+                skyline[i - 1].width += skyline[i].width;
+                skyline.erase(skyline.begin() + i);
+            }
+            else
+            {
+                ++i;
+            }
+        }
+
+        return true;
+    }
+
+    // Transparent border left around every glyph, so that filtering doesn't pollute them with pixels from neighbors
+    const unsigned int glyphPadding = 1;
+
+    // Below this many glyphs per thread, starting a thread and opening a face costs more than it saves
+    const std::size_t minGlyphsPerWorker = 32;
+
+    // Rasterize a glyph into a padded RGBA buffer with the given FreeType objects. Only the objects
+    // passed in are touched, so threads with a face of their own can call it concurrently.
+    // The face must be set to the character size already. The advance and bounds of the glyph are
+    // filled, width and height stay 0 if the glyph has no pixels (e.g. a space).
+    bool rasterizeGlyph(FT_Library library, FT_Face face, FT_Stroker stroker, sf::Uint32 codePoint, bool bold, float outlineThickness,
+                        sf::Glyph& glyph, std::vector<sf::Uint8>& buffer, unsigned int& width, unsigned int& height)
+    {
+        width = 0;
+        height = 0;
+
+        // Load the glyph corresponding to the code point
+        FT_Int32 flags = FT_LOAD_TARGET_NORMAL | FT_LOAD_FORCE_AUTOHINT;
+        if (outlineThickness != 0)
+            flags |= FT_LOAD_NO_BITMAP;
+        if (FT_Load_Char(face, codePoint, flags) != 0)
+            return false;
+
+        // Retrieve the glyph
+        FT_Glyph glyphDesc;
+        if (FT_Get_Glyph(face->glyph, &glyphDesc) != 0)
+            return false;
+
+        // Apply bold and outline (there is no fallback for outline) if necessary -- first technique using outline (highest quality)
+        FT_Pos weight = 1 << 6;
+        bool outline = (glyphDesc->format == FT_GLYPH_FORMAT_OUTLINE);
+        if (outline)
+        {
+            if (bold)
+            {
+                FT_OutlineGlyph outlineGlyph = (FT_OutlineGlyph)glyphDesc;
+                FT_Outline_Embolden(&outlineGlyph->outline, weight);
+            }
+
+            if (outlineThickness != 0)
+            {
+                FT_Stroker_Set(stroker, static_cast<FT_Fixed>(outlineThickness * static_cast<float>(1 << 6)), FT_STROKER_LINECAP_ROUND, FT_STROKER_LINEJOIN_ROUND, 0);
+                FT_Glyph_Stroke(&glyphDesc, stroker, true);
+            }
+        }
+
+        // Convert the glyph to a bitmap (i.e. rasterize it)
+        FT_Glyph_To_Bitmap(&glyphDesc, FT_RENDER_MODE_NORMAL, 0, 1);
+        FT_Bitmap& bitmap = reinterpret_cast<FT_BitmapGlyph>(glyphDesc)->bitmap;
+
+        // Apply bold if necessary -- fallback technique using bitmap (lower quality)
+        if (!outline)
+        {
+            if (bold)
+                FT_Bitmap_Embolden(library, &bitmap, weight, weight);
+
+            if (outlineThickness != 0)
+                sf::err() << "Failed to outline glyph (no fallback available)" << std::endl;
+        }
+
+        // Compute the glyph's advance offset
+        glyph.advance = static_cast<float>(face->glyph->metrics.horiAdvance) / static_cast<float>(1 << 6);
+        if (bold)
+            glyph.advance += static_cast<float>(weight) / static_cast<float>(1 << 6);
+
+        if ((bitmap.width > 0) && (bitmap.rows > 0))
+        {
+            const unsigned int padding = glyphPadding;
+            width  = bitmap.width + 2 * padding;
+            height = bitmap.rows + 2 * padding;
+
+            // Compute the glyph's bounding box
+            glyph.bounds.left   =  static_cast<float>(face->glyph->metrics.horiBearingX) / static_cast<float>(1 << 6);
+            glyph.bounds.top    = -static_cast<float>(face->glyph->metrics.horiBearingY) / static_cast<float>(1 << 6);
+            glyph.bounds.width  =  static_cast<float>(face->glyph->metrics.width)        / static_cast<float>(1 << 6) + outlineThickness * 2;
+            glyph.bounds.height =  static_cast<float>(face->glyph->metrics.height)       / static_cast<float>(1 << 6) + outlineThickness * 2;
+
+            // Resize the pixel buffer to the new size and fill it with transparent white pixels
+            buffer.resize(width * height * 4);
+
+            sf::Uint8* current = &buffer[0];
+            sf::Uint8* end = current + width * height * 4;
+
+            while (current != end)
+            {
+                (*current++) = 255;
+                (*current++) = 255;
+                (*current++) = 255;
+                (*current++) = 0;
+            }
+
+            // Extract the glyph's pixels from the bitmap
+            const sf::Uint8* pixels = bitmap.buffer;
+            if (bitmap.pixel_mode == FT_PIXEL_MODE_MONO)
+            {
+                // Pixels are 1 bit monochrome values
+                for (unsigned int y = padding; y < height - padding; ++y)
+                {
+                    for (unsigned int x = padding; x < width - padding; ++x)
+                    {
+                        // The color channels remain white, just fill the alpha channel
+                        std::size_t index = x + y * width;
+                        buffer[index * 4 + 3] = ((pixels[(x - padding) / 8]) & (1 << (7 - ((x - padding) % 8)))) ? 255 : 0;
+                    }
+                    pixels += bitmap.pitch;
+                }
+            }
+            else
+            {
+                // Pixels are 8 bits gray levels
+                for (unsigned int y = padding; y < height - padding; ++y)
+                {
+                    for (unsigned int x = padding; x < width - padding; ++x)
+                    {
+                        // The color channels remain white, just fill the alpha channel
+                        std::size_t index = x + y * width;
+                        buffer[index * 4 + 3] = pixels[x - padding];
+                    }
+                    pixels += bitmap.pitch;
+                }
+            }
+        }
+
+        // Delete the FT glyph
+        FT_Done_Glyph(glyphDesc);
+
+        return true;
+    }
+
+    // A glyph of a preload batch and its rasterized pixels
+    struct RasterJob
+    {
+        sf::Uint32             codePoint;
+        sf::Uint64             key;
+        sf::Glyph              glyph;
+        std::vector<sf::Uint8> pixels;
+        unsigned int           width;
+        unsigned int           height;
+        bool                   done;
+    };
+
+    // Rasterizes every n-th job of a batch with a FreeType face of its own,
+    // FreeType objects can't be shared between threads
+    class RasterWorker
+    {
+    public:
+
+        RasterWorker(const std::string& file, const void* data, std::size_t size, unsigned int characterSize, bool bold, float outlineThickness,
+                     std::vector<RasterJob>& jobs, std::size_t first, std::size_t step) :
+        m_file            (file),
+        m_data            (data),
+        m_size            (size),
+        m_characterSize   (characterSize),
+        m_bold            (bold),
+        m_outlineThickness(outlineThickness),
+        m_jobs            (jobs),
+        m_first           (first),
+        m_step            (step)
+        {
+        }
+
+        void run()
+        {
+            FT_Library library;
+            if (FT_Init_FreeType(&library) != 0)
+                return;
+
+            // Jobs are left undone if anything fails, the calling thread loads them then
+            FT_Face face = NULL;
+            FT_Stroker stroker = NULL;
+            FT_Error error = m_data ? FT_New_Memory_Face(library, reinterpret_cast<const FT_Byte*>(m_data), static_cast<FT_Long>(m_size), 0, &face)
+                                    : FT_New_Face(library, m_file.c_str(), 0, &face);
+
+            if ((error == 0) &&
+                (FT_Stroker_New(library, &stroker) == 0) &&
+                (FT_Select_Charmap(face, FT_ENCODING_UNICODE) == 0) &&
+                (FT_Set_Pixel_Sizes(face, 0, m_characterSize) == 0))
+            {
+                for (std::size_t i = m_first; i < m_jobs.size(); i += m_step)
+                {
+                    RasterJob& job = m_jobs[i];
+                    job.done = rasterizeGlyph(library, face, stroker, job.codePoint, m_bold, m_outlineThickness, job.glyph, job.pixels, job.width, job.height);
+                }
+            }
+
+            if (stroker)
+                FT_Stroker_Done(stroker);
+            if (face)
+                FT_Done_Face(face);
+            FT_Done_FreeType(library);
+        }
+
+    private:
+
+        const std::string&      m_file;
+        const void*             m_data;
+        std::size_t             m_size;
+        unsigned int            m_characterSize;
+        bool                    m_bold;
+        float                   m_outlineThickness;
+        std::vector<RasterJob>& m_jobs;
+        std::size_t             m_first;
+        std::size_t             m_step;
+    };
 }
 
 
@@ -88,7 +375,9 @@ m_face     (NULL),
 m_streamRec(NULL),
 m_stroker  (NULL),
 m_refCount (NULL),
-m_info     ()
+m_info     (),
+m_sourceData(NULL),
+m_sourceSize(0)
 {
     #ifdef SFML_SYSTEM_ANDROID
         m_stream = NULL;
@@ -105,7 +394,10 @@ m_stroker    (copy.m_stroker),
 m_refCount   (copy.m_refCount),
 m_info       (copy.m_info),
 m_pages      (copy.m_pages),
-m_pixelBuffer(copy.m_pixelBuffer)
+m_pixelBuffer(copy.m_pixelBuffer),
+m_sourceFile (copy.m_sourceFile),
+m_sourceData (copy.m_sourceData),
+m_sourceSize (copy.m_sourceSize)
 {
     #ifdef SFML_SYSTEM_ANDROID
         m_stream = NULL;
@@ -182,6 +474,7 @@ bool Font::loadFromFile(const std::string& filename)
     // Store the loaded font in our ugly void* :)
     m_stroker = stroker;
     m_face = face;
+    m_sourceFile = filename;
 
     // Store the font information
     m_info.family = face->family_name ? face->family_name : std::string();
@@ -247,6 +540,8 @@ bool Font::loadFromMemory(const void* data, std::size_t sizeInBytes)
     // Store the loaded font in our ugly void* :)
     m_stroker = stroker;
     m_face = face;
+    m_sourceData = data;
+    m_sourceSize = sizeInBytes;
 
     // Store the font information
     m_info.family = face->family_name ? face->family_name : std::string();
@@ -350,18 +645,137 @@ const Glyph& Font::getGlyph(Uint32 codePoint, unsigned int characterSize, bool b
     Uint64 key = combine(outlineThickness, bold, FT_Get_Char_Index(static_cast<FT_Face>(m_face), codePoint));
 
     // Search the glyph into the cache
-    GlyphTable::const_iterator it = glyphs.find(key);
-    if (it != glyphs.end())
+    const Glyph* cached = glyphs.find(key);
+    if (cached)
     {
         // Found: just return it
-        return it->second;
+        return *cached;
     }
     else
     {
         // Not found: we have to load it
         Glyph glyph = loadGlyph(codePoint, characterSize, bold, outlineThickness);
-        return glyphs.insert(std::make_pair(key, glyph)).first->second;
+        return glyphs.insert(key, glyph);
+    }
+}
+
+
+////////////////////////////////////////////////////////////
+std::size_t Font::preloadGlyphs(Uint32 first, Uint32 last, unsigned int characterSize, bool bold, float outlineThickness) const
+{
+    FT_Face face = static_cast<FT_Face>(m_face);
+    if (!face || (last < first))
+        return 0;
+
+    // Size the table once instead of growing it while loading
+    GlyphTable& glyphs = m_pages[characterSize].glyphs;
+    glyphs.reserve(glyphs.size() + std::min<std::size_t>(last - first + 1, static_cast<std::size_t>(face->num_glyphs)));
+
+    // Collect the glyphs that aren't loaded yet, code points that share a glyph are loaded once
+    std::vector<RasterJob> jobs;
+    priv::FlatHashMap<Uint64, bool> pending;
+    std::size_t count = 0;
+    for (Uint32 codePoint = first; ; ++codePoint)
+    {
+        // Index 0 is the "missing glyph", don't load it for every absent code point
+        FT_UInt index = FT_Get_Char_Index(face, codePoint);
+        if (index != 0)
+        {
+            Uint64 key = combine(outlineThickness, bold, index);
+            if (!glyphs.find(key) && !pending.find(key))
+            {
+                pending.insert(key, true);
+
+                jobs.push_back(RasterJob());
+                jobs.back().codePoint = codePoint;
+                jobs.back().key       = key;
+                jobs.back().width     = 0;
+                jobs.back().height    = 0;
+                jobs.back().done      = false;
+            }
+            ++count;
+        }
+
+        // Checked here so that a range ending at the largest code point doesn't overflow
+        if (codePoint == last)
+            break;
+    }
+
+    if (jobs.empty())
+        return count;
+
+    // Rasterize in parallel when it pays off, a face loaded from a stream can't be opened again
+    std::size_t workerCount = std::min(priv::getProcessorCount(), jobs.size() / minGlyphsPerWorker);
+    if ((workerCount > 1) && (m_sourceData || !m_sourceFile.empty()))
+    {
+        std::vector<RasterWorker*> workers;
+        std::vector<Thread*> threads;
+        for (std::size_t i = 0; i < workerCount; ++i)
+            workers.push_back(new RasterWorker(m_sourceFile, m_sourceData, m_sourceSize, characterSize, bold, outlineThickness, jobs, i, workerCount));
+
+        // The calling thread takes the first share itself
+        for (std::size_t i = 1; i < workerCount; ++i)
+        {
+            threads.push_back(new Thread(&RasterWorker::run, workers[i]));
+            threads.back()->launch();
+        }
+        workers[0]->run();
+
+        for (std::size_t i = 0; i < threads.size(); ++i)
+        {
+            threads[i]->wait();
+            delete threads[i];
+        }
+        for (std::size_t i = 0; i < workers.size(); ++i)
+            delete workers[i];
     }
+
+    // Whatever the workers didn't do is rasterized here
+    if (setCurrentSize(characterSize))
+    {
+        for (std::size_t i = 0; i < jobs.size(); ++i)
+        {
+            RasterJob& job = jobs[i];
+            if (!job.done)
+                rasterizeGlyph(static_cast<FT_Library>(m_library), face, static_cast<FT_Stroker>(m_stroker), job.codePoint, bold, outlineThickness, job.glyph, job.pixels, job.width, job.height);
+        }
+    }
+
+    // Place all the glyphs first, the textures may still grow (or be added) while doing so
+    Page& page = m_pages[characterSize];
+    std::vector<IntRect> rects(jobs.size());
+    for (std::size_t i = 0; i < jobs.size(); ++i)
+    {
+        RasterJob& job = jobs[i];
+        if ((job.width > 0) && (job.height > 0))
+            rects[i] = placeGlyph(page, job.glyph, job.width, job.height);
+    }
+
+    // Then write the pixels with a single update per texture
+    std::vector<const Uint8*> texturePixels;
+    std::vector<IntRect> textureRects;
+    for (std::size_t textureIndex = 0; textureIndex < page.textures.size(); ++textureIndex)
+    {
+        texturePixels.clear();
+        textureRects.clear();
+        for (std::size_t i = 0; i < jobs.size(); ++i)
+        {
+            const RasterJob& job = jobs[i];
+            if ((job.width > 0) && (job.height > 0) && (job.glyph.textureIndex == textureIndex))
+            {
+                texturePixels.push_back(&job.pixels[0]);
+                textureRects.push_back(rects[i]);
+            }
+        }
+
+        if (!textureRects.empty())
+            page.textures[textureIndex].update(&texturePixels[0], &textureRects[0], textureRects.size());
+    }
+
+    for (std::size_t i = 0; i < jobs.size(); ++i)
+        glyphs.insert(jobs[i].key, jobs[i].glyph);
+
+    return count;
 }
 
 
@@ -458,7 +872,23 @@ float Font::getUnderlineThickness(unsigned int characterSize) const
 ////////////////////////////////////////////////////////////
 const Texture& Font::getTexture(unsigned int characterSize) const
 {
-    return m_pages[characterSize].texture;
+    return m_pages[characterSize].textures[0];
+}
+
+
+////////////////////////////////////////////////////////////
+const Texture& Font::getTexture(unsigned int characterSize, unsigned int index) const
+{
+    const Page& page = m_pages[characterSize];
+
+    return (index < page.textures.size()) ? page.textures[index] : page.textures[0];
+}
+
+
+////////////////////////////////////////////////////////////
+unsigned int Font::getTextureCount(unsigned int characterSize) const
+{
+    return static_cast<unsigned int>(m_pages[characterSize].textures.size());
 }
 
 
@@ -473,8 +903,11 @@ Font& Font::operator =(const Font& right)
     std::swap(m_stroker,     temp.m_stroker);
     std::swap(m_refCount,    temp.m_refCount);
     std::swap(m_info,        temp.m_info);
-    std::swap(m_pages,       temp.m_pages);
+    m_pages.swap(temp.m_pages);
     std::swap(m_pixelBuffer, temp.m_pixelBuffer);
+    std::swap(m_sourceFile,  temp.m_sourceFile);
+    std::swap(m_sourceData,  temp.m_sourceData);
+    std::swap(m_sourceSize,  temp.m_sourceSize);
 
     #ifdef SFML_SYSTEM_ANDROID
         std::swap(m_stream, temp.m_stream);
@@ -525,6 +958,9 @@ void Font::cleanup()
     m_refCount  = NULL;
     m_pages.clear();
     std::vector<Uint8>().swap(m_pixelBuffer);
+    m_sourceFile.clear();
+    m_sourceData = NULL;
+    m_sourceSize = 0;
 }
 
 
@@ -543,215 +979,91 @@ Glyph Font::loadGlyph(Uint32 codePoint, unsigned int characterSize, bool bold, f
     if (!setCurrentSize(characterSize))
         return glyph;
 
-    // Load the glyph corresponding to the code point
-    FT_Int32 flags = FT_LOAD_TARGET_NORMAL | FT_LOAD_FORCE_AUTOHINT;
-    if (outlineThickness != 0)
-        flags |= FT_LOAD_NO_BITMAP;
-    if (FT_Load_Char(face, codePoint, flags) != 0)
+    // Rasterize the glyph
+    unsigned int width = 0;
+    unsigned int height = 0;
+    if (!rasterizeGlyph(static_cast<FT_Library>(m_library), face, static_cast<FT_Stroker>(m_stroker), codePoint, bold, outlineThickness, glyph, m_pixelBuffer, width, height))
         return glyph;
 
-    // Retrieve the glyph
-    FT_Glyph glyphDesc;
-    if (FT_Get_Glyph(face->glyph, &glyphDesc) != 0)
-        return glyph;
-
-    // Apply bold and outline (there is no fallback for outline) if necessary -- first technique using outline (highest quality)
-    FT_Pos weight = 1 << 6;
-    bool outline = (glyphDesc->format == FT_GLYPH_FORMAT_OUTLINE);
-    if (outline)
-    {
-        if (bold)
-        {
-            FT_OutlineGlyph outlineGlyph = (FT_OutlineGlyph)glyphDesc;
-            FT_Outline_Embolden(&outlineGlyph->outline, weight);
-        }
-
-        if (outlineThickness != 0)
-        {
-            FT_Stroker stroker = static_cast<FT_Stroker>(m_stroker);
-
-            FT_Stroker_Set(stroker, static_cast<FT_Fixed>(outlineThickness * static_cast<float>(1 << 6)), FT_STROKER_LINECAP_ROUND, FT_STROKER_LINEJOIN_ROUND, 0);
-            FT_Glyph_Stroke(&glyphDesc, stroker, true);
-        }
-    }
-
-    // Convert the glyph to a bitmap (i.e. rasterize it)
-    FT_Glyph_To_Bitmap(&glyphDesc, FT_RENDER_MODE_NORMAL, 0, 1);
-    FT_Bitmap& bitmap = reinterpret_cast<FT_BitmapGlyph>(glyphDesc)->bitmap;
-
-    // Apply bold if necessary -- fallback technique using bitmap (lower quality)
-    if (!outline)
-    {
-        if (bold)
-            FT_Bitmap_Embolden(static_cast<FT_Library>(m_library), &bitmap, weight, weight);
-
-        if (outlineThickness != 0)
-            err() << "Failed to outline glyph (no fallback available)" << std::endl;
-    }
-
-    // Compute the glyph's advance offset
-    glyph.advance = static_cast<float>(face->glyph->metrics.horiAdvance) / static_cast<float>(1 << 6);
-    if (bold)
-        glyph.advance += static_cast<float>(weight) / static_cast<float>(1 << 6);
-
-    int width  = bitmap.width;
-    int height = bitmap.rows;
-
     if ((width > 0) && (height > 0))
     {
-        // Leave a small padding around characters, so that filtering doesn't
-        // pollute them with pixels from neighbors
-        const unsigned int padding = 1;
-
-        width += 2 * padding;
-        height += 2 * padding;
-
-        // Get the glyphs page corresponding to the character size
+        // Find a good position for the new glyph into the textures and write the pixels to it
         Page& page = m_pages[characterSize];
-
-        // Find a good position for the new glyph into the texture
-        glyph.textureRect = findGlyphRect(page, width, height);
-
-        // Make sure the texture data is positioned in the center
-        // of the allocated texture rectangle
-        glyph.textureRect.left += padding;
-        glyph.textureRect.top += padding;
-        glyph.textureRect.width -= 2 * padding;
-        glyph.textureRect.height -= 2 * padding;
-
-        // Compute the glyph's bounding box
-        glyph.bounds.left   =  static_cast<float>(face->glyph->metrics.horiBearingX) / static_cast<float>(1 << 6);
-        glyph.bounds.top    = -static_cast<float>(face->glyph->metrics.horiBearingY) / static_cast<float>(1 << 6);
-        glyph.bounds.width  =  static_cast<float>(face->glyph->metrics.width)        / static_cast<float>(1 << 6) + outlineThickness * 2;
-        glyph.bounds.height =  static_cast<float>(face->glyph->metrics.height)       / static_cast<float>(1 << 6) + outlineThickness * 2;
-
-        // Resize the pixel buffer to the new size and fill it with transparent white pixels
-        m_pixelBuffer.resize(width * height * 4);
-
-        Uint8* current = &m_pixelBuffer[0];
-        Uint8* end = current + width * height * 4;
-
-        while (current != end)
-        {
-            (*current++) = 255;
-            (*current++) = 255;
-            (*current++) = 255;
-            (*current++) = 0;
-        }
-
-        // Extract the glyph's pixels from the bitmap
-        const Uint8* pixels = bitmap.buffer;
-        if (bitmap.pixel_mode == FT_PIXEL_MODE_MONO)
-        {
-            // Pixels are 1 bit monochrome values
-            for (unsigned int y = padding; y < height - padding; ++y)
-            {
-                for (unsigned int x = padding; x < width - padding; ++x)
-                {
-                    // The color channels remain white, just fill the alpha channel
-                    std::size_t index = x + y * width;
-                    m_pixelBuffer[index * 4 + 3] = ((pixels[(x - padding) / 8]) & (1 << (7 - ((x - padding) % 8)))) ? 255 : 0;
-                }
-                pixels += bitmap.pitch;
-            }
-        }
-        else
-        {
-            // Pixels are 8 bits gray levels
-            for (unsigned int y = padding; y < height - padding; ++y)
-            {
-                for (unsigned int x = padding; x < width - padding; ++x)
-                {
-                    // The color channels remain white, just fill the alpha channel
-                    std::size_t index = x + y * width;
-                    m_pixelBuffer[index * 4 + 3] = pixels[x - padding];
-                }
-                pixels += bitmap.pitch;
-            }
-        }
-
-        // Write the pixels to the texture
-        unsigned int x = glyph.textureRect.left - padding;
-        unsigned int y = glyph.textureRect.top - padding;
-        unsigned int w = glyph.textureRect.width + 2 * padding;
-        unsigned int h = glyph.textureRect.height + 2 * padding;
-        page.texture.update(&m_pixelBuffer[0], w, h, x, y);
+        IntRect rect = placeGlyph(page, glyph, width, height);
+        page.textures[glyph.textureIndex].update(&m_pixelBuffer[0], rect.width, rect.height, rect.left, rect.top);
     }
 
-    // Delete the FT glyph
-    FT_Done_Glyph(glyphDesc);
-
     // Done :)
     return glyph;
 }
 
 
 ////////////////////////////////////////////////////////////
-IntRect Font::findGlyphRect(Page& page, unsigned int width, unsigned int height) const
+IntRect Font::placeGlyph(Page& page, Glyph& glyph, unsigned int width, unsigned int height) const
 {
-    // Find the line that fits well the glyph
-    Row* row = NULL;
-    float bestRatio = 0;
-    for (std::vector<Row>::iterator it = page.rows.begin(); it != page.rows.end() && !row; ++it)
-    {
-        float ratio = static_cast<float>(height) / it->height;
+    const int padding = static_cast<int>(glyphPadding);
 
-        // Ignore rows that are either too small or too high
-        if ((ratio < 0.7f) || (ratio > 1.f))
-            continue;
+    // Find a good position for the new glyph into the textures
+    IntRect rect = findGlyphRect(page, width, height, glyph.textureIndex);
 
-        // Check if there's enough horizontal space left in the row
-        if (width > page.texture.getSize().x - it->width)
-            continue;
+    // Make sure the texture data is positioned in the center
+    // of the allocated texture rectangle
+    glyph.textureRect.left   = rect.left + padding;
+    glyph.textureRect.top    = rect.top + padding;
+    glyph.textureRect.width  = rect.width - 2 * padding;
+    glyph.textureRect.height = rect.height - 2 * padding;
 
-        // Make sure that this new row is the best found so far
-        if (ratio < bestRatio)
-            continue;
+    return rect;
+}
+
+
+////////////////////////////////////////////////////////////
+IntRect Font::findGlyphRect(Page& page, unsigned int width, unsigned int height, unsigned int& textureIndex) const
+{
+    const unsigned int pageSize = std::min(maxPageSize, Texture::getMaximumSize());
 
-        // The current row passed all the tests: we can select it
-        row = &*it;
-        bestRatio = ratio;
+    if ((width > pageSize) || (height > pageSize))
+    {
+        err() << "Failed to add a new character to the font: the glyph is larger than the maximum texture size" << std::endl;
+        textureIndex = 0;
+        return IntRect(0, 0, 2, 2);
     }
 
-    // If we didn't find a matching row, create a new one (10% taller than the glyph)
-    if (!row)
+    // Only the last texture can take new glyphs, the ones before it are full
+    textureIndex = static_cast<unsigned int>(page.textures.size() - 1);
+    Texture& texture = page.textures[textureIndex];
+    Skyline& skyline = page.skylines[textureIndex];
+
+    unsigned int x = 0;
+    unsigned int y = 0;
+    while (!placeOnSkyline(skyline, width, height, texture.getSize().y, x, y))
     {
-        int rowHeight = height + height / 10;
-        while ((page.nextRow + rowHeight >= page.texture.getSize().y) || (width >= page.texture.getSize().x))
+        unsigned int textureWidth  = texture.getSize().x;
+        unsigned int textureHeight = texture.getSize().y;
+        if ((textureWidth * 2 <= pageSize) && (textureHeight * 2 <= pageSize))
         {
-            // Not enough space: resize the texture if possible
-            unsigned int textureWidth  = page.texture.getSize().x;
-            unsigned int textureHeight = page.texture.getSize().y;
-            if ((textureWidth * 2 <= Texture::getMaximumSize()) && (textureHeight * 2 <= Texture::getMaximumSize()))
-            {
-                // Make the texture 2 times bigger
-                Texture newTexture;
-                newTexture.create(textureWidth * 2, textureHeight * 2);
-                newTexture.setSmooth(true);
-                newTexture.update(page.texture);
-                page.texture.swap(newTexture);
-            }
-            else
-            {
-                // Oops, we've reached the maximum texture size...
-                err() << "Failed to add a new character to the font: the maximum texture size has been reached" << std::endl;
-                return IntRect(0, 0, 2, 2);
-            }
+            // Small textures grow until they reach the page size, this keeps fonts with few glyphs cheap
+            Texture newTexture;
+            newTexture.create(textureWidth * 2, textureHeight * 2);
+            newTexture.setSmooth(true);
+            newTexture.update(texture);
+            texture.swap(newTexture);
+
+            skyline.push_back(SkylineNode(textureWidth, 0, textureWidth));
         }
+        else
+        {
+            // The texture is full: continue in a new texture, the existing glyphs don't move
+            page.textures.push_back(Texture());
+            page.textures.back().create(pageSize, pageSize);
+            page.textures.back().setSmooth(true);
+            page.skylines.push_back(Skyline(1, SkylineNode(0, 0, pageSize)));
 
-        // We can now create the new row
-        page.rows.push_back(Row(page.nextRow, rowHeight));
-        page.nextRow += rowHeight;
-        row = &page.rows.back();
+            return findGlyphRect(page, width, height, textureIndex);
+        }
     }
 
-    // Find the glyph's rectangle on the selected row
-    IntRect rect(row->width, row->top, width, height);
-
-    // Update the row informations
-    row->width += width;
-
-    return rect;
+    return IntRect(x, y, width, height);
 }
 
 
@@ -797,8 +1109,7 @@ bool Font::setCurrentSize(unsigned int characterSize) const
 
 
 ////////////////////////////////////////////////////////////
-Font::Page::Page() :
-nextRow(3)
+Font::Page::Page()
 {
     // Make sure that the texture is initialized by default
     sf::Image image;
@@ -810,8 +1121,14 @@ nextRow(3)
             image.setPixel(x, y, Color(255, 255, 255, 255));
 
     // Create the texture
-    texture.loadFromImage(image);
-    texture.setSmooth(true);
+    textures.push_back(Texture());
+    textures.back().loadFromImage(image);
+    textures.back().setSmooth(true);
+
+    // The skyline starts above the white square
+    skylines.push_back(Skyline());
+    skylines.back().push_back(SkylineNode(0, 3, 3));
+    skylines.back().push_back(SkylineNode(3, 0, 128 - 3));
 }
 
 } // namespace sf
@@ -26,29 +26,321 @@
 // Headers
 ////////////////////////////////////////////////////////////
 #include <SFML/Graphics/Image.hpp>
+#include <SFML/Graphics/ImageKernels.hpp>
 #include <SFML/Graphics/ImageLoader.hpp>
+#include <SFML/Graphics/ProcessorCount.hpp>
 #include <SFML/System/Err.hpp>
+#include <SFML/System/Thread.hpp>
 #ifdef SFML_SYSTEM_ANDROID
     #include <SFML/System/Android/ResourceStream.hpp>
 #endif
 #include <algorithm>
+#include <cmath>
 #include <cstring>
 
 
+namespace
+{
+    // Area of a copy between two images, once clipped to both of them
+    struct CopyArea
+    {
+        int left;   // Left of the source rectangle
+        int top;    // Top of the source rectangle
+        int width;  // Width of the area
+        int height; // Height of the area
+    };
+
+    // Clip the area of a copy, returns false if there's nothing to copy
+    bool clipCopyArea(sf::Vector2u sourceSize, sf::Vector2u destSize, unsigned int destX, unsigned int destY, const sf::IntRect& sourceRect, CopyArea& area)
+    {
+        // Make sure that both images are valid
+        if ((sourceSize.x == 0) || (sourceSize.y == 0) || (destSize.x == 0) || (destSize.y == 0))
+            return false;
+
+        // Adjust the source rectangle
+        sf::IntRect srcRect = sourceRect;
+        if (srcRect.width == 0 || (srcRect.height == 0))
+        {
+            srcRect.left   = 0;
+            srcRect.top    = 0;
+            srcRect.width  = sourceSize.x;
+            srcRect.height = sourceSize.y;
+        }
+        else
+        {
+            if (srcRect.left   < 0) srcRect.left = 0;
+            if (srcRect.top    < 0) srcRect.top  = 0;
+            if (srcRect.width  > static_cast<int>(sourceSize.x)) srcRect.width  = sourceSize.x;
+            if (srcRect.height > static_cast<int>(sourceSize.y)) srcRect.height = sourceSize.y;
+        }
+
+        // Then find the valid bounds of the destination rectangle
+        int width  = srcRect.width;
+        int height = srcRect.height;
+        if (destX + width  > destSize.x) width  = destSize.x - destX;
+        if (destY + height > destSize.y) height = destSize.y - destY;
+
+        // Make sure the destination area is valid
+        if ((width <= 0) || (height <= 0))
+            return false;
+
+        area.left   = srcRect.left;
+        area.top    = srcRect.top;
+        area.width  = width;
+        area.height = height;
+        return true;
+    }
+
+    // Blend factors and equations of a blend mode, as the image kernels take them
+    sf::priv::CompositeMode toCompositeMode(const sf::BlendMode& blendMode)
+    {
+        sf::priv::CompositeMode mode;
+        mode.colorSrcFactor = blendMode.colorSrcFactor;
+        mode.colorDstFactor = blendMode.colorDstFactor;
+        mode.colorEquation  = blendMode.colorEquation;
+        mode.alphaSrcFactor = blendMode.alphaSrcFactor;
+        mode.alphaDstFactor = blendMode.alphaDstFactor;
+        mode.alphaEquation  = blendMode.alphaEquation;
+        return mode;
+    }
+
+    // Below this many target pixels per thread, starting a thread costs more than it saves
+    const std::size_t minPixelsPerWorker = 16384;
+
+    // Source pixels that contribute to each target pixel along one axis of a resize
+    struct ResampleAxis
+    {
+        std::size_t               taps;    // Number of source pixels per target pixel
+        std::vector<unsigned int> starts;  // First source pixel of each target pixel
+        std::vector<sf::Int16>    weights; // Weights of the taps of each target pixel, in fixed point
+    };
+
+    // Radius of a filter, in source pixels when enlarging
+    double getFilterSupport(sf::Image::ResizeFilter filter)
+    {
+        switch (filter)
+        {
+            case sf::Image::Box:      return 0.5;
+            case sf::Image::Bilinear: return 1.0;
+            default:                  return 3.0;
+        }
+    }
+
+    // Weight of a source pixel at distance x from the center of a target pixel
+    double getFilterWeight(sf::Image::ResizeFilter filter, double x)
+    {
+        const double pi = 3.14159265358979323846;
+
+        switch (filter)
+        {
+            case sf::Image::Box:
+                return ((x >= -0.5) && (x < 0.5)) ? 1.0 : 0.0;
+
+            case sf::Image::Bilinear:
+                return std::max(0.0, 1.0 - std::fabs(x));
+
+            default:
+                if (x == 0.0)
+                    return 1.0;
+                if (std::fabs(x) >= 3.0)
+                    return 0.0;
+                return 3.0 * std::sin(pi * x) * std::sin(pi * x / 3.0) / (pi * pi * x * x);
+        }
+    }
+
+    // Compute the taps of every target pixel along an axis. When shrinking, the filter is
+    // stretched so that it covers all the source pixels that fall into a target pixel.
+    void computeResampleAxis(unsigned int sourceSize, unsigned int targetSize, sf::Image::ResizeFilter filter, ResampleAxis& axis)
+    {
+        const int one = 1 << sf::priv::resampleBits;
+
+        // An axis that doesn't change is copied as is
+        if (sourceSize == targetSize)
+        {
+            axis.taps = 1;
+            axis.starts.resize(targetSize);
+            for (unsigned int i = 0; i < targetSize; ++i)
+                axis.starts[i] = i;
+            axis.weights.assign(targetSize, static_cast<sf::Int16>(one));
+            return;
+        }
+
+        double scale       = static_cast<double>(sourceSize) / targetSize;
+        double filterScale = std::max(scale, 1.0);
+        double support     = getFilterSupport(filter) * filterScale;
+
+        axis.taps = std::min(static_cast<std::size_t>(std::ceil(support)) * 2 + 1, static_cast<std::size_t>(sourceSize));
+        axis.starts.resize(targetSize);
+        axis.weights.assign(targetSize * axis.taps, 0);
+
+        std::vector<double> values(axis.taps);
+        for (unsigned int i = 0; i < targetSize; ++i)
+        {
+            // Source pixels whose center is within the support, the taps are
+            // moved back at the right border so that they stay in the image
+            double center = (i + 0.5) * scale;
+            int    first  = std::max(static_cast<int>(std::floor(center - support)), 0);
+            int    last   = std::min(static_cast<int>(std::ceil(center + support)), static_cast<int>(sourceSize));
+            int    start  = std::min(first, static_cast<int>(sourceSize - axis.taps));
+
+            std::fill(values.begin(), values.end(), 0.0);
+            double total = 0.0;
+            for (int j = first; j < last; ++j)
+            {
+                values[j - start] = getFilterWeight(filter, (j + 0.5 - center) / filterScale);
+                total += values[j - start];
+            }
+
+            // Convert to fixed point, with the rounding error given to the largest weight
+            // so that the weights add up to exactly 1 and flat areas stay flat
+            sf::Int16*  weights = &axis.weights[i * axis.taps];
+            int         sum     = 0;
+            std::size_t largest = 0;
+            for (std::size_t k = 0; k < axis.taps; ++k)
+            {
+                weights[k] = static_cast<sf::Int16>(std::floor(values[k] / total * one + 0.5));
+                sum += weights[k];
+                if (weights[k] > weights[largest])
+                    largest = k;
+            }
+            weights[largest] = static_cast<sf::Int16>(weights[largest] + one - sum);
+
+            axis.starts[i] = start;
+        }
+    }
+
+    // One pass of a resize over a range of target rows, so that the rows can be split between threads.
+    // The horizontal pass resamples each source row into the premultiplied intermediate rows, the
+    // vertical pass combines intermediate rows into the target.
+    class ResampleWorker
+    {
+    public:
+
+        ResampleWorker(const sf::Uint8* source, unsigned int sourceWidth, sf::Uint16* intermediate, sf::Uint8* target, unsigned int targetWidth, const ResampleAxis& axis, bool vertical, std::size_t begin, std::size_t end) :
+        m_source      (source),
+        m_sourceWidth (sourceWidth),
+        m_intermediate(intermediate),
+        m_target      (target),
+        m_targetWidth (targetWidth),
+        m_axis        (&axis),
+        m_vertical    (vertical),
+        m_begin       (begin),
+        m_end         (end)
+        {
+        }
+
+        void run()
+        {
+            const sf::priv::ImageKernels& kernels = sf::priv::getImageKernels();
+            std::size_t sourceStride = m_sourceWidth * 4;
+            std::size_t targetStride = m_targetWidth * 4;
+
+            for (std::size_t y = m_begin; y < m_end; ++y)
+            {
+                if (m_vertical)
+                    kernels.resampleColumn(m_intermediate + m_axis->starts[y] * targetStride, targetStride, m_target + y * targetStride, m_targetWidth, &m_axis->weights[y * m_axis->taps], m_axis->taps);
+                else
+                    kernels.resampleRow(m_source + y * sourceStride, m_intermediate + y * targetStride, m_targetWidth, &m_axis->starts[0], &m_axis->weights[0], m_axis->taps);
+            }
+        }
+
+    private:
+
+        const sf::Uint8*    m_source;
+        unsigned int        m_sourceWidth;
+        sf::Uint16*         m_intermediate;
+        sf::Uint8*          m_target;
+        unsigned int        m_targetWidth;
+        const ResampleAxis* m_axis;
+        bool                m_vertical;
+        std::size_t         m_begin;
+        std::size_t         m_end;
+    };
+
+    // Run a pass of a resize, split between as many threads as it is worth
+    void runResamplePass(const sf::Uint8* source, unsigned int sourceWidth, sf::Uint16* intermediate, sf::Uint8* target, unsigned int targetWidth, std::size_t rows, const ResampleAxis& axis, bool vertical)
+    {
+        std::size_t workerCount = std::min(sf::priv::getProcessorCount(), rows * targetWidth / minPixelsPerWorker);
+        workerCount = std::max<std::size_t>(std::min(workerCount, rows), 1);
+
+        std::vector<ResampleWorker> workers;
+        for (std::size_t i = 0; i < workerCount; ++i)
+            workers.push_back(ResampleWorker(source, sourceWidth, intermediate, target, targetWidth, axis, vertical, rows * i / workerCount, rows * (i + 1) / workerCount));
+
+        // The calling thread takes the first share itself
+        std::vector<sf::Thread*> threads;
+        for (std::size_t i = 1; i < workerCount; ++i)
+        {
+            threads.push_back(new sf::Thread(&ResampleWorker::run, &workers[i]));
+            threads.back()->launch();
+        }
+
+        workers[0].run();
+
+        for (std::size_t i = 0; i < threads.size(); ++i)
+        {
+            threads[i]->wait();
+            delete threads[i];
+        }
+    }
+
+    // Resize pixels, horizontally then vertically. The colors are weighted by their alpha
+    // without touching the source: the horizontal pass premultiplies into 16-bit rows and
+    // the vertical pass divides by alpha, so a flat color stays exactly the same. Both
+    // passes always run, an axis that doesn't change just has a single tap.
+    void resample(const sf::Uint8* source, sf::Vector2u sourceSize, sf::Uint8* target, sf::Vector2u targetSize, sf::Image::ResizeFilter filter)
+    {
+        ResampleAxis horizontal;
+        ResampleAxis vertical;
+        computeResampleAxis(sourceSize.x, targetSize.x, filter, horizontal);
+        computeResampleAxis(sourceSize.y, targetSize.y, filter, vertical);
+
+        std::vector<sf::Uint16> intermediate(static_cast<std::size_t>(targetSize.x) * sourceSize.y * 4);
+        runResamplePass(source, sourceSize.x, &intermediate[0], target, targetSize.x, sourceSize.y, horizontal, false);
+        runResamplePass(source, sourceSize.x, &intermediate[0], target, targetSize.x, targetSize.y, vertical, true);
+    }
+}
+
+
 namespace sf
 {
 ////////////////////////////////////////////////////////////
 Image::Image() :
-m_size(0, 0)
+m_size        (0, 0),
+m_loadedPixels(NULL)
 {
 
 }
 
 
+////////////////////////////////////////////////////////////
+Image::Image(const Image& copy) :
+m_size        (copy.m_size),
+m_loadedPixels(NULL)
+{
+    // Loaded pixels are not shared, the copy gets pixels of its own
+    if (const Uint8* pixels = copy.getPixelData())
+        m_pixels.assign(pixels, pixels + static_cast<std::size_t>(m_size.x) * m_size.y * 4);
+}
+
+
 ////////////////////////////////////////////////////////////
 Image::~Image()
 {
+    delete m_loadedPixels;
+}
+
+
+////////////////////////////////////////////////////////////
+Image& Image::operator =(const Image& right)
+{
+    Image temp(right);
 
+    std::swap(m_size,         temp.m_size);
+    std::swap(m_pixels,       temp.m_pixels);
+    std::swap(m_loadedPixels, temp.m_loadedPixels);
+
+    return *this;
 }
 
 
@@ -73,6 +365,7 @@ void Image::create(unsigned int width, unsigned int height, const Color& color)
     
         // Commit the new pixel buffer
         m_pixels.swap(newPixels);
+        setLoadedPixels(NULL, Vector2u(width, height));
         
         // Assign the new size
         m_size.x = width;
@@ -82,6 +375,7 @@ void Image::create(unsigned int width, unsigned int height, const Color& color)
     {
         // Dump the pixel buffer
         std::vector<Uint8>().swap(m_pixels);
+        setLoadedPixels(NULL, Vector2u(0, 0));
         
         // Assign the new size
         m_size.x = 0;
@@ -100,6 +394,7 @@ void Image::create(unsigned int width, unsigned int height, const Uint8* pixels)
         
         // Commit the new pixel buffer
         m_pixels.swap(newPixels);
+        setLoadedPixels(NULL, Vector2u(width, height));
         
         // Assign the new size
         m_size.x = width;
@@ -109,6 +404,7 @@ void Image::create(unsigned int width, unsigned int height, const Uint8* pixels)
     {
         // Dump the pixel buffer
         std::vector<Uint8>().swap(m_pixels);
+        setLoadedPixels(NULL, Vector2u(0, 0));
         
         // Assign the new size
         m_size.x = 0;
@@ -122,7 +418,16 @@ bool Image::loadFromFile(const std::string& filename)
 {
     #ifndef SFML_SYSTEM_ANDROID
 
-        return priv::ImageLoader::getInstance().loadImageFromFile(filename, m_pixels, m_size);
+        priv::LoadedPixels* pixels = new priv::LoadedPixels;
+        Vector2u size;
+        if (!priv::ImageLoader::getInstance().loadImageFromFile(filename, *pixels, size))
+        {
+            delete pixels;
+            return false;
+        }
+
+        setLoadedPixels(pixels, size);
+        return true;
 
     #else
 
@@ -136,21 +441,39 @@ bool Image::loadFromFile(const std::string& filename)
 ////////////////////////////////////////////////////////////
 bool Image::loadFromMemory(const void* data, std::size_t size)
 {
-    return priv::ImageLoader::getInstance().loadImageFromMemory(data, size, m_pixels, m_size);
+    priv::LoadedPixels* pixels = new priv::LoadedPixels;
+    Vector2u pixelsSize;
+    if (!priv::ImageLoader::getInstance().loadImageFromMemory(data, size, *pixels, pixelsSize))
+    {
+        delete pixels;
+        return false;
+    }
+
+    setLoadedPixels(pixels, pixelsSize);
+    return true;
 }
 
 
 ////////////////////////////////////////////////////////////
 bool Image::loadFromStream(InputStream& stream)
 {
-    return priv::ImageLoader::getInstance().loadImageFromStream(stream, m_pixels, m_size);
+    priv::LoadedPixels* pixels = new priv::LoadedPixels;
+    Vector2u size;
+    if (!priv::ImageLoader::getInstance().loadImageFromStream(stream, *pixels, size))
+    {
+        delete pixels;
+        return false;
+    }
+
+    setLoadedPixels(pixels, size);
+    return true;
 }
 
 
 ////////////////////////////////////////////////////////////
 bool Image::saveToFile(const std::string& filename) const
 {
-    return priv::ImageLoader::getInstance().saveImageToFile(filename, m_pixels, m_size);
+    return priv::ImageLoader::getInstance().saveImageToFile(filename, getPixelData(), m_size);
 }
 
 
@@ -165,17 +488,10 @@ Vector2u Image::getSize() const
 void Image::createMaskFromColor(const Color& color, Uint8 alpha)
 {
     // Make sure that the image is not empty
-    if (!m_pixels.empty())
+    if (Uint8* pixels = getPixelData())
     {
         // Replace the alpha of the pixels that match the transparent color
-        Uint8* ptr = &m_pixels[0];
-        Uint8* end = ptr + m_pixels.size();
-        while (ptr < end)
-        {
-            if ((ptr[0] == color.r) && (ptr[1] == color.g) && (ptr[2] == color.b) && (ptr[3] == color.a))
-                ptr[3] = alpha;
-            ptr += 4;
-        }
+        priv::getImageKernels().mask(pixels, static_cast<std::size_t>(m_size.x) * m_size.y, priv::makePixel(color.r, color.g, color.b, color.a), alpha);
     }
 }
 
@@ -183,86 +499,125 @@ void Image::createMaskFromColor(const Color& color, Uint8 alpha)
 ////////////////////////////////////////////////////////////
 void Image::copy(const Image& source, unsigned int destX, unsigned int destY, const IntRect& sourceRect, bool applyAlpha)
 {
-    // Make sure that both images are valid
-    if ((source.m_size.x == 0) || (source.m_size.y == 0) || (m_size.x == 0) || (m_size.y == 0))
-        return;
-
-    // Adjust the source rectangle
-    IntRect srcRect = sourceRect;
-    if (srcRect.width == 0 || (srcRect.height == 0))
+    if (applyAlpha)
     {
-        srcRect.left   = 0;
-        srcRect.top    = 0;
-        srcRect.width  = source.m_size.x;
-        srcRect.height = source.m_size.y;
+        // Interpolation using alpha values
+        copy(source, destX, destY, sourceRect, BlendAlpha);
+        return;
     }
-    else
+
+    CopyArea area;
+    if (!clipCopyArea(source.m_size, m_size, destX, destY, sourceRect, area))
+        return;
+
+    // Precompute as much as possible
+    int          pitch     = area.width * 4;
+    int          rows      = area.height;
+    int          srcStride = source.m_size.x * 4;
+    int          dstStride = m_size.x * 4;
+    const Uint8* srcPixels = source.getPixelData() + (area.left + area.top * source.m_size.x) * 4;
+    Uint8*       dstPixels = getPixelData() + (destX + destY * m_size.x) * 4;
+
+    // Optimized copy ignoring alpha values, row by row (faster)
+    for (int i = 0; i < rows; ++i)
     {
-        if (srcRect.left   < 0) srcRect.left = 0;
-        if (srcRect.top    < 0) srcRect.top  = 0;
-        if (srcRect.width  > static_cast<int>(source.m_size.x)) srcRect.width  = source.m_size.x;
-        if (srcRect.height > static_cast<int>(source.m_size.y)) srcRect.height = source.m_size.y;
+        std::memcpy(dstPixels, srcPixels, pitch);
+        srcPixels += srcStride;
+        dstPixels += dstStride;
     }
+}
 
-    // Then find the valid bounds of the destination rectangle
-    int width  = srcRect.width;
-    int height = srcRect.height;
-    if (destX + width  > m_size.x) width  = m_size.x - destX;
-    if (destY + height > m_size.y) height = m_size.y - destY;
 
-    // Make sure the destination area is valid
-    if ((width <= 0) || (height <= 0))
+////////////////////////////////////////////////////////////
+void Image::copy(const Image& source, unsigned int destX, unsigned int destY, const IntRect& sourceRect, const BlendMode& blendMode)
+{
+    CopyArea area;
+    if (!clipCopyArea(source.m_size, m_size, destX, destY, sourceRect, area))
         return;
 
     // Precompute as much as possible
-    int          pitch     = width * 4;
-    int          rows      = height;
+    int          rows      = area.height;
     int          srcStride = source.m_size.x * 4;
     int          dstStride = m_size.x * 4;
-    const Uint8* srcPixels = &source.m_pixels[0] + (srcRect.left + srcRect.top * source.m_size.x) * 4;
-    Uint8*       dstPixels = &m_pixels[0] + (destX + destY * m_size.x) * 4;
+    const Uint8* srcPixels = source.getPixelData() + (area.left + area.top * source.m_size.x) * 4;
+    Uint8*       dstPixels = getPixelData() + (destX + destY * m_size.x) * 4;
 
-    // Copy the pixels
-    if (applyAlpha)
+    // Blend the pixels, row by row
+    const priv::ImageKernels& kernels = priv::getImageKernels();
+    priv::CompositeMode mode = toCompositeMode(blendMode);
+    for (int i = 0; i < rows; ++i)
     {
-        // Interpolation using alpha values, pixel by pixel (slower)
-        for (int i = 0; i < rows; ++i)
-        {
-            for (int j = 0; j < width; ++j)
-            {
-                // Get a direct pointer to the components of the current pixel
-                const Uint8* src = srcPixels + j * 4;
-                Uint8*       dst = dstPixels + j * 4;
-
-                // Interpolate RGBA components using the alpha value of the source pixel
-                Uint8 alpha = src[3];
-                dst[0] = (src[0] * alpha + dst[0] * (255 - alpha)) / 255;
-                dst[1] = (src[1] * alpha + dst[1] * (255 - alpha)) / 255;
-                dst[2] = (src[2] * alpha + dst[2] * (255 - alpha)) / 255;
-                dst[3] = alpha + dst[3] * (255 - alpha) / 255;
-            }
-
-            srcPixels += srcStride;
-            dstPixels += dstStride;
-        }
+        kernels.composite(srcPixels, dstPixels, area.width, mode);
+        srcPixels += srcStride;
+        dstPixels += dstStride;
     }
-    else
+}
+
+
+////////////////////////////////////////////////////////////
+void Image::copy(const Image& source, unsigned int destX, unsigned int destY, const Color& colorKey, const IntRect& sourceRect)
+{
+    CopyArea area;
+    if (!clipCopyArea(source.m_size, m_size, destX, destY, sourceRect, area))
+        return;
+
+    // Precompute as much as possible
+    int          rows      = area.height;
+    int          srcStride = source.m_size.x * 4;
+    int          dstStride = m_size.x * 4;
+    const Uint8* srcPixels = source.getPixelData() + (area.left + area.top * source.m_size.x) * 4;
+    Uint8*       dstPixels = getPixelData() + (destX + destY * m_size.x) * 4;
+
+    // Copy the pixels that are not the color-key, row by row
+    const priv::ImageKernels& kernels = priv::getImageKernels();
+    Uint32 key = priv::makePixel(colorKey.r, colorKey.g, colorKey.b, colorKey.a);
+    for (int i = 0; i < rows; ++i)
     {
-        // Optimized copy ignoring alpha values, row by row (faster)
-        for (int i = 0; i < rows; ++i)
-        {
-            std::memcpy(dstPixels, srcPixels, pitch);
-            srcPixels += srcStride;
-            dstPixels += dstStride;
-        }
+        kernels.copyColorKeyed(srcPixels, dstPixels, area.width, key);
+        srcPixels += srcStride;
+        dstPixels += dstStride;
     }
 }
 
 
+////////////////////////////////////////////////////////////
+void Image::fillRect(const IntRect& rectangle, const Color& color)
+{
+    // Clip the rectangle to the image
+    int left   = std::max(rectangle.left, 0);
+    int top    = std::max(rectangle.top, 0);
+    int right  = std::min(rectangle.left + rectangle.width,  static_cast<int>(m_size.x));
+    int bottom = std::min(rectangle.top  + rectangle.height, static_cast<int>(m_size.y));
+    if ((left >= right) || (top >= bottom))
+        return;
+
+    const priv::ImageKernels& kernels = priv::getImageKernels();
+    Uint32 pixel = priv::makePixel(color.r, color.g, color.b, color.a);
+    for (int y = top; y < bottom; ++y)
+        kernels.fill(getPixelData() + (left + y * m_size.x) * 4, right - left, pixel);
+}
+
+
+////////////////////////////////////////////////////////////
+void Image::premultiplyAlpha()
+{
+    if (Uint8* pixels = getPixelData())
+        priv::getImageKernels().premultiply(pixels, static_cast<std::size_t>(m_size.x) * m_size.y);
+}
+
+
+////////////////////////////////////////////////////////////
+void Image::unpremultiplyAlpha()
+{
+    if (Uint8* pixels = getPixelData())
+        priv::getImageKernels().unpremultiply(pixels, static_cast<std::size_t>(m_size.x) * m_size.y);
+}
+
+
 ////////////////////////////////////////////////////////////
 void Image::setPixel(unsigned int x, unsigned int y, const Color& color)
 {
-    Uint8* pixel = &m_pixels[(x + y * m_size.x) * 4];
+    Uint8* pixel = getPixelData() + (x + y * m_size.x) * 4;
     *pixel++ = color.r;
     *pixel++ = color.g;
     *pixel++ = color.b;
@@ -273,7 +628,7 @@ void Image::setPixel(unsigned int x, unsigned int y, const Color& color)
 ////////////////////////////////////////////////////////////
 Color Image::getPixel(unsigned int x, unsigned int y) const
 {
-    const Uint8* pixel = &m_pixels[(x + y * m_size.x) * 4];
+    const Uint8* pixel = getPixelData() + (x + y * m_size.x) * 4;
     return Color(pixel[0], pixel[1], pixel[2], pixel[3]);
 }
 
@@ -281,9 +636,9 @@ Color Image::getPixel(unsigned int x, unsigned int y) const
 ////////////////////////////////////////////////////////////
 const Uint8* Image::getPixelsPtr() const
 {
-    if (!m_pixels.empty())
+    if (const Uint8* pixels = getPixelData())
     {
-        return &m_pixels[0];
+        return pixels;
     }
     else
     {
@@ -296,23 +651,13 @@ const Uint8* Image::getPixelsPtr() const
 ////////////////////////////////////////////////////////////
 void Image::flipHorizontally()
 {
-    if (!m_pixels.empty())
+    if (Uint8* pixels = getPixelData())
     {
         std::size_t rowSize = m_size.x * 4;
 
+        const priv::ImageKernels& kernels = priv::getImageKernels();
         for (std::size_t y = 0; y < m_size.y; ++y)
-        {
-            std::vector<Uint8>::iterator left = m_pixels.begin() + y * rowSize;
-            std::vector<Uint8>::iterator right = m_pixels.begin() + (y + 1) * rowSize - 4;
-
-            for (std::size_t x = 0; x < m_size.x / 2; ++x)
-            {
-                std::swap_ranges(left, left + 4, right);
-
-                left += 4;
-                right -= 4;
-            }
-        }
+            kernels.reverse(pixels + y * rowSize, m_size.x);
     }
 }
 
@@ -320,16 +665,17 @@ void Image::flipHorizontally()
 ////////////////////////////////////////////////////////////
 void Image::flipVertically()
 {
-    if (!m_pixels.empty())
+    if (Uint8* pixels = getPixelData())
     {
         std::size_t rowSize = m_size.x * 4;
 
-        std::vector<Uint8>::iterator top = m_pixels.begin();
-        std::vector<Uint8>::iterator bottom = m_pixels.end() - rowSize;
+        Uint8* top = pixels;
+        Uint8* bottom = pixels + (m_size.y - 1) * rowSize;
 
+        const priv::ImageKernels& kernels = priv::getImageKernels();
         for (std::size_t y = 0; y < m_size.y / 2; ++y)
         {
-            std::swap_ranges(top, top + rowSize, bottom);
+            kernels.swap(top, bottom, m_size.x);
 
             top += rowSize;
             bottom -= rowSize;
@@ -337,4 +683,80 @@ void Image::flipVertically()
     }
 }
 
+
+////////////////////////////////////////////////////////////
+void Image::resize(unsigned int width, unsigned int height, ResizeFilter filter)
+{
+    if (!getPixelData() || (width == 0) || (height == 0) || ((width == m_size.x) && (height == m_size.y)))
+        return;
+
+    std::vector<Uint8> pixels(static_cast<std::size_t>(width) * height * 4);
+    resample(getPixelData(), m_size, &pixels[0], Vector2u(width, height), filter);
+
+    m_pixels.swap(pixels);
+    setLoadedPixels(NULL, Vector2u(width, height));
+}
+
+
+////////////////////////////////////////////////////////////
+void Image::generateMipmaps(std::vector<Image>& levels, ResizeFilter filter) const
+{
+    levels.clear();
+    const Uint8* pixels = getPixelData();
+    if (!pixels)
+        return;
+
+    std::size_t levelCount = 0;
+    for (Vector2u size = m_size; (size.x > 1) || (size.y > 1); size = Vector2u(std::max(size.x / 2, 1u), std::max(size.y / 2, 1u)))
+        ++levelCount;
+    levels.resize(levelCount);
+
+    Vector2u size = m_size;
+    for (std::size_t i = 0; i < levelCount; ++i)
+    {
+        Vector2u levelSize(std::max(size.x / 2, 1u), std::max(size.y / 2, 1u));
+
+        Image& level = levels[i];
+        level.m_size = levelSize;
+        level.m_pixels.resize(static_cast<std::size_t>(levelSize.x) * levelSize.y * 4);
+        resample(pixels, size, &level.m_pixels[0], levelSize, filter);
+
+        pixels = &level.m_pixels[0];
+        size = levelSize;
+    }
+}
+
+
+////////////////////////////////////////////////////////////
+Uint8* Image::getPixelData()
+{
+    if (m_loadedPixels)
+        return m_loadedPixels->getData();
+
+    return m_pixels.empty() ? NULL : &m_pixels[0];
+}
+
+
+////////////////////////////////////////////////////////////
+const Uint8* Image::getPixelData() const
+{
+    if (m_loadedPixels)
+        return m_loadedPixels->getData();
+
+    return m_pixels.empty() ? NULL : &m_pixels[0];
+}
+
+
+////////////////////////////////////////////////////////////
+void Image::setLoadedPixels(priv::LoadedPixels* pixels, const Vector2u& size)
+{
+    delete m_loadedPixels;
+    m_loadedPixels = pixels;
+    m_size = size;
+
+    // Loaded pixels replace the pixel buffer
+    if (pixels)
+        std::vector<Uint8>().swap(m_pixels);
+}
+
 } // namespace sf
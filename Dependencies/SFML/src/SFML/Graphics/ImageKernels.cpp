@@ -0,0 +1,421 @@
+////////////////////////////////////////////////////////////
+//
+// SFML - Simple and Fast Multimedia Library
+// Copyright (C) 2007-2018 Laurent Gomila (laurent@sfml-dev.org)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include <SFML/Graphics/ImageKernels.hpp>
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)) || defined(__SSE2__)
+    #define SFML_IMAGE_KERNELS_SSE2
+    #include <emmintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #endif
+#endif
+
+
+namespace
+{
+    // Plain C++ kernels, the reference the vector ones have to match
+    struct ScalarImageKernels
+    {
+        // Blending factor of a component, see sf::BlendMode::Factor
+        static int factor(int which, const sf::Uint8* src, const sf::Uint8* dst, int component)
+        {
+            switch (which)
+            {
+                case 0:  return 0;                    // Zero
+                case 1:  return 255;                  // One
+                case 2:  return src[component];       // SrcColor
+                case 3:  return 255 - src[component]; // OneMinusSrcColor
+                case 4:  return dst[component];       // DstColor
+                case 5:  return 255 - dst[component]; // OneMinusDstColor
+                case 6:  return src[3];               // SrcAlpha
+                case 7:  return 255 - src[3];         // OneMinusSrcAlpha
+                case 8:  return dst[3];               // DstAlpha
+                default: return 255 - dst[3];         // OneMinusDstAlpha
+            }
+        }
+
+        // Blending equation, see sf::BlendMode::Equation
+        static sf::Uint8 equation(int which, int srcTerm, int dstTerm)
+        {
+            switch (which)
+            {
+                case 0:  return static_cast<sf::Uint8>(std::min(255, (srcTerm + dstTerm) / 255));
+                case 1:  return static_cast<sf::Uint8>(std::max(0, srcTerm - dstTerm) / 255);
+                default: return static_cast<sf::Uint8>(std::max(0, dstTerm - srcTerm) / 255);
+            }
+        }
+
+        static void composite(const sf::Uint8* src, sf::Uint8* dst, std::size_t count, const sf::priv::CompositeMode& mode)
+        {
+            for (std::size_t i = 0; i < count; ++i, src += 4, dst += 4)
+            {
+                sf::Uint8 result[4];
+                for (int c = 0; c < 3; ++c)
+                    result[c] = equation(mode.colorEquation, src[c] * factor(mode.colorSrcFactor, src, dst, c), dst[c] * factor(mode.colorDstFactor, src, dst, c));
+                result[3] = equation(mode.alphaEquation, src[3] * factor(mode.alphaSrcFactor, src, dst, 3), dst[3] * factor(mode.alphaDstFactor, src, dst, 3));
+
+                std::memcpy(dst, result, 4);
+            }
+        }
+
+        static void copyColorKeyed(const sf::Uint8* src, sf::Uint8* dst, std::size_t count, sf::Uint32 key)
+        {
+            for (std::size_t i = 0; i < count; ++i, src += 4, dst += 4)
+            {
+                if (std::memcmp(src, &key, 4) != 0)
+                    std::memcpy(dst, src, 4);
+            }
+        }
+
+        static void mask(sf::Uint8* pixels, std::size_t count, sf::Uint32 key, sf::Uint8 alpha)
+        {
+            for (std::size_t i = 0; i < count; ++i, pixels += 4)
+            {
+                if (std::memcmp(pixels, &key, 4) == 0)
+                    pixels[3] = alpha;
+            }
+        }
+
+        static void fill(sf::Uint8* pixels, std::size_t count, sf::Uint32 color)
+        {
+            for (std::size_t i = 0; i < count; ++i, pixels += 4)
+                std::memcpy(pixels, &color, 4);
+        }
+
+        static void premultiply(sf::Uint8* pixels, std::size_t count)
+        {
+            for (std::size_t i = 0; i < count; ++i, pixels += 4)
+            {
+                for (int c = 0; c < 3; ++c)
+                    pixels[c] = static_cast<sf::Uint8>((pixels[c] * pixels[3] + 127) / 255);
+            }
+        }
+
+        // Transparent pixels have lost their color, they are left as they are
+        static void unpremultiply(sf::Uint8* pixels, std::size_t count)
+        {
+            for (std::size_t i = 0; i < count; ++i, pixels += 4)
+            {
+                int alpha = pixels[3];
+                if (alpha == 0)
+                    continue;
+
+                for (int c = 0; c < 3; ++c)
+                    pixels[c] = static_cast<sf::Uint8>(std::min(255, (pixels[c] * 255 + alpha / 2) / alpha));
+            }
+        }
+
+        static void reverse(sf::Uint8* pixels, std::size_t count)
+        {
+            if (count < 2)
+                return;
+
+            sf::Uint8* left  = pixels;
+            sf::Uint8* right = pixels + (count - 1) * 4;
+            for (; left < right; left += 4, right -= 4)
+                std::swap_ranges(left, left + 4, right);
+        }
+
+        static void swap(sf::Uint8* left, sf::Uint8* right, std::size_t count)
+        {
+            std::swap_ranges(left, left + count * 4, right);
+        }
+
+        // Weighted sum in fixed point, rounded down to an integer
+        static int descale(int sum)
+        {
+            sum += 1 << (sf::priv::resampleBits - 1);
+            return sum < 0 ? 0 : sum >> sf::priv::resampleBits;
+        }
+
+        static void resampleRow(const sf::Uint8* src, sf::Uint16* dst, std::size_t count, const unsigned int* starts, const sf::Int16* weights, std::size_t taps)
+        {
+            for (std::size_t i = 0; i < count; ++i, dst += 4, weights += taps)
+            {
+                const sf::Uint8* pixels = src + starts[i] * 4;
+                int sums[4] = {0, 0, 0, 0};
+                for (std::size_t k = 0; k < taps; ++k)
+                {
+                    const sf::Uint8* pixel = pixels + k * 4;
+                    for (int c = 0; c < 3; ++c)
+                        sums[c] += weights[k] * (pixel[c] * pixel[3]);
+                    sums[3] += weights[k] * (pixel[3] * 255);
+                }
+
+                for (int c = 0; c < 4; ++c)
+                    dst[c] = static_cast<sf::Uint16>(std::min(descale(sums[c]), 65535));
+            }
+        }
+
+        // Clamp the premultiplied sums of a pixel and divide its colors by alpha. This
+        // is done in float so that the vector kernels can do exactly the same; all the
+        // values are integers below 2^24 so the only rounding is the one of the division.
+        static void unpremultiplySums(const int* sums, sf::Uint8* dst)
+        {
+            float alpha = std::min(std::max(static_cast<float>(sums[3]), 0.f), 255.f * 255.f);
+            for (int c = 0; c < 4; ++c)
+            {
+                float value   = std::min(std::max(static_cast<float>(sums[c]), 0.f), alpha);
+                float divisor = std::max(alpha, c < 3 ? 1.f : 255.f * 255.f);
+                dst[c] = static_cast<sf::Uint8>(value * 255.f / divisor + 0.5f);
+            }
+        }
+
+        static void resampleColumn(const sf::Uint16* src, std::size_t stride, sf::Uint8* dst, std::size_t count, const sf::Int16* weights, std::size_t taps)
+        {
+            for (std::size_t i = 0; i < count; ++i, src += 4, dst += 4)
+            {
+                int sums[4] = {0, 0, 0, 0};
+                for (std::size_t k = 0; k < taps; ++k)
+                {
+                    for (int c = 0; c < 4; ++c)
+                        sums[c] += weights[k] * src[k * stride + c];
+                }
+
+                for (int c = 0; c < 4; ++c)
+                    sums[c] = descale(sums[c]);
+                unpremultiplySums(sums, dst);
+            }
+        }
+
+        static sf::priv::ImageKernels get()
+        {
+            sf::priv::ImageKernels kernels;
+            kernels.composite      = &composite;
+            kernels.copyColorKeyed = &copyColorKeyed;
+            kernels.mask           = &mask;
+            kernels.fill           = &fill;
+            kernels.premultiply    = &premultiply;
+            kernels.unpremultiply  = &unpremultiply;
+            kernels.reverse        = &reverse;
+            kernels.swap           = &swap;
+            kernels.resampleRow    = &resampleRow;
+            kernels.resampleColumn = &resampleColumn;
+            return kernels;
+        }
+    };
+
+#ifdef SFML_IMAGE_KERNELS_SSE2
+
+    // Vector operations for ImageKernels.inl, 4 pixels per register
+    struct Sse2
+    {
+        typedef __m128i Vector;
+        enum {PixelCount = 4};
+
+        static Vector load(const sf::Uint8* pixels)                {return _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels));}
+        static void   store(sf::Uint8* pixels, Vector value)       {_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels), value);}
+        static Vector set32(sf::Uint32 value)                      {return _mm_set1_epi32(static_cast<int>(value));}
+        static Vector set16(sf::Uint16 value)                      {return _mm_set1_epi16(static_cast<short>(value));}
+        static Vector colorLanes()                                 {return _mm_set_epi32(0x0000FFFF, -1, 0x0000FFFF, -1);}
+        static Vector unpackLow(Vector value)                      {return _mm_unpacklo_epi8(value, _mm_setzero_si128());}
+        static Vector unpackHigh(Vector value)                     {return _mm_unpackhi_epi8(value, _mm_setzero_si128());}
+        static Vector pack(Vector low, Vector high)                {return _mm_packus_epi16(low, high);}
+        static Vector add16(Vector left, Vector right)             {return _mm_add_epi16(left, right);}
+        static Vector sub16(Vector left, Vector right)             {return _mm_sub_epi16(left, right);}
+        static Vector mul16(Vector left, Vector right)             {return _mm_mullo_epi16(left, right);}
+        static Vector shift8(Vector value)                         {return _mm_srli_epi16(value, 8);}
+        static Vector addSat16(Vector left, Vector right)          {return _mm_adds_epu16(left, right);}
+        static Vector subSat16(Vector left, Vector right)          {return _mm_subs_epu16(left, right);}
+        static Vector bitAnd(Vector left, Vector right)            {return _mm_and_si128(left, right);}
+        static Vector bitOr(Vector left, Vector right)             {return _mm_or_si128(left, right);}
+        static Vector bitAndNot(Vector left, Vector right)         {return _mm_andnot_si128(left, right);}
+        static Vector equal32(Vector left, Vector right)           {return _mm_cmpeq_epi32(left, right);}
+        static Vector broadcastAlpha(Vector value)                 {return _mm_shufflehi_epi16(_mm_shufflelo_epi16(value, 0xFF), 0xFF);}
+        static Vector reverse(Vector value)                        {return _mm_shuffle_epi32(value, 0x1B);}
+        static Vector interleaveLow16(Vector left, Vector right)   {return _mm_unpacklo_epi16(left, right);}
+        static Vector interleaveHigh16(Vector left, Vector right)  {return _mm_unpackhi_epi16(left, right);}
+        static Vector multiplyAdd16(Vector left, Vector right)     {return _mm_madd_epi16(left, right);}
+        static Vector add32(Vector left, Vector right)             {return _mm_add_epi32(left, right);}
+        static Vector shiftRight32(Vector value, int bits)         {return _mm_srai_epi32(value, bits);}
+        static Vector pack32(Vector low, Vector high)              {return _mm_packs_epi32(low, high);}
+        static Vector loadLow16(const sf::Uint16* pixels)          {return _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels));}
+        static Vector loadHigh16(const sf::Uint16* pixels)         {return _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + 8));}
+        static Vector broadcastAlpha32(Vector value)               {return _mm_shuffle_epi32(value, 0xFF);}
+
+        typedef __m128 FloatVector;
+        static FloatVector toFloat(Vector value)                             {return _mm_cvtepi32_ps(value);}
+        static Vector      truncate(FloatVector value)                       {return _mm_cvttps_epi32(value);}
+        static FloatVector setFloat(float value)                             {return _mm_set1_ps(value);}
+        static FloatVector setFloats(float color, float alpha)               {return _mm_set_ps(alpha, color, color, color);}
+        static FloatVector addFloat(FloatVector left, FloatVector right)     {return _mm_add_ps(left, right);}
+        static FloatVector mulFloat(FloatVector left, FloatVector right)     {return _mm_mul_ps(left, right);}
+        static FloatVector divFloat(FloatVector left, FloatVector right)     {return _mm_div_ps(left, right);}
+        static FloatVector minFloat(FloatVector left, FloatVector right)     {return _mm_min_ps(left, right);}
+        static FloatVector maxFloat(FloatVector left, FloatVector right)     {return _mm_max_ps(left, right);}
+    };
+
+    // Premultiplied components of 2 pixels in 16-bit lanes: c * a for the colors and a * 255
+    // for alpha, less 32768 so that madd can take them as signed (see resampleColumn)
+    __m128i premultiplyPair(__m128i pixels)
+    {
+        const __m128i colors = _mm_set_epi32(0x0000FFFF, -1, 0x0000FFFF, -1);
+        const __m128i opaque = _mm_set_epi32(0x00FF0000, 0, 0x00FF0000, 0);
+
+        __m128i alpha   = _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels, 0xFF), 0xFF);
+        __m128i factors = _mm_or_si128(_mm_and_si128(colors, alpha), opaque);
+        return _mm_xor_si128(_mm_mullo_epi16(pixels, factors), _mm_set1_epi16(-32768));
+    }
+
+    // Weighted sum of the components of 2 pixels, as 32-bit lanes. The 16-bit components
+    // of the pixels are interleaved so that madd multiplies and adds them pairwise.
+    __m128i resamplePair(__m128i pixels, sf::Int16 first, sf::Int16 second)
+    {
+        __m128i components = premultiplyPair(pixels);
+        components = _mm_unpacklo_epi16(components, _mm_srli_si128(components, 8));
+        return _mm_madd_epi16(components, _mm_set1_epi32(static_cast<int>(sf::priv::packWeights(first, second))));
+    }
+
+    // There's no room for more than one pixel per register in a row, so the row pass
+    // is SSE2 only: each target pixel sums its taps 4, 2 then 1 at a time. The sums
+    // start at 32768 times the weights, which add up to 1, to make up for the signed madd.
+    void resampleRowSse2(const sf::Uint8* src, sf::Uint16* dst, std::size_t count, const unsigned int* starts, const sf::Int16* weights, std::size_t taps)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i bias = _mm_set1_epi32(32768);
+
+        for (std::size_t i = 0; i < count; ++i, dst += 4, weights += taps)
+        {
+            const sf::Uint8* pixels = src + starts[i] * 4;
+            __m128i sum = _mm_set1_epi32((32768 << sf::priv::resampleBits) + (1 << (sf::priv::resampleBits - 1)));
+
+            std::size_t k = 0;
+            for (; k + 4 <= taps; k += 4)
+            {
+                __m128i four = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + k * 4));
+                sum = _mm_add_epi32(sum, resamplePair(_mm_unpacklo_epi8(four, zero), weights[k], weights[k + 1]));
+                sum = _mm_add_epi32(sum, resamplePair(_mm_unpackhi_epi8(four, zero), weights[k + 2], weights[k + 3]));
+            }
+            if (k + 2 <= taps)
+            {
+                __m128i two = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pixels + k * 4));
+                sum = _mm_add_epi32(sum, resamplePair(_mm_unpacklo_epi8(two, zero), weights[k], weights[k + 1]));
+                k += 2;
+            }
+            if (k < taps)
+            {
+                int one;
+                std::memcpy(&one, pixels + k * 4, 4);
+                sum = _mm_add_epi32(sum, resamplePair(_mm_unpacklo_epi8(_mm_cvtsi32_si128(one), zero), weights[k], 0));
+            }
+
+            // Clamped to [0, 65535] by the signed pack, around 32768
+            __m128i result = _mm_sub_epi32(_mm_srai_epi32(sum, sf::priv::resampleBits), bias);
+            result = _mm_xor_si128(_mm_packs_epi32(result, result), _mm_set1_epi16(-32768));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), result);
+        }
+    }
+
+    // Does the processor and the OS support AVX2?
+    bool hasAvx2()
+    {
+    #if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+
+        // The OS must save the YMM registers (OSXSAVE and AVX, then XCR0)
+        __cpuid(info, 1);
+        if (((info[2] & (1 << 27)) == 0) || ((info[2] & (1 << 28)) == 0))
+            return false;
+        if ((_xgetbv(0) & 6) != 6)
+            return false;
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+    #elif defined(__GNUC__)
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+    #else
+        return false;
+    #endif
+    }
+
+#endif
+}
+
+#ifdef SFML_IMAGE_KERNELS_SSE2
+    #include <SFML/Graphics/ImageKernels.inl>
+#endif
+
+
+namespace
+{
+    // Pick the kernels once
+    sf::priv::ImageKernels selectKernels()
+    {
+        sf::priv::ImageKernels kernels = ScalarImageKernels::get();
+
+    #ifdef SFML_IMAGE_KERNELS_SSE2
+        SimdImageKernels<Sse2>::load(kernels);
+        kernels.resampleRow = &resampleRowSse2;
+        if (hasAvx2())
+            sf::priv::loadAvx2ImageKernels(kernels);
+    #endif
+
+        return kernels;
+    }
+}
+
+
+namespace sf
+{
+namespace priv
+{
+////////////////////////////////////////////////////////////
+const ImageKernels& getImageKernels()
+{
+    static const ImageKernels kernels = selectKernels();
+    return kernels;
+}
+
+
+////////////////////////////////////////////////////////////
+const ImageKernels& getScalarImageKernels()
+{
+    static const ImageKernels kernels = ScalarImageKernels::get();
+    return kernels;
+}
+
+
+////////////////////////////////////////////////////////////
+Uint32 makePixel(Uint8 r, Uint8 g, Uint8 b, Uint8 a)
+{
+    Uint8 components[4] = {r, g, b, a};
+    Uint32 pixel;
+    std::memcpy(&pixel, components, 4);
+    return pixel;
+}
+
+} // namespace priv
+
+} // namespace sf
@@ -0,0 +1,201 @@
+////////////////////////////////////////////////////////////
+//
+// SFML - Simple and Fast Multimedia Library
+// Copyright (C) 2007-2018 Laurent Gomila (laurent@sfml-dev.org)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef SFML_IMAGEKERNELS_HPP
+#define SFML_IMAGEKERNELS_HPP
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include <SFML/Config.hpp>
+#include <cstddef>
+
+
+namespace sf
+{
+namespace priv
+{
+////////////////////////////////////////////////////////////
+/// Number of fractional bits of the resampling weights,
+/// a weight of 1 << resampleBits is 1
+////////////////////////////////////////////////////////////
+const int resampleBits = 14;
+
+////////////////////////////////////////////////////////////
+/// \brief Blending setup of a composite, see sf::BlendMode
+///
+/// The factors and equations are the values of the
+/// sf::BlendMode enums.
+///
+////////////////////////////////////////////////////////////
+struct CompositeMode
+{
+    int colorSrcFactor; ///< Source blending factor for the color channels
+    int colorDstFactor; ///< Destination blending factor for the color channels
+    int colorEquation;  ///< Blending equation for the color channels
+    int alphaSrcFactor; ///< Source blending factor for the alpha channel
+    int alphaDstFactor; ///< Destination blending factor for the alpha channel
+    int alphaEquation;  ///< Blending equation for the alpha channel
+};
+
+////////////////////////////////////////////////////////////
+/// \brief Pixel loops used by sf::Image
+///
+/// Every function processes \a count consecutive RGBA pixels.
+/// There is a plain C++ version of each, and SSE2 and AVX2
+/// versions of the ones that are worth it; the vector versions
+/// produce exactly the same bytes as the plain ones.
+///
+/// Colors are passed as 32-bit values holding the R, G, B
+/// and A bytes in memory order (see makePixel).
+///
+////////////////////////////////////////////////////////////
+struct ImageKernels
+{
+    ////////////////////////////////////////////////////////////
+    /// Blend source pixels onto destination pixels:
+    /// dst = clamp((src * srcFactor (+/-) dst * dstFactor) / 255)
+    ////////////////////////////////////////////////////////////
+    void (*composite)(const Uint8* src, Uint8* dst, std::size_t count, const CompositeMode& mode);
+
+    ////////////////////////////////////////////////////////////
+    /// Copy the source pixels that are not \a key
+    ////////////////////////////////////////////////////////////
+    void (*copyColorKeyed)(const Uint8* src, Uint8* dst, std::size_t count, Uint32 key);
+
+    ////////////////////////////////////////////////////////////
+    /// Set the alpha of the pixels that are \a key to \a alpha
+    ////////////////////////////////////////////////////////////
+    void (*mask)(Uint8* pixels, std::size_t count, Uint32 key, Uint8 alpha);
+
+    ////////////////////////////////////////////////////////////
+    /// Set all the pixels to \a color
+    ////////////////////////////////////////////////////////////
+    void (*fill)(Uint8* pixels, std::size_t count, Uint32 color);
+
+    ////////////////////////////////////////////////////////////
+    /// Multiply the color channels by alpha, rounded to nearest
+    ////////////////////////////////////////////////////////////
+    void (*premultiply)(Uint8* pixels, std::size_t count);
+
+    ////////////////////////////////////////////////////////////
+    /// Divide the color channels by alpha, rounded to nearest
+    ////////////////////////////////////////////////////////////
+    void (*unpremultiply)(Uint8* pixels, std::size_t count);
+
+    ////////////////////////////////////////////////////////////
+    /// Reverse the order of the pixels
+    ////////////////////////////////////////////////////////////
+    void (*reverse)(Uint8* pixels, std::size_t count);
+
+    ////////////////////////////////////////////////////////////
+    /// Exchange two ranges of pixels, which must not overlap
+    ////////////////////////////////////////////////////////////
+    void (*swap)(Uint8* left, Uint8* right, std::size_t count);
+
+    ////////////////////////////////////////////////////////////
+    /// Resample a row and premultiply it: pixel i of \a dst is
+    /// the sum of the \a taps source pixels from starts[i],
+    /// weighted by the \a taps weights from weights[i * taps],
+    /// rounded and clamped to [0, 65535]. The source pixels are
+    /// taken as c * a for the colors and a * 255 for alpha, so
+    /// that nothing is lost before the column pass.
+    ////////////////////////////////////////////////////////////
+    void (*resampleRow)(const Uint8* src, Uint16* dst, std::size_t count, const unsigned int* starts, const Int16* weights, std::size_t taps);
+
+    ////////////////////////////////////////////////////////////
+    /// Resample a column of premultiplied pixels (see
+    /// resampleRow) and unpremultiply it: pixel i of \a dst is
+    /// the sum of the pixels i of the \a taps rows from \a src,
+    /// \a stride components apart, weighted by \a weights,
+    /// with the colors divided by alpha, rounded to nearest.
+    /// The weights must add up to 1 << resampleBits.
+    ////////////////////////////////////////////////////////////
+    void (*resampleColumn)(const Uint16* src, std::size_t stride, Uint8* dst, std::size_t count, const Int16* weights, std::size_t taps);
+};
+
+////////////////////////////////////////////////////////////
+/// \brief Get the fastest pixel loops the processor supports
+///
+/// The processor is checked on the first call.
+///
+/// \return Pixel loops
+///
+////////////////////////////////////////////////////////////
+const ImageKernels& getImageKernels();
+
+////////////////////////////////////////////////////////////
+/// \brief Get the plain C++ pixel loops
+///
+/// \return Pixel loops that don't use vector instructions
+///
+////////////////////////////////////////////////////////////
+const ImageKernels& getScalarImageKernels();
+
+////////////////////////////////////////////////////////////
+/// \brief Replace the kernels that have an AVX2 version
+///
+/// Defined in ImageKernelsAvx2.cpp, which is compiled for
+/// AVX2. It must only be called if the processor supports it.
+///
+/// \param kernels Pixel loops to update
+///
+/// \return True if the AVX2 versions are available in this build
+///
+////////////////////////////////////////////////////////////
+bool loadAvx2ImageKernels(ImageKernels& kernels);
+
+////////////////////////////////////////////////////////////
+/// \brief Pack the components of a color into a pixel
+///
+/// \param r Red component
+/// \param g Green component
+/// \param b Blue component
+/// \param a Alpha component
+///
+/// \return The four bytes in memory order
+///
+////////////////////////////////////////////////////////////
+Uint32 makePixel(Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+
+////////////////////////////////////////////////////////////
+/// \brief Pack two resampling weights into 32 bits
+///
+/// \param first  Weight in the low 16 bits
+/// \param second Weight in the high 16 bits
+///
+/// \return The weights as a pair of 16-bit lanes
+///
+////////////////////////////////////////////////////////////
+inline Uint32 packWeights(Int16 first, Int16 second)
+{
+    return (static_cast<Uint32>(static_cast<Uint16>(second)) << 16) | static_cast<Uint16>(first);
+}
+
+} // namespace priv
+
+} // namespace sf
+
+
+#endif // SFML_IMAGEKERNELS_HPP
@@ -0,0 +1,308 @@
+////////////////////////////////////////////////////////////
+//
+// SFML - Simple and Fast Multimedia Library
+// Copyright (C) 2007-2018 Laurent Gomila (laurent@sfml-dev.org)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+
+////////////////////////////////////////////////////////////
+// Vector versions of the image kernels, written once against a set of
+// vector operations (V) and instantiated for SSE2 and AVX2 by the files
+// that include this one. V provides:
+//   Vector, PixelCount                  register type and number of RGBA pixels it holds
+//   load, store                         unaligned memory access
+//   set32, set16                        broadcast a 32-bit or 16-bit value
+//   colorLanes                          16-bit lanes of the color channels set, alpha lanes clear
+//   unpackLow, unpackHigh, pack         bytes <-> 16-bit lanes (pack saturates)
+//   add16, sub16, mul16, shift8         16-bit arithmetic
+//   addSat16, subSat16                  unsigned saturated 16-bit arithmetic
+//   bitAnd, bitOr, bitAndNot            bitwise operations (bitAndNot(a, b) = ~a & b)
+//   equal32                             32-bit comparison
+//   broadcastAlpha                      copy the alpha lane of each pixel to its other lanes
+//   reverse                             reverse the order of the pixels
+//   interleaveLow16, interleaveHigh16   interleave the 16-bit lanes of two vectors
+//   multiplyAdd16                       multiply 16-bit lanes and add adjacent products into 32-bit lanes
+//   add32, shiftRight32, pack32         32-bit arithmetic (arithmetic shift, pack saturates to 16-bit)
+//   loadLow16, loadHigh16               16-bit pixels, in the lanes unpackLow and unpackHigh would put them
+//   broadcastAlpha32                    broadcastAlpha for pixels in 32-bit lanes
+//   FloatVector, toFloat, truncate      float lanes and 32-bit <-> float conversions
+//   setFloat, setFloats                 broadcast a float, or one for the color lanes and one for alpha
+//   addFloat, mulFloat, divFloat        float arithmetic
+//   minFloat, maxFloat                  float minimum and maximum
+// The results must be the same as the ones of the scalar kernels, which
+// also handle the pixels that don't fill a whole vector.
+////////////////////////////////////////////////////////////
+
+namespace
+{
+template <typename V>
+struct SimdImageKernels
+{
+    typedef typename V::Vector Vector;
+
+    // Blending factor in 16-bit lanes, see sf::BlendMode::Factor
+    static Vector factor(int which, Vector src, Vector dst, Vector srcAlpha, Vector dstAlpha)
+    {
+        const Vector full = V::set16(255);
+
+        switch (which)
+        {
+            case 0:  return V::set16(0);                   // Zero
+            case 1:  return full;                          // One
+            case 2:  return src;                           // SrcColor
+            case 3:  return V::sub16(full, src);           // OneMinusSrcColor
+            case 4:  return dst;                           // DstColor
+            case 5:  return V::sub16(full, dst);           // OneMinusDstColor
+            case 6:  return srcAlpha;                      // SrcAlpha
+            case 7:  return V::sub16(full, srcAlpha);      // OneMinusSrcAlpha
+            case 8:  return dstAlpha;                      // DstAlpha
+            default: return V::sub16(full, dstAlpha);      // OneMinusDstAlpha
+        }
+    }
+
+    // Blending equation on products of at most 255 * 255, see sf::BlendMode::Equation.
+    // Sums are clamped to 255 * 255 so that the division can't overflow.
+    static Vector equation(int which, Vector srcTerm, Vector dstTerm)
+    {
+        switch (which)
+        {
+            case 0:
+            {
+                Vector sum = V::addSat16(srcTerm, dstTerm);
+                return V::sub16(sum, V::subSat16(sum, V::set16(255 * 255)));
+            }
+            case 1:  return V::subSat16(srcTerm, dstTerm);
+            default: return V::subSat16(dstTerm, srcTerm);
+        }
+    }
+
+    // Take the color lanes of the first vector and the alpha lanes of the second one
+    static Vector select(Vector colors, Vector alphas)
+    {
+        const Vector mask = V::colorLanes();
+        return V::bitOr(V::bitAnd(mask, colors), V::bitAndNot(mask, alphas));
+    }
+
+    // x / 255 rounded down, exact for x <= 255 * 255
+    static Vector divide255(Vector x)
+    {
+        return V::shift8(V::add16(V::add16(x, V::shift8(x)), V::set16(1)));
+    }
+
+    static Vector blend(Vector src, Vector dst, const sf::priv::CompositeMode& mode)
+    {
+        Vector srcAlpha = V::broadcastAlpha(src);
+        Vector dstAlpha = V::broadcastAlpha(dst);
+
+        Vector srcFactor = factor(mode.colorSrcFactor, src, dst, srcAlpha, dstAlpha);
+        Vector dstFactor = factor(mode.colorDstFactor, src, dst, srcAlpha, dstAlpha);
+        if (mode.alphaSrcFactor != mode.colorSrcFactor)
+            srcFactor = select(srcFactor, factor(mode.alphaSrcFactor, src, dst, srcAlpha, dstAlpha));
+        if (mode.alphaDstFactor != mode.colorDstFactor)
+            dstFactor = select(dstFactor, factor(mode.alphaDstFactor, src, dst, srcAlpha, dstAlpha));
+
+        Vector srcTerm = V::mul16(src, srcFactor);
+        Vector dstTerm = V::mul16(dst, dstFactor);
+
+        Vector result = equation(mode.colorEquation, srcTerm, dstTerm);
+        if (mode.alphaEquation != mode.colorEquation)
+            result = select(result, equation(mode.alphaEquation, srcTerm, dstTerm));
+
+        return divide255(result);
+    }
+
+    static void composite(const sf::Uint8* src, sf::Uint8* dst, std::size_t count, const sf::priv::CompositeMode& mode)
+    {
+        std::size_t i = 0;
+        for (; i + V::PixelCount <= count; i += V::PixelCount)
+        {
+            Vector source      = V::load(src + i * 4);
+            Vector destination = V::load(dst + i * 4);
+
+            Vector low  = blend(V::unpackLow(source),  V::unpackLow(destination),  mode);
+            Vector high = blend(V::unpackHigh(source), V::unpackHigh(destination), mode);
+            V::store(dst + i * 4, V::pack(low, high));
+        }
+
+        sf::priv::getScalarImageKernels().composite(src + i * 4, dst + i * 4, count - i, mode);
+    }
+
+    static void copyColorKeyed(const sf::Uint8* src, sf::Uint8* dst, std::size_t count, sf::Uint32 key)
+    {
+        const Vector keys = V::set32(key);
+
+        std::size_t i = 0;
+        for (; i + V::PixelCount <= count; i += V::PixelCount)
+        {
+            Vector source = V::load(src + i * 4);
+            Vector skip   = V::equal32(source, keys);
+            V::store(dst + i * 4, V::bitOr(V::bitAnd(skip, V::load(dst + i * 4)), V::bitAndNot(skip, source)));
+        }
+
+        sf::priv::getScalarImageKernels().copyColorKeyed(src + i * 4, dst + i * 4, count - i, key);
+    }
+
+    static void mask(sf::Uint8* pixels, std::size_t count, sf::Uint32 key, sf::Uint8 alpha)
+    {
+        const Vector keys      = V::set32(key);
+        const Vector alphaMask = V::set32(sf::priv::makePixel(0, 0, 0, 255));
+        const Vector newAlpha  = V::set32(sf::priv::makePixel(0, 0, 0, alpha));
+
+        std::size_t i = 0;
+        for (; i + V::PixelCount <= count; i += V::PixelCount)
+        {
+            Vector pixel   = V::load(pixels + i * 4);
+            Vector replace = V::bitAnd(V::equal32(pixel, keys), alphaMask);
+            V::store(pixels + i * 4, V::bitOr(V::bitAndNot(replace, pixel), V::bitAnd(replace, newAlpha)));
+        }
+
+        sf::priv::getScalarImageKernels().mask(pixels + i * 4, count - i, key, alpha);
+    }
+
+    static void fill(sf::Uint8* pixels, std::size_t count, sf::Uint32 color)
+    {
+        const Vector colors = V::set32(color);
+
+        std::size_t i = 0;
+        for (; i + V::PixelCount <= count; i += V::PixelCount)
+            V::store(pixels + i * 4, colors);
+
+        sf::priv::getScalarImageKernels().fill(pixels + i * 4, count - i, color);
+    }
+
+    // c * a / 255 rounded to nearest, the alpha lanes are multiplied by 255 so they stay the same
+    static Vector premultiplyLanes(Vector pixels)
+    {
+        Vector product = V::mul16(pixels, select(V::broadcastAlpha(pixels), V::set16(255)));
+        Vector biased  = V::add16(product, V::set16(128));
+        return V::shift8(V::add16(biased, V::shift8(biased)));
+    }
+
+    static void premultiply(sf::Uint8* pixels, std::size_t count)
+    {
+        std::size_t i = 0;
+        for (; i + V::PixelCount <= count; i += V::PixelCount)
+        {
+            Vector pixel = V::load(pixels + i * 4);
+            V::store(pixels + i * 4, V::pack(premultiplyLanes(V::unpackLow(pixel)), premultiplyLanes(V::unpackHigh(pixel))));
+        }
+
+        sf::priv::getScalarImageKernels().premultiply(pixels + i * 4, count - i);
+    }
+
+    // Swap vectors from both ends towards the middle, what's left in the middle is reversed by the scalar loop
+    static void reverse(sf::Uint8* pixels, std::size_t count)
+    {
+        std::size_t left  = 0;
+        std::size_t right = count;
+        while (right - left >= 2 * V::PixelCount)
+        {
+            Vector first = V::load(pixels + left * 4);
+            Vector last  = V::load(pixels + (right - V::PixelCount) * 4);
+            V::store(pixels + left * 4, V::reverse(last));
+            V::store(pixels + (right - V::PixelCount) * 4, V::reverse(first));
+
+            left  += V::PixelCount;
+            right -= V::PixelCount;
+        }
+
+        sf::priv::getScalarImageKernels().reverse(pixels + left * 4, right - left);
+    }
+
+    static void swap(sf::Uint8* left, sf::Uint8* right, std::size_t count)
+    {
+        std::size_t i = 0;
+        for (; i + V::PixelCount <= count; i += V::PixelCount)
+        {
+            Vector first  = V::load(left + i * 4);
+            Vector second = V::load(right + i * 4);
+            V::store(left + i * 4, second);
+            V::store(right + i * 4, first);
+        }
+
+        sf::priv::getScalarImageKernels().swap(left + i * 4, right + i * 4, count - i);
+    }
+
+    // Clamp the premultiplied sums of pixels in 32-bit lanes and divide their colors by
+    // alpha, see the unpremultiplySums of the scalar kernels which this has to match
+    static Vector unpremultiplySums(Vector sums)
+    {
+        typedef typename V::FloatVector FloatVector;
+
+        FloatVector alpha   = V::minFloat(V::maxFloat(V::toFloat(V::broadcastAlpha32(sums)), V::setFloat(0.f)), V::setFloat(255.f * 255.f));
+        FloatVector value   = V::minFloat(V::maxFloat(V::toFloat(sums), V::setFloat(0.f)), alpha);
+        FloatVector divisor = V::maxFloat(alpha, V::setFloats(1.f, 255.f * 255.f));
+        return V::truncate(V::addFloat(V::divFloat(V::mulFloat(value, V::setFloat(255.f)), divisor), V::setFloat(0.5f)));
+    }
+
+    // Rows are taken in pairs, so that each multiplyAdd16 weights and adds two of them. The
+    // components are moved down by 32768 to fit in signed lanes, and the sums start at 32768
+    // times the weights, which add up to 1, to make up for it.
+    static void resampleColumn(const sf::Uint16* src, std::size_t stride, sf::Uint8* dst, std::size_t count, const sf::Int16* weights, std::size_t taps)
+    {
+        const Vector start = V::set32((32768 << sf::priv::resampleBits) + (1 << (sf::priv::resampleBits - 1)));
+        const Vector bias  = V::set16(32768);
+
+        std::size_t i = 0;
+        for (; i + V::PixelCount <= count; i += V::PixelCount)
+        {
+            Vector sums[4] = {start, start, start, start};
+            for (std::size_t k = 0; k < taps; k += 2)
+            {
+                // A last odd row is paired with itself and a zero weight
+                bool              pair   = k + 1 < taps;
+                Vector            weight = V::set32(sf::priv::packWeights(weights[k], pair ? weights[k + 1] : 0));
+                const sf::Uint16* first  = src + k * stride + i * 4;
+                const sf::Uint16* second = pair ? first + stride : first;
+
+                Vector firstLow   = V::sub16(V::loadLow16(first), bias);
+                Vector secondLow  = V::sub16(V::loadLow16(second), bias);
+                Vector firstHigh  = V::sub16(V::loadHigh16(first), bias);
+                Vector secondHigh = V::sub16(V::loadHigh16(second), bias);
+                sums[0] = V::add32(sums[0], V::multiplyAdd16(V::interleaveLow16(firstLow, secondLow), weight));
+                sums[1] = V::add32(sums[1], V::multiplyAdd16(V::interleaveHigh16(firstLow, secondLow), weight));
+                sums[2] = V::add32(sums[2], V::multiplyAdd16(V::interleaveLow16(firstHigh, secondHigh), weight));
+                sums[3] = V::add32(sums[3], V::multiplyAdd16(V::interleaveHigh16(firstHigh, secondHigh), weight));
+            }
+
+            for (int j = 0; j < 4; ++j)
+                sums[j] = unpremultiplySums(V::shiftRight32(sums[j], sf::priv::resampleBits));
+
+            V::store(dst + i * 4, V::pack(V::pack32(sums[0], sums[1]), V::pack32(sums[2], sums[3])));
+        }
+
+        sf::priv::getScalarImageKernels().resampleColumn(src + i * 4, stride, dst + i * 4, count - i, weights, taps);
+    }
+
+    // Replace the kernels that have a vector version
+    static void load(sf::priv::ImageKernels& kernels)
+    {
+        kernels.composite      = &composite;
+        kernels.copyColorKeyed = &copyColorKeyed;
+        kernels.mask           = &mask;
+        kernels.fill           = &fill;
+        kernels.premultiply    = &premultiply;
+        kernels.reverse        = &reverse;
+        kernels.swap           = &swap;
+        kernels.resampleColumn = &resampleColumn;
+    }
+};
+}
@@ -0,0 +1,143 @@
+////////////////////////////////////////////////////////////
+//
+// SFML - Simple and Fast Multimedia Library
+// Copyright (C) 2007-2018 Laurent Gomila (laurent@sfml-dev.org)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include <SFML/Graphics/ImageKernels.hpp>
+
+// Only this file is compiled for AVX2, the kernels are only called after
+// checking that the processor supports it (see ImageKernels.cpp).
+// Everything that isn't AVX2 specific must be included above this point,
+// so that no inline function shared with other files is compiled for AVX2.
+#if defined(_M_X64) || defined(__x86_64__)
+    #if defined(_MSC_VER)
+        #define SFML_IMAGE_KERNELS_AVX2
+        #include <immintrin.h>
+    #elif defined(__clang__)
+        #define SFML_IMAGE_KERNELS_AVX2
+        #include <immintrin.h>
+        #pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+    #elif defined(__GNUC__)
+        #define SFML_IMAGE_KERNELS_AVX2
+        #include <immintrin.h>
+        #pragma GCC push_options
+        #pragma GCC target("avx2")
+    #endif
+#endif
+
+
+#ifdef SFML_IMAGE_KERNELS_AVX2
+
+namespace
+{
+    // Vector operations for ImageKernels.inl, 8 pixels per register. Unpacking and
+    // packing work on each 128-bit half separately, which is fine as they undo each other;
+    // loadLow16 and loadHigh16 swap the middle pixels so that packing puts them back.
+    struct Avx2
+    {
+        typedef __m256i Vector;
+        enum {PixelCount = 8};
+
+        static Vector load(const sf::Uint8* pixels)                {return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels));}
+        static void   store(sf::Uint8* pixels, Vector value)       {_mm256_storeu_si256(reinterpret_cast<__m256i*>(pixels), value);}
+        static Vector set32(sf::Uint32 value)                      {return _mm256_set1_epi32(static_cast<int>(value));}
+        static Vector set16(sf::Uint16 value)                      {return _mm256_set1_epi16(static_cast<short>(value));}
+        static Vector colorLanes()                                 {return _mm256_set_epi32(0x0000FFFF, -1, 0x0000FFFF, -1, 0x0000FFFF, -1, 0x0000FFFF, -1);}
+        static Vector unpackLow(Vector value)                      {return _mm256_unpacklo_epi8(value, _mm256_setzero_si256());}
+        static Vector unpackHigh(Vector value)                     {return _mm256_unpackhi_epi8(value, _mm256_setzero_si256());}
+        static Vector pack(Vector low, Vector high)                {return _mm256_packus_epi16(low, high);}
+        static Vector add16(Vector left, Vector right)             {return _mm256_add_epi16(left, right);}
+        static Vector sub16(Vector left, Vector right)             {return _mm256_sub_epi16(left, right);}
+        static Vector mul16(Vector left, Vector right)             {return _mm256_mullo_epi16(left, right);}
+        static Vector shift8(Vector value)                         {return _mm256_srli_epi16(value, 8);}
+        static Vector addSat16(Vector left, Vector right)          {return _mm256_adds_epu16(left, right);}
+        static Vector subSat16(Vector left, Vector right)          {return _mm256_subs_epu16(left, right);}
+        static Vector bitAnd(Vector left, Vector right)            {return _mm256_and_si256(left, right);}
+        static Vector bitOr(Vector left, Vector right)             {return _mm256_or_si256(left, right);}
+        static Vector bitAndNot(Vector left, Vector right)         {return _mm256_andnot_si256(left, right);}
+        static Vector equal32(Vector left, Vector right)           {return _mm256_cmpeq_epi32(left, right);}
+        static Vector broadcastAlpha(Vector value)                 {return _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(value, 0xFF), 0xFF);}
+        static Vector reverse(Vector value)                        {return _mm256_permutevar8x32_epi32(value, _mm256_set_epi32(0, 1, 2, 3, 4, 5, 6, 7));}
+        static Vector interleaveLow16(Vector left, Vector right)   {return _mm256_unpacklo_epi16(left, right);}
+        static Vector interleaveHigh16(Vector left, Vector right)  {return _mm256_unpackhi_epi16(left, right);}
+        static Vector multiplyAdd16(Vector left, Vector right)     {return _mm256_madd_epi16(left, right);}
+        static Vector add32(Vector left, Vector right)             {return _mm256_add_epi32(left, right);}
+        static Vector shiftRight32(Vector value, int bits)         {return _mm256_srai_epi32(value, bits);}
+        static Vector pack32(Vector low, Vector high)              {return _mm256_packs_epi32(low, high);}
+        static Vector loadLow16(const sf::Uint16* pixels)          {return _mm256_permute2x128_si256(loadWide(pixels), loadWide(pixels + 16), 0x20);}
+        static Vector loadHigh16(const sf::Uint16* pixels)         {return _mm256_permute2x128_si256(loadWide(pixels), loadWide(pixels + 16), 0x31);}
+        static Vector broadcastAlpha32(Vector value)               {return _mm256_shuffle_epi32(value, 0xFF);}
+
+        typedef __m256 FloatVector;
+        static FloatVector toFloat(Vector value)                             {return _mm256_cvtepi32_ps(value);}
+        static Vector      truncate(FloatVector value)                       {return _mm256_cvttps_epi32(value);}
+        static FloatVector setFloat(float value)                             {return _mm256_set1_ps(value);}
+        static FloatVector setFloats(float color, float alpha)               {return _mm256_set_ps(alpha, color, color, color, alpha, color, color, color);}
+        static FloatVector addFloat(FloatVector left, FloatVector right)     {return _mm256_add_ps(left, right);}
+        static FloatVector mulFloat(FloatVector left, FloatVector right)     {return _mm256_mul_ps(left, right);}
+        static FloatVector divFloat(FloatVector left, FloatVector right)     {return _mm256_div_ps(left, right);}
+        static FloatVector minFloat(FloatVector left, FloatVector right)     {return _mm256_min_ps(left, right);}
+        static FloatVector maxFloat(FloatVector left, FloatVector right)     {return _mm256_max_ps(left, right);}
+
+    private:
+
+        static Vector loadWide(const sf::Uint16* pixels)           {return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels));}
+    };
+}
+
+#include <SFML/Graphics/ImageKernels.inl>
+
+#endif
+
+
+namespace sf
+{
+namespace priv
+{
+////////////////////////////////////////////////////////////
+bool loadAvx2ImageKernels(ImageKernels& kernels)
+{
+#ifdef SFML_IMAGE_KERNELS_AVX2
+    SimdImageKernels<Avx2>::load(kernels);
+    return true;
+#else
+    (void)kernels;
+    return false;
+#endif
+}
+
+} // namespace priv
+
+} // namespace sf
+
+
+#if defined(SFML_IMAGE_KERNELS_AVX2) && !defined(_MSC_VER)
+    #if defined(__clang__)
+        #pragma clang attribute pop
+    #else
+        #pragma GCC pop_options
+    #endif
+#endif
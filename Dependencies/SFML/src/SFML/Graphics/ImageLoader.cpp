@@ -33,6 +33,10 @@
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include <stb_image_write.h>
 #include <cctype>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
 
 
 namespace
@@ -61,6 +65,80 @@ namespace
         sf::InputStream* stream = static_cast<sf::InputStream*>(user);
         return stream->tell() >= stream->getSize();
     }
+
+    // Find the pixels of a raw RGBA image, which is a PAM file with 4 channels of 8 bits:
+    // text lines "KEY value" between "P7" and "ENDHDR", then the pixels as they are in memory.
+    // Returns the offset of the pixels, or 0 if the data is not such a file.
+    std::size_t findRawPixels(const sf::Uint8* data, std::size_t dataSize, sf::Vector2u& size)
+    {
+        const char* begin = reinterpret_cast<const char*>(data);
+        const char* end   = begin + dataSize;
+        if ((dataSize < 3) || (std::memcmp(begin, "P7\n", 3) != 0))
+            return 0;
+
+        unsigned long width    = 0;
+        unsigned long height   = 0;
+        unsigned long depth    = 0;
+        unsigned long maxValue = 0;
+        std::string   tupleType;
+        bool          complete = false;
+
+        const char* line = begin + 3;
+        while (line < end)
+        {
+            const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', static_cast<std::size_t>(end - line)));
+            if (!lineEnd)
+                return 0;
+
+            // Comments and empty lines have no key, unknown keys are skipped
+            std::istringstream stream(std::string(line, lineEnd));
+            std::string key;
+            stream >> key;
+            line = lineEnd + 1;
+
+            if (key == "WIDTH")
+                stream >> width;
+            else if (key == "HEIGHT")
+                stream >> height;
+            else if (key == "DEPTH")
+                stream >> depth;
+            else if (key == "MAXVAL")
+                stream >> maxValue;
+            else if (key == "TUPLTYPE")
+                stream >> tupleType;
+            else if (key == "ENDHDR")
+            {
+                complete = true;
+                break;
+            }
+        }
+
+        if (!complete || (depth != 4) || (maxValue != 255) || (!tupleType.empty() && (tupleType != "RGB_ALPHA")))
+            return 0;
+
+        // The pixels must all be there
+        std::size_t available = static_cast<std::size_t>(end - line) / 4;
+        if ((width == 0) || (height == 0) || (width > UINT_MAX) || (height > UINT_MAX) || (width > available / height))
+            return 0;
+
+        size.x = static_cast<unsigned int>(width);
+        size.y = static_cast<unsigned int>(height);
+        return static_cast<std::size_t>(line - begin);
+    }
+
+    // Save pixels as a raw RGBA image, see findRawPixels
+    bool writeRawImage(const std::string& filename, const sf::Uint8* pixels, const sf::Vector2u& size)
+    {
+        std::FILE* file = std::fopen(filename.c_str(), "wb");
+        if (!file)
+            return false;
+
+        std::size_t pixelsSize = static_cast<std::size_t>(size.x) * size.y * 4;
+        bool written = (std::fprintf(file, "P7\nWIDTH %u\nHEIGHT %u\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n", size.x, size.y) > 0) &&
+                       (std::fwrite(pixels, 1, pixelsSize, file) == pixelsSize);
+
+        return (std::fclose(file) == 0) && written;
+    }
 }
 
 
@@ -68,6 +146,29 @@ namespace sf
 {
 namespace priv
 {
+////////////////////////////////////////////////////////////
+LoadedPixels::LoadedPixels() :
+m_data   (NULL),
+m_decoded(NULL)
+{
+}
+
+
+////////////////////////////////////////////////////////////
+LoadedPixels::~LoadedPixels()
+{
+    if (m_decoded)
+        stbi_image_free(m_decoded);
+}
+
+
+////////////////////////////////////////////////////////////
+Uint8* LoadedPixels::getData() const
+{
+    return m_data;
+}
+
+
 ////////////////////////////////////////////////////////////
 ImageLoader& ImageLoader::getInstance()
 {
@@ -92,32 +193,43 @@ ImageLoader::~ImageLoader()
 
 
 ////////////////////////////////////////////////////////////
-bool ImageLoader::loadImageFromFile(const std::string& filename, std::vector<Uint8>& pixels, Vector2u& size)
+bool ImageLoader::loadImageFromFile(const std::string& filename, LoadedPixels& pixels, Vector2u& size)
 {
-    // Clear the array (just in case)
-    pixels.clear();
-
-    // Load the image and get a pointer to the pixels in memory
     int width = 0;
     int height = 0;
     int channels = 0;
-    unsigned char* ptr = stbi_load(filename.c_str(), &width, &height, &channels, STBI_rgb_alpha);
 
-    if (ptr)
+    // Map the file, so that it is read straight from the OS cache rather than through stdio buffers
+    MappedFile& file = pixels.m_file;
+    if (file.open(filename) && (file.getSize() <= static_cast<std::size_t>(INT_MAX)))
+    {
+        // Raw pixels are used from the mapping as they are
+        if (std::size_t offset = findRawPixels(file.getData(), file.getSize(), size))
+        {
+            pixels.m_data = file.getData() + offset;
+            return true;
+        }
+
+        // Decode the image, the file isn't needed afterwards
+        pixels.m_decoded = stbi_load_from_memory(file.getData(), static_cast<int>(file.getSize()), &width, &height, &channels, STBI_rgb_alpha);
+        file.close();
+    }
+    else
+    {
+        // The file can't be mapped (or is too large to decode from memory), let stb_image read it
+        file.close();
+        pixels.m_decoded = stbi_load(filename.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+    }
+
+    if (pixels.m_decoded)
     {
         // Assign the image properties
         size.x = width;
         size.y = height;
 
+        // The decoded pixels are used as they are
         if (width && height)
-        {
-            // Copy the loaded pixels to the pixel buffer
-            pixels.resize(width * height * 4);
-            memcpy(&pixels[0], ptr, pixels.size());
-        }
-
-        // Free the loaded pixels (they are now in our own pixel buffer)
-        stbi_image_free(ptr);
+            pixels.m_data = pixels.m_decoded;
 
         return true;
     }
@@ -132,36 +244,36 @@ bool ImageLoader::loadImageFromFile(const std::string& filename, std::vector<Uin
 
 
 ////////////////////////////////////////////////////////////
-bool ImageLoader::loadImageFromMemory(const void* data, std::size_t dataSize, std::vector<Uint8>& pixels, Vector2u& size)
+bool ImageLoader::loadImageFromMemory(const void* data, std::size_t dataSize, LoadedPixels& pixels, Vector2u& size)
 {
     // Check input parameters
     if (data && dataSize)
     {
-        // Clear the array (just in case)
-        pixels.clear();
-
         // Load the image and get a pointer to the pixels in memory
         int width = 0;
         int height = 0;
         int channels = 0;
         const unsigned char* buffer = static_cast<const unsigned char*>(data);
-        unsigned char* ptr = stbi_load_from_memory(buffer, static_cast<int>(dataSize), &width, &height, &channels, STBI_rgb_alpha);
 
-        if (ptr)
+        // Raw pixels are copied, the data belongs to the caller
+        if (std::size_t offset = findRawPixels(buffer, dataSize, size))
+        {
+            pixels.m_copy.assign(buffer + offset, buffer + offset + static_cast<std::size_t>(size.x) * size.y * 4);
+            pixels.m_data = &pixels.m_copy[0];
+            return true;
+        }
+
+        pixels.m_decoded = stbi_load_from_memory(buffer, static_cast<int>(dataSize), &width, &height, &channels, STBI_rgb_alpha);
+
+        if (pixels.m_decoded)
         {
             // Assign the image properties
             size.x = width;
             size.y = height;
 
+            // The decoded pixels are used as they are
             if (width && height)
-            {
-                // Copy the loaded pixels to the pixel buffer
-                pixels.resize(width * height * 4);
-                memcpy(&pixels[0], ptr, pixels.size());
-            }
-
-            // Free the loaded pixels (they are now in our own pixel buffer)
-            stbi_image_free(ptr);
+                pixels.m_data = pixels.m_decoded;
 
             return true;
         }
@@ -182,14 +294,37 @@ bool ImageLoader::loadImageFromMemory(const void* data, std::size_t dataSize, st
 
 
 ////////////////////////////////////////////////////////////
-bool ImageLoader::loadImageFromStream(InputStream& stream, std::vector<Uint8>& pixels, Vector2u& size)
+bool ImageLoader::loadImageFromStream(InputStream& stream, LoadedPixels& pixels, Vector2u& size)
 {
-    // Clear the array (just in case)
-    pixels.clear();
-
     // Make sure that the stream's reading position is at the beginning
     stream.seek(0);
 
+    // Raw pixels are read with the whole file, then moved to the front of it
+    Int64 streamSize = stream.getSize();
+    char  magic[3];
+    if ((streamSize > 3) && (static_cast<Uint64>(streamSize) <= static_cast<std::size_t>(-1)) && (stream.read(magic, 3) == 3) && (std::memcmp(magic, "P7\n", 3) == 0))
+    {
+        std::vector<Uint8>& file = pixels.m_copy;
+        file.resize(static_cast<std::size_t>(streamSize));
+        std::memcpy(&file[0], magic, 3);
+
+        std::size_t offset = 0;
+        if (stream.read(&file[3], streamSize - 3) == streamSize - 3)
+            offset = findRawPixels(&file[0], file.size(), size);
+
+        if (offset)
+        {
+            file.erase(file.begin(), file.begin() + static_cast<std::ptrdiff_t>(offset));
+            file.resize(static_cast<std::size_t>(size.x) * size.y * 4);
+            pixels.m_data = &file[0];
+            return true;
+        }
+
+        // Not a raw RGBA file, let stb_image have a go at it
+        std::vector<Uint8>().swap(file);
+    }
+    stream.seek(0);
+
     // Setup the stb_image callbacks
     stbi_io_callbacks callbacks;
     callbacks.read = &read;
@@ -200,23 +335,17 @@ bool ImageLoader::loadImageFromStream(InputStream& stream, std::vector<Uint8>& p
     int width = 0;
     int height = 0;
     int channels = 0;
-    unsigned char* ptr = stbi_load_from_callbacks(&callbacks, &stream, &width, &height, &channels, STBI_rgb_alpha);
+    pixels.m_decoded = stbi_load_from_callbacks(&callbacks, &stream, &width, &height, &channels, STBI_rgb_alpha);
 
-    if (ptr)
+    if (pixels.m_decoded)
     {
         // Assign the image properties
         size.x = width;
         size.y = height;
 
+        // The decoded pixels are used as they are
         if (width && height)
-        {
-            // Copy the loaded pixels to the pixel buffer
-            pixels.resize(width * height * 4);
-            memcpy(&pixels[0], ptr, pixels.size());
-        }
-
-        // Free the loaded pixels (they are now in our own pixel buffer)
-        stbi_image_free(ptr);
+            pixels.m_data = pixels.m_decoded;
 
         return true;
     }
@@ -231,10 +360,10 @@ bool ImageLoader::loadImageFromStream(InputStream& stream, std::vector<Uint8>& p
 
 
 ////////////////////////////////////////////////////////////
-bool ImageLoader::saveImageToFile(const std::string& filename, const std::vector<Uint8>& pixels, const Vector2u& size)
+bool ImageLoader::saveImageToFile(const std::string& filename, const Uint8* pixels, const Vector2u& size)
 {
     // Make sure the image is not empty
-    if (!pixels.empty() && (size.x > 0) && (size.y > 0))
+    if (pixels && (size.x > 0) && (size.y > 0))
     {
         // Deduce the image type from its extension
 
@@ -245,25 +374,31 @@ bool ImageLoader::saveImageToFile(const std::string& filename, const std::vector
         if (extension == "bmp")
         {
             // BMP format
-            if (stbi_write_bmp(filename.c_str(), size.x, size.y, 4, &pixels[0]))
+            if (stbi_write_bmp(filename.c_str(), size.x, size.y, 4, pixels))
                 return true;
         }
         else if (extension == "tga")
         {
             // TGA format
-            if (stbi_write_tga(filename.c_str(), size.x, size.y, 4, &pixels[0]))
+            if (stbi_write_tga(filename.c_str(), size.x, size.y, 4, pixels))
                 return true;
         }
         else if (extension == "png")
         {
             // PNG format
-            if (stbi_write_png(filename.c_str(), size.x, size.y, 4, &pixels[0], 0))
+            if (stbi_write_png(filename.c_str(), size.x, size.y, 4, pixels, 0))
                 return true;
         }
         else if (extension == "jpg" || extension == "jpeg")
         {
             // JPG format
-            if (stbi_write_jpg(filename.c_str(), size.x, size.y, 4, &pixels[0], 90))
+            if (stbi_write_jpg(filename.c_str(), size.x, size.y, 4, pixels, 90))
+                return true;
+        }
+        else if (extension == "pam")
+        {
+            // Raw RGBA format, loaded without decoding
+            if (writeRawImage(filename, pixels, size))
                 return true;
         }
     }
@@ -28,6 +28,7 @@
 ////////////////////////////////////////////////////////////
 // Headers
 ////////////////////////////////////////////////////////////
+#include <SFML/Graphics/MappedFile.hpp>
 #include <SFML/System/NonCopyable.hpp>
 #include <SFML/System/Vector2.hpp>
 #include <string>
@@ -40,6 +41,55 @@ class InputStream;
 
 namespace priv
 {
+////////////////////////////////////////////////////////////
+/// \brief Pixels of a loaded image, used in place by sf::Image
+///
+/// The pixels are either the buffer stb_image decoded the
+/// image into, or the pixels of a raw RGBA file (a PAM file)
+/// mapped into memory, copy-on-write, or copied when the raw
+/// file is in memory or in a stream. They are writable in
+/// all cases.
+///
+////////////////////////////////////////////////////////////
+class LoadedPixels : NonCopyable
+{
+public:
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Default constructor
+    ///
+    ////////////////////////////////////////////////////////////
+    LoadedPixels();
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Destructor
+    ///
+    /// Frees the decoded pixels or unmaps the file.
+    ///
+    ////////////////////////////////////////////////////////////
+    ~LoadedPixels();
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the pixels
+    ///
+    /// \return Pointer to the first pixel, or null if the image is empty
+    ///
+    ////////////////////////////////////////////////////////////
+    Uint8* getData() const;
+
+private:
+
+    friend class ImageLoader;
+
+    ////////////////////////////////////////////////////////////
+    // Member data
+    ////////////////////////////////////////////////////////////
+    Uint8*             m_data;    ///< First pixel
+    Uint8*             m_decoded; ///< Buffer allocated by stb_image, if the image was decoded
+    MappedFile         m_file;    ///< Raw image file, if the pixels are used from the file
+    std::vector<Uint8> m_copy;    ///< Raw pixels, if they were copied from memory or a stream
+};
+
 ////////////////////////////////////////////////////////////
 /// \brief Load/save image files
 ///
@@ -59,39 +109,48 @@ public:
     ////////////////////////////////////////////////////////////
     /// \brief Load an image from a file on disk
     ///
+    /// The file is mapped into memory and decoded from there.
+    /// Raw RGBA files are not decoded, their pixels are used
+    /// straight from the mapping.
+    ///
     /// \param filename Path of image file to load
-    /// \param pixels   Array of pixels to fill with loaded image
+    /// \param pixels   Pixels to fill with loaded image, must be empty
     /// \param size     Size of loaded image, in pixels
     ///
     /// \return True if loading was successful
     ///
     ////////////////////////////////////////////////////////////
-    bool loadImageFromFile(const std::string& filename, std::vector<Uint8>& pixels, Vector2u& size);
+    bool loadImageFromFile(const std::string& filename, LoadedPixels& pixels, Vector2u& size);
 
     ////////////////////////////////////////////////////////////
     /// \brief Load an image from a file in memory
     ///
+    /// Raw RGBA files are not decoded, their pixels are copied.
+    ///
     /// \param data     Pointer to the file data in memory
     /// \param dataSize Size of the data to load, in bytes
-    /// \param pixels   Array of pixels to fill with loaded image
+    /// \param pixels   Pixels to fill with loaded image, must be empty
     /// \param size     Size of loaded image, in pixels
     ///
     /// \return True if loading was successful
     ///
     ////////////////////////////////////////////////////////////
-    bool loadImageFromMemory(const void* data, std::size_t dataSize, std::vector<Uint8>& pixels, Vector2u& size);
+    bool loadImageFromMemory(const void* data, std::size_t dataSize, LoadedPixels& pixels, Vector2u& size);
 
     ////////////////////////////////////////////////////////////
     /// \brief Load an image from a custom stream
     ///
+    /// Raw RGBA files are not decoded, their pixels are read
+    /// as they are.
+    ///
     /// \param stream Source stream to read from
-    /// \param pixels Array of pixels to fill with loaded image
+    /// \param pixels Pixels to fill with loaded image, must be empty
     /// \param size   Size of loaded image, in pixels
     ///
     /// \return True if loading was successful
     ///
     ////////////////////////////////////////////////////////////
-    bool loadImageFromStream(InputStream& stream, std::vector<Uint8>& pixels, Vector2u& size);
+    bool loadImageFromStream(InputStream& stream, LoadedPixels& pixels, Vector2u& size);
 
     ////////////////////////////////////////////////////////////
     /// \brief Save an array of pixels as an image file
@@ -103,7 +162,7 @@ public:
     /// \return True if saving was successful
     ///
     ////////////////////////////////////////////////////////////
-    bool saveImageToFile(const std::string& filename, const std::vector<Uint8>& pixels, const Vector2u& size);
+    bool saveImageToFile(const std::string& filename, const Uint8* pixels, const Vector2u& size);
 
 private:
 
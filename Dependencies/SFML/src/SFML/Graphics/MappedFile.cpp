@@ -0,0 +1,154 @@
+////////////////////////////////////////////////////////////
+//
+// SFML - Simple and Fast Multimedia Library
+// Copyright (C) 2007-2018 Laurent Gomila (laurent@sfml-dev.org)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include <SFML/Graphics/MappedFile.hpp>
+#if defined(SFML_SYSTEM_WINDOWS)
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+
+namespace sf
+{
+namespace priv
+{
+////////////////////////////////////////////////////////////
+MappedFile::MappedFile() :
+m_data(NULL),
+m_size(0)
+{
+}
+
+
+////////////////////////////////////////////////////////////
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+
+////////////////////////////////////////////////////////////
+bool MappedFile::open(const std::string& filename)
+{
+    close();
+
+#if defined(SFML_SYSTEM_WINDOWS)
+
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || (size.QuadPart <= 0) || (static_cast<ULONGLONG>(size.QuadPart) > static_cast<std::size_t>(-1)))
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    // The view keeps the mapping and the file open
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping)
+        return false;
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!data)
+        return false;
+
+    m_data = static_cast<Uint8*>(data);
+    m_size = static_cast<std::size_t>(size.QuadPart);
+
+#else
+
+    int file = ::open(filename.c_str(), O_RDONLY);
+    if (file == -1)
+        return false;
+
+    struct stat info;
+    if ((fstat(file, &info) == -1) || (info.st_size <= 0))
+    {
+        ::close(file);
+        return false;
+    }
+
+    // The mapping keeps the file open
+    void* data = mmap(NULL, static_cast<std::size_t>(info.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if (data == MAP_FAILED)
+        return false;
+
+    m_data = static_cast<Uint8*>(data);
+    m_size = static_cast<std::size_t>(info.st_size);
+
+#endif
+
+    return true;
+}
+
+
+////////////////////////////////////////////////////////////
+void MappedFile::close()
+{
+    if (!m_data)
+        return;
+
+#if defined(SFML_SYSTEM_WINDOWS)
+    UnmapViewOfFile(m_data);
+#else
+    munmap(m_data, m_size);
+#endif
+
+    m_data = NULL;
+    m_size = 0;
+}
+
+
+////////////////////////////////////////////////////////////
+Uint8* MappedFile::getData() const
+{
+    return m_data;
+}
+
+
+////////////////////////////////////////////////////////////
+std::size_t MappedFile::getSize() const
+{
+    return m_size;
+}
+
+} // namespace priv
+
+} // namespace sf
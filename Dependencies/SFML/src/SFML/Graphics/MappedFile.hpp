@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////
+//
+// SFML - Simple and Fast Multimedia Library
+// Copyright (C) 2007-2018 Laurent Gomila (laurent@sfml-dev.org)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+
+#ifndef SFML_MAPPEDFILE_HPP
+#define SFML_MAPPEDFILE_HPP
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include <SFML/Config.hpp>
+#include <SFML/System/NonCopyable.hpp>
+#include <cstddef>
+#include <string>
+
+
+namespace sf
+{
+namespace priv
+{
+////////////////////////////////////////////////////////////
+/// \brief File mapped into memory, copy-on-write
+///
+/// The contents of the file are read by the OS when they are
+/// first accessed, straight from its cache. They can be
+/// modified: the pages that are written to are copied and
+/// the file itself is never changed.
+///
+////////////////////////////////////////////////////////////
+class MappedFile : NonCopyable
+{
+public:
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Default constructor
+    ///
+    ////////////////////////////////////////////////////////////
+    MappedFile();
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Destructor
+    ///
+    /// Unmaps the file.
+    ///
+    ////////////////////////////////////////////////////////////
+    ~MappedFile();
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Map a file into memory
+    ///
+    /// Any file mapped before is unmapped first. Empty files
+    /// can't be mapped.
+    ///
+    /// \param filename Path of the file to map
+    ///
+    /// \return True if the file was mapped
+    ///
+    ////////////////////////////////////////////////////////////
+    bool open(const std::string& filename);
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Unmap the file
+    ///
+    ////////////////////////////////////////////////////////////
+    void close();
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the contents of the file
+    ///
+    /// \return Pointer to the first byte of the file, or null if no file is mapped
+    ///
+    ////////////////////////////////////////////////////////////
+    Uint8* getData() const;
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the size of the file
+    ///
+    /// \return Size of the file in bytes, 0 if no file is mapped
+    ///
+    ////////////////////////////////////////////////////////////
+    std::size_t getSize() const;
+
+private:
+
+    ////////////////////////////////////////////////////////////
+    // Member data
+    ////////////////////////////////////////////////////////////
+    Uint8*      m_data; ///< Start of the mapping
+    std::size_t m_size; ///< Size of the mapping
+};
+
+} // namespace priv
+
+} // namespace sf
+
+
+#endif // SFML_MAPPEDFILE_HPP
@@ -119,17 +119,70 @@ namespace
         assert(false);
         return GLEXT_GL_FUNC_ADD;
     }
+
+
+    // Bigger draws gain nothing from batching, copying and transforming them would cost more than the draw call
+    const std::size_t maxBatchedVertexCount = 1024;
+
+
+    // Primitive type that a batch of the given type is drawn with, strips, fans
+    // and quads are split into independent primitives so that they can be merged
+    sf::PrimitiveType batchPrimitiveType(sf::PrimitiveType type)
+    {
+        switch (type)
+        {
+            case sf::Points:        return sf::Points;
+            case sf::Lines:         return sf::Lines;
+            case sf::LineStrip:     return sf::Lines;
+            case sf::Triangles:     return sf::Triangles;
+            case sf::TriangleStrip: return sf::Triangles;
+            case sf::TriangleFan:   return sf::Triangles;
+            case sf::Quads:         return sf::Triangles;
+        }
+
+        return type;
+    }
+
+
+    // Append a vertex to a batch, transformed by the given transform
+    void appendVertex(std::vector<sf::Vertex>& batch, const sf::Transform& transform, const sf::Vertex& vertex)
+    {
+        batch.push_back(sf::Vertex(transform.transformPoint(vertex.position), vertex.color, vertex.texCoords));
+    }
 }
 
 
 namespace sf
 {
+////////////////////////////////////////////////////////////
+RenderTarget::Statistics::Statistics() :
+drawCalls       (0),
+vertices        (0),
+vertexCacheDraws(0),
+directDraws     (0),
+batchedDraws    (0),
+textureBinds    (0),
+shaderSwitches  (0),
+blendModeChanges(0),
+matrixUploads   (0),
+contextSwitches (0)
+{
+}
+
+
 ////////////////////////////////////////////////////////////
 RenderTarget::RenderTarget() :
 m_defaultView(),
 m_view       (),
 m_cache      (),
-m_id         (0)
+m_id         (0),
+m_batching   (false),
+m_batch      (),
+m_batchType  (Triangles),
+m_batchTexture(NULL),
+m_batchBlendMode(),
+m_statistics (),
+m_logStatistics(false)
 {
     m_cache.glStatesSet = false;
 }
@@ -144,6 +197,8 @@ RenderTarget::~RenderTarget()
 ////////////////////////////////////////////////////////////
 void RenderTarget::clear(const Color& color)
 {
+    flush();
+
     if (isActive(m_id) || setActive(true))
     {
         // Unbind texture to fix RenderTexture preventing clear
@@ -158,6 +213,9 @@ void RenderTarget::clear(const Color& color)
 ////////////////////////////////////////////////////////////
 void RenderTarget::setView(const View& view)
 {
+    // The pending vertices have to be drawn with the view they were submitted with
+    flush();
+
     m_view = view;
     m_cache.viewChanged = true;
 }
@@ -259,11 +317,32 @@ void RenderTarget::draw(const Vertex* vertices, std::size_t vertexCount,
         }
     #endif
 
+    if (m_batching)
+    {
+        if (batchVertices(vertices, vertexCount, type, states))
+            return;
+
+        flush();
+    }
+
+    drawVertices(vertices, vertexCount, type, states);
+}
+
+
+////////////////////////////////////////////////////////////
+void RenderTarget::drawVertices(const Vertex* vertices, std::size_t vertexCount,
+                                PrimitiveType type, const RenderStates& states)
+{
     if (isActive(m_id) || setActive(true))
     {
         // Check if the vertex count is low enough so that we can pre-transform them
         bool useVertexCache = (vertexCount <= StatesCache::VertexCacheSize);
 
+        if (useVertexCache)
+            ++m_statistics.vertexCacheDraws;
+        else
+            ++m_statistics.directDraws;
+
         if (useVertexCache)
         {
             // Pre-transform the vertices and store them into the vertex cache
@@ -350,6 +429,8 @@ void RenderTarget::draw(const VertexBuffer& vertexBuffer, std::size_t firstVerte
     if (!vertexCount || !vertexBuffer.getNativeHandle())
         return;
 
+    flush();
+
     // GL_QUADS is unavailable on OpenGL ES
     #ifdef SFML_OPENGL_ES
         if (vertexBuffer.getPrimitiveType() == Quads)
@@ -388,6 +469,75 @@ void RenderTarget::draw(const VertexBuffer& vertexBuffer, std::size_t firstVerte
 }
 
 
+////////////////////////////////////////////////////////////
+void RenderTarget::setBatchingEnabled(bool enabled)
+{
+    if (!enabled)
+        flush();
+
+    m_batching = enabled;
+}
+
+
+////////////////////////////////////////////////////////////
+bool RenderTarget::isBatchingEnabled() const
+{
+    return m_batching;
+}
+
+
+////////////////////////////////////////////////////////////
+void RenderTarget::flush()
+{
+    if (m_batch.empty())
+        return;
+
+    // The vertices are already transformed
+    RenderStates states(m_batchBlendMode, Transform::Identity, m_batchTexture, NULL);
+    drawVertices(&m_batch[0], m_batch.size(), m_batchType, states);
+
+    // Keep the capacity, the next frame will most likely need the same amount
+    m_batch.clear();
+    m_batchTexture = NULL;
+}
+
+
+////////////////////////////////////////////////////////////
+const RenderTarget::Statistics& RenderTarget::getStatistics() const
+{
+    return m_statistics;
+}
+
+
+////////////////////////////////////////////////////////////
+void RenderTarget::resetStatistics()
+{
+    if (m_logStatistics)
+    {
+        err() << "RenderTarget " << m_id << ": "
+              << m_statistics.drawCalls        << " draw calls, "
+              << m_statistics.vertices         << " vertices, "
+              << m_statistics.vertexCacheDraws << " vertex cache draws, "
+              << m_statistics.directDraws      << " direct draws, "
+              << m_statistics.batchedDraws     << " batched draws, "
+              << m_statistics.textureBinds     << " texture binds, "
+              << m_statistics.shaderSwitches   << " shader switches, "
+              << m_statistics.blendModeChanges << " blend mode changes, "
+              << m_statistics.matrixUploads    << " matrix uploads, "
+              << m_statistics.contextSwitches  << " context switches" << std::endl;
+    }
+
+    m_statistics = Statistics();
+}
+
+
+////////////////////////////////////////////////////////////
+void RenderTarget::setStatisticsLogging(bool enabled)
+{
+    m_logStatistics = enabled;
+}
+
+
 ////////////////////////////////////////////////////////////
 bool RenderTarget::setActive(bool active)
 {
@@ -406,18 +556,23 @@ bool RenderTarget::setActive(bool active)
                 contextRenderTargetMap[contextId] = m_id;
 
                 m_cache.enable = false;
+                ++m_statistics.contextSwitches;
             }
             else if (iter->second != m_id)
             {
                 iter->second = m_id;
 
                 m_cache.enable = false;
+                ++m_statistics.contextSwitches;
             }
         }
         else
         {
             if (iter != contextRenderTargetMap.end())
+            {
                 contextRenderTargetMap.erase(iter);
+                ++m_statistics.contextSwitches;
+            }
 
             m_cache.enable = false;
         }
@@ -430,6 +585,8 @@ bool RenderTarget::setActive(bool active)
 ////////////////////////////////////////////////////////////
 void RenderTarget::pushGLStates()
 {
+    flush();
+
     if (isActive(m_id) || setActive(true))
     {
         #ifdef SFML_DEBUG
@@ -462,6 +619,8 @@ void RenderTarget::pushGLStates()
 ////////////////////////////////////////////////////////////
 void RenderTarget::popGLStates()
 {
+    flush();
+
     if (isActive(m_id) || setActive(true))
     {
         glCheck(glMatrixMode(GL_PROJECTION));
@@ -481,6 +640,8 @@ void RenderTarget::popGLStates()
 ////////////////////////////////////////////////////////////
 void RenderTarget::resetGLStates()
 {
+    flush();
+
     // Check here to make sure a context change does not happen after activate(true)
     bool shaderAvailable = Shader::isAvailable();
     bool vertexBufferAvailable = VertexBuffer::isAvailable();
@@ -554,6 +715,96 @@ void RenderTarget::initialize()
 }
 
 
+////////////////////////////////////////////////////////////
+bool RenderTarget::batchVertices(const Vertex* vertices, std::size_t vertexCount,
+                                 PrimitiveType type, const RenderStates& states)
+{
+    // Shader uniforms can change between draws without us knowing, so don't merge them
+    if (states.shader || (vertexCount > maxBatchedVertexCount))
+        return false;
+
+    PrimitiveType batchType = batchPrimitiveType(type);
+
+    if (!m_batch.empty() && ((batchType != m_batchType) || (states.texture != m_batchTexture) || (states.blendMode != m_batchBlendMode)))
+        flush();
+
+    m_batchType = batchType;
+    m_batchTexture = states.texture;
+    m_batchBlendMode = states.blendMode;
+
+    const Transform& transform = states.transform;
+
+    switch (type)
+    {
+        // Independent primitives, an incomplete one at the end is dropped like OpenGL does
+        case Points:
+        case Lines:
+        case Triangles:
+        {
+            std::size_t size = (type == Points) ? 1 : ((type == Lines) ? 2 : 3);
+            std::size_t count = vertexCount - vertexCount % size;
+            for (std::size_t i = 0; i < count; ++i)
+                appendVertex(m_batch, transform, vertices[i]);
+            break;
+        }
+
+        case LineStrip:
+        {
+            for (std::size_t i = 1; i < vertexCount; ++i)
+            {
+                appendVertex(m_batch, transform, vertices[i - 1]);
+                appendVertex(m_batch, transform, vertices[i]);
+            }
+            break;
+        }
+
+        case TriangleStrip:
+        {
+            // Keep the winding of every second triangle like OpenGL does
+            for (std::size_t i = 2; i < vertexCount; ++i)
+            {
+                appendVertex(m_batch, transform, vertices[(i % 2 == 0) ? i - 2 : i - 1]);
+                appendVertex(m_batch, transform, vertices[(i % 2 == 0) ? i - 1 : i - 2]);
+                appendVertex(m_batch, transform, vertices[i]);
+            }
+            break;
+        }
+
+        case TriangleFan:
+        {
+            for (std::size_t i = 2; i < vertexCount; ++i)
+            {
+                appendVertex(m_batch, transform, vertices[0]);
+                appendVertex(m_batch, transform, vertices[i - 1]);
+                appendVertex(m_batch, transform, vertices[i]);
+            }
+            break;
+        }
+
+        case Quads:
+        {
+            for (std::size_t i = 0; i + 3 < vertexCount; i += 4)
+            {
+                appendVertex(m_batch, transform, vertices[i]);
+                appendVertex(m_batch, transform, vertices[i + 1]);
+                appendVertex(m_batch, transform, vertices[i + 2]);
+                appendVertex(m_batch, transform, vertices[i]);
+                appendVertex(m_batch, transform, vertices[i + 2]);
+                appendVertex(m_batch, transform, vertices[i + 3]);
+            }
+            break;
+        }
+
+        default:
+            return false;
+    }
+
+    ++m_statistics.batchedDraws;
+
+    return true;
+}
+
+
 ////////////////////////////////////////////////////////////
 void RenderTarget::applyCurrentView()
 {
@@ -565,6 +816,7 @@ void RenderTarget::applyCurrentView()
     // Set the projection matrix
     glCheck(glMatrixMode(GL_PROJECTION));
     glCheck(glLoadMatrixf(m_view.getTransform().getMatrix()));
+    ++m_statistics.matrixUploads;
 
     // Go back to model-view mode
     glCheck(glMatrixMode(GL_MODELVIEW));
@@ -618,6 +870,8 @@ void RenderTarget::applyBlendMode(const BlendMode& mode)
     }
 
     m_cache.lastBlendMode = mode;
+
+    ++m_statistics.blendModeChanges;
 }
 
 
@@ -627,15 +881,22 @@ void RenderTarget::applyTransform(const Transform& transform)
     // No need to call glMatrixMode(GL_MODELVIEW), it is always the
     // current mode (for optimization purpose, since it's the most used)
     if (transform == Transform::Identity)
+    {
         glCheck(glLoadIdentity());
+    }
     else
+    {
         glCheck(glLoadMatrixf(transform.getMatrix()));
+        ++m_statistics.matrixUploads;
+    }
 }
 
 
 ////////////////////////////////////////////////////////////
 void RenderTarget::applyTexture(const Texture* texture)
 {
+    ++m_statistics.textureBinds;
+
     Texture::bind(texture, Texture::Pixels);
 
     m_cache.lastTextureId = texture ? texture->m_cacheId : 0;
@@ -645,6 +906,8 @@ void RenderTarget::applyTexture(const Texture* texture)
 ////////////////////////////////////////////////////////////
 void RenderTarget::applyShader(const Shader* shader)
 {
+    ++m_statistics.shaderSwitches;
+
     Shader::bind(shader);
 }
 
@@ -707,6 +970,9 @@ void RenderTarget::drawPrimitives(PrimitiveType type, std::size_t firstVertex, s
                                    GL_TRIANGLE_STRIP, GL_TRIANGLE_FAN, GL_QUADS};
     GLenum mode = modes[type];
 
+    ++m_statistics.drawCalls;
+    m_statistics.vertices += vertexCount;
+
     // Draw the primitives
     glCheck(glDrawArrays(mode, static_cast<GLint>(firstVertex), static_cast<GLsizei>(vertexCount)));
 }
@@ -147,6 +147,10 @@ bool RenderTexture::generateMipmap()
 ////////////////////////////////////////////////////////////
 bool RenderTexture::setActive(bool active)
 {
+    // Pending batched vertices belong to this texture's context
+    if (!active)
+        flush();
+
     bool result = m_impl && m_impl->activate(active);
 
     // Update RenderTarget tracking
@@ -160,6 +164,8 @@ bool RenderTexture::setActive(bool active)
 ////////////////////////////////////////////////////////////
 void RenderTexture::display()
 {
+    flush();
+
     // Update the target texture
     if (m_impl && (priv::RenderTextureImplFBO::isAvailable() || setActive(true)))
     {
@@ -73,6 +73,10 @@ Vector2u RenderWindow::getSize() const
 ////////////////////////////////////////////////////////////
 bool RenderWindow::setActive(bool active)
 {
+    // Pending batched vertices belong to this window's context
+    if (!active)
+        flush();
+
     bool result = Window::setActive(active);
 
     // Update RenderTarget tracking
@@ -92,6 +96,15 @@ bool RenderWindow::setActive(bool active)
 }
 
 
+////////////////////////////////////////////////////////////
+void RenderWindow::display()
+{
+    flush();
+
+    Window::display();
+}
+
+
 ////////////////////////////////////////////////////////////
 Image RenderWindow::capture() const
 {
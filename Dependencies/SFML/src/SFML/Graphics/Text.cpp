@@ -26,6 +26,7 @@
 // Headers
 ////////////////////////////////////////////////////////////
 #include <SFML/Graphics/Text.hpp>
+#include <SFML/Graphics/TextLayoutCache.hpp>
 #include <SFML/Graphics/Texture.hpp>
 #include <SFML/Graphics/RenderTarget.hpp>
 #include <cmath>
@@ -33,6 +34,27 @@
 
 namespace
 {
+    // Start a new texture run unless the previous vertices already use the texture
+    template <typename Runs>
+    void useTexture(Runs& runs, const sf::VertexArray& vertices, unsigned int texture)
+    {
+        if (runs.empty() || (runs.back().texture != texture))
+            runs.push_back(typename Runs::value_type(vertices.getVertexCount(), texture));
+    }
+
+    // Draw the vertices with the font texture of each run, usually there is a single one
+    template <typename Runs>
+    void drawRuns(sf::RenderTarget& target, const sf::VertexArray& vertices, const Runs& runs, const sf::Font& font, unsigned int characterSize, sf::RenderStates states)
+    {
+        for (std::size_t i = 0; i < runs.size(); ++i)
+        {
+            std::size_t end = (i + 1 < runs.size()) ? runs[i + 1].first : vertices.getVertexCount();
+
+            states.texture = &font.getTexture(characterSize, runs[i].texture);
+            target.draw(&vertices[runs[i].first], end - runs[i].first, vertices.getPrimitiveType(), states);
+        }
+    }
+
     // Add an underline or strikethrough line to the vertex array
     void addLine(sf::VertexArray& vertices, float lineLength, float lineTop, const sf::Color& color, float offset, float thickness, float outlineThickness = 0)
     {
@@ -87,9 +109,14 @@ m_outlineColor       (0, 0, 0),
 m_outlineThickness   (0),
 m_vertices           (Triangles),
 m_outlineVertices    (Triangles),
+m_runs               (),
+m_outlineRuns        (),
 m_bounds             (),
 m_geometryNeedUpdate (false),
-m_fontTextureId      (0)
+m_fontTextureId      (0),
+m_checkpoints        (),
+m_validLength        (0),
+m_sharedLayout       (NULL)
 {
 
 }
@@ -108,19 +135,68 @@ m_outlineColor       (0, 0, 0),
 m_outlineThickness   (0),
 m_vertices           (Triangles),
 m_outlineVertices    (Triangles),
+m_runs               (),
+m_outlineRuns        (),
 m_bounds             (),
 m_geometryNeedUpdate (true),
-m_fontTextureId      (0)
+m_fontTextureId      (0),
+m_checkpoints        (),
+m_validLength        (0),
+m_sharedLayout       (NULL)
 {
 
 }
 
 
+////////////////////////////////////////////////////////////
+Text::Text(const Text& copy) :
+Drawable             (copy),
+Transformable        (copy),
+m_string             (copy.m_string),
+m_font               (copy.m_font),
+m_characterSize      (copy.m_characterSize),
+m_letterSpacingFactor(copy.m_letterSpacingFactor),
+m_lineSpacingFactor  (copy.m_lineSpacingFactor),
+m_style              (copy.m_style),
+m_fillColor          (copy.m_fillColor),
+m_outlineColor       (copy.m_outlineColor),
+m_outlineThickness   (copy.m_outlineThickness),
+m_vertices           (copy.m_vertices),
+m_outlineVertices    (copy.m_outlineVertices),
+m_runs               (copy.m_runs),
+m_outlineRuns        (copy.m_outlineRuns),
+m_bounds             (copy.m_bounds),
+m_geometryNeedUpdate (copy.m_geometryNeedUpdate),
+m_fontTextureId      (copy.m_fontTextureId),
+m_checkpoints        (copy.m_checkpoints),
+m_validLength        (copy.m_validLength),
+m_sharedLayout       (copy.m_sharedLayout)
+{
+    if (m_sharedLayout)
+        priv::TextLayoutCache::retain(m_sharedLayout);
+}
+
+
+////////////////////////////////////////////////////////////
+Text::~Text()
+{
+    if (m_sharedLayout)
+        priv::TextLayoutCache::release(m_sharedLayout);
+}
+
+
 ////////////////////////////////////////////////////////////
 void Text::setString(const String& string)
 {
     if (m_string != string)
     {
+        // The characters before the first difference keep their geometry
+        std::size_t prefix = 0;
+        std::size_t size = std::min(m_string.getSize(), string.getSize());
+        while ((prefix < size) && (m_string[prefix] == string[prefix]))
+            ++prefix;
+
+        m_validLength = std::min(m_validLength, prefix);
         m_string = string;
         m_geometryNeedUpdate = true;
     }
@@ -134,6 +210,7 @@ void Text::setFont(const Font& font)
     {
         m_font = &font;
         m_geometryNeedUpdate = true;
+        m_validLength = 0;
     }
 }
 
@@ -145,6 +222,7 @@ void Text::setCharacterSize(unsigned int size)
     {
         m_characterSize = size;
         m_geometryNeedUpdate = true;
+        m_validLength = 0;
     }
 }
 
@@ -156,6 +234,7 @@ void Text::setLetterSpacing(float spacingFactor)
     {
         m_letterSpacingFactor = spacingFactor;
         m_geometryNeedUpdate = true;
+        m_validLength = 0;
     }
 }
 
@@ -167,6 +246,7 @@ void Text::setLineSpacing(float spacingFactor)
     {
         m_lineSpacingFactor = spacingFactor;
         m_geometryNeedUpdate = true;
+        m_validLength = 0;
     }
 }
 
@@ -178,6 +258,7 @@ void Text::setStyle(Uint32 style)
     {
         m_style = style;
         m_geometryNeedUpdate = true;
+        m_validLength = 0;
     }
 }
 
@@ -198,7 +279,12 @@ void Text::setFillColor(const Color& color)
 
         // Change vertex colors directly, no need to update whole geometry
         // (if geometry is updated anyway, we can skip this step)
-        if (!m_geometryNeedUpdate)
+        // The shared geometry of a cached layout can't be changed, the one with the new color is looked up instead
+        if (m_sharedLayout)
+        {
+            m_geometryNeedUpdate = true;
+        }
+        else if (!m_geometryNeedUpdate || (m_validLength > 0))
         {
             for (std::size_t i = 0; i < m_vertices.getVertexCount(); ++i)
                 m_vertices[i].color = m_fillColor;
@@ -216,7 +302,12 @@ void Text::setOutlineColor(const Color& color)
 
         // Change vertex colors directly, no need to update whole geometry
         // (if geometry is updated anyway, we can skip this step)
-        if (!m_geometryNeedUpdate)
+        // The shared geometry of a cached layout can't be changed, the one with the new color is looked up instead
+        if (m_sharedLayout)
+        {
+            m_geometryNeedUpdate = true;
+        }
+        else if (!m_geometryNeedUpdate || (m_validLength > 0))
         {
             for (std::size_t i = 0; i < m_outlineVertices.getVertexCount(); ++i)
                 m_outlineVertices[i].color = m_outlineColor;
@@ -232,6 +323,7 @@ void Text::setOutlineThickness(float thickness)
     {
         m_outlineThickness = thickness;
         m_geometryNeedUpdate = true;
+        m_validLength = 0;
     }
 }
 
@@ -370,6 +462,57 @@ FloatRect Text::getGlobalBounds() const
 }
 
 
+////////////////////////////////////////////////////////////
+Text& Text::operator =(const Text& right)
+{
+    if (this != &right)
+    {
+        // Take the new reference first, both texts may share the same layout
+        if (right.m_sharedLayout)
+            priv::TextLayoutCache::retain(right.m_sharedLayout);
+        if (m_sharedLayout)
+            priv::TextLayoutCache::release(m_sharedLayout);
+
+        Transformable::operator =(right);
+        m_string              = right.m_string;
+        m_font                = right.m_font;
+        m_characterSize       = right.m_characterSize;
+        m_letterSpacingFactor = right.m_letterSpacingFactor;
+        m_lineSpacingFactor   = right.m_lineSpacingFactor;
+        m_style               = right.m_style;
+        m_fillColor           = right.m_fillColor;
+        m_outlineColor        = right.m_outlineColor;
+        m_outlineThickness    = right.m_outlineThickness;
+        m_vertices            = right.m_vertices;
+        m_outlineVertices     = right.m_outlineVertices;
+        m_runs                = right.m_runs;
+        m_outlineRuns         = right.m_outlineRuns;
+        m_bounds              = right.m_bounds;
+        m_geometryNeedUpdate  = right.m_geometryNeedUpdate;
+        m_fontTextureId       = right.m_fontTextureId;
+        m_checkpoints         = right.m_checkpoints;
+        m_validLength         = right.m_validLength;
+        m_sharedLayout        = right.m_sharedLayout;
+    }
+
+    return *this;
+}
+
+
+////////////////////////////////////////////////////////////
+void Text::setLayoutCacheSize(std::size_t vertexCount)
+{
+    priv::TextLayoutCache::setCapacity(vertexCount);
+}
+
+
+////////////////////////////////////////////////////////////
+std::size_t Text::getLayoutCacheSize()
+{
+    return priv::TextLayoutCache::getCapacity();
+}
+
+
 ////////////////////////////////////////////////////////////
 void Text::draw(RenderTarget& target, RenderStates states) const
 {
@@ -378,13 +521,15 @@ void Text::draw(RenderTarget& target, RenderStates states) const
         ensureGeometryUpdate();
 
         states.transform *= getTransform();
-        states.texture = &m_font->getTexture(m_characterSize);
+
+        // Texts that share a cached layout draw its geometry
+        const Text& geometry = m_sharedLayout ? *m_sharedLayout : *this;
 
         // Only draw the outline if there is something to draw
         if (m_outlineThickness != 0)
-            target.draw(m_outlineVertices, states);
+            drawRuns(target, geometry.m_outlineVertices, geometry.m_outlineRuns, *m_font, m_characterSize, states);
 
-        target.draw(m_vertices, states);
+        drawRuns(target, geometry.m_vertices, geometry.m_runs, *m_font, m_characterSize, states);
     }
 }
 
@@ -396,23 +541,63 @@ void Text::ensureGeometryUpdate() const
         return;
 
     // Do nothing, if geometry has not changed and the font texture has not changed
-    if (!m_geometryNeedUpdate && m_font->getTexture(m_characterSize).m_cacheId == m_fontTextureId)
+    bool textureChanged = m_font->getTexture(m_characterSize).m_cacheId != m_fontTextureId;
+    if (!m_geometryNeedUpdate && !textureChanged)
         return;
 
-    // Save the current fonts texture id
-    m_fontTextureId = m_font->getTexture(m_characterSize).m_cacheId;
-
     // Mark geometry as updated
     m_geometryNeedUpdate = false;
 
-    // Clear the previous geometry
-    m_vertices.clear();
-    m_outlineVertices.clear();
+    // Resume the layout after the characters that didn't change, unless the font texture
+    // changed under them (the font may have been reloaded)
+    std::size_t start = (textureChanged || m_checkpoints.empty()) ? 0 : m_validLength;
+    m_validLength = 0;
     m_bounds = FloatRect();
 
+    // A shared layout is looked up again (texts that use one have no checkpoints, they always start over)
+    if (m_sharedLayout)
+    {
+        priv::TextLayoutCache::release(m_sharedLayout);
+        m_sharedLayout = NULL;
+    }
+
+    if (start > 0)
+    {
+        // Drop the geometry of the changed characters only
+        const LayoutCheckpoint& checkpoint = m_checkpoints[start];
+        m_vertices.resize(checkpoint.vertexCount);
+        m_outlineVertices.resize(checkpoint.outlineVertexCount);
+        m_runs.erase(m_runs.begin() + checkpoint.runCount, m_runs.end());
+        m_outlineRuns.erase(m_outlineRuns.begin() + checkpoint.outlineRunCount, m_outlineRuns.end());
+    }
+    else
+    {
+        // Clear the previous geometry
+        m_vertices.clear();
+        m_outlineVertices.clear();
+        m_runs.clear();
+        m_outlineRuns.clear();
+    }
+
     // No text: nothing to draw
+    m_fontTextureId = m_font->getTexture(m_characterSize).m_cacheId;
     if (m_string.isEmpty())
+    {
+        m_checkpoints.clear();
         return;
+    }
+
+    // Use the geometry of a text that looks the same, if one was laid out already
+    if (start == 0)
+    {
+        m_sharedLayout = priv::TextLayoutCache::acquire(*this);
+        if (m_sharedLayout)
+        {
+            m_bounds = m_sharedLayout->m_bounds;
+            m_checkpoints.clear();
+            return;
+        }
+    }
 
     // Compute values related to the text style
     bool  isBold             = m_style & Bold;
@@ -442,8 +627,24 @@ void Text::ensureGeometryUpdate() const
     float maxX = 0.f;
     float maxY = 0.f;
     Uint32 prevChar = 0;
-    for (std::size_t i = 0; i < m_string.getSize(); ++i)
+
+    if (start > 0)
     {
+        const LayoutCheckpoint& checkpoint = m_checkpoints[start];
+        x        = checkpoint.x;
+        y        = checkpoint.y;
+        minX     = checkpoint.minX;
+        minY     = checkpoint.minY;
+        maxX     = checkpoint.maxX;
+        maxY     = checkpoint.maxY;
+        prevChar = checkpoint.prevChar;
+    }
+
+    m_checkpoints.resize(m_string.getSize() + 1);
+    for (std::size_t i = start; i < m_string.getSize(); ++i)
+    {
+        saveCheckpoint(i, x, y, minX, minY, maxX, maxY, prevChar);
+
         Uint32 curChar = m_string[i];
 
         // Skip the \r char to avoid weird graphical issues
@@ -456,19 +657,27 @@ void Text::ensureGeometryUpdate() const
         // If we're using the underlined style and there's a new line, draw a line
         if (isUnderlined && (curChar == L'\n' && prevChar != L'\n'))
         {
+            useTexture(m_runs, m_vertices, 0);
             addLine(m_vertices, x, y, m_fillColor, underlineOffset, underlineThickness);
 
             if (m_outlineThickness != 0)
+            {
+                useTexture(m_outlineRuns, m_outlineVertices, 0);
                 addLine(m_outlineVertices, x, y, m_outlineColor, underlineOffset, underlineThickness, m_outlineThickness);
+            }
         }
 
         // If we're using the strike through style and there's a new line, draw a line across all characters
         if (isStrikeThrough && (curChar == L'\n' && prevChar != L'\n'))
         {
+            useTexture(m_runs, m_vertices, 0);
             addLine(m_vertices, x, y, m_fillColor, strikeThroughOffset, underlineThickness);
 
             if (m_outlineThickness != 0)
+            {
+                useTexture(m_outlineRuns, m_outlineVertices, 0);
                 addLine(m_outlineVertices, x, y, m_outlineColor, strikeThroughOffset, underlineThickness, m_outlineThickness);
+            }
         }
 
         prevChar = curChar;
@@ -506,6 +715,7 @@ void Text::ensureGeometryUpdate() const
             float bottom = glyph.bounds.top  + glyph.bounds.height;
 
             // Add the outline glyph to the vertices
+            useTexture(m_outlineRuns, m_outlineVertices, glyph.textureIndex);
             addGlyphQuad(m_outlineVertices, Vector2f(x, y), m_outlineColor, glyph, italicShear, m_outlineThickness);
 
             // Update the current bounds with the outlined glyph bounds
@@ -519,6 +729,7 @@ void Text::ensureGeometryUpdate() const
         const Glyph& glyph = m_font->getGlyph(curChar, m_characterSize, isBold);
 
         // Add the glyph to the vertices
+        useTexture(m_runs, m_vertices, glyph.textureIndex);
         addGlyphQuad(m_vertices, Vector2f(x, y), m_fillColor, glyph, italicShear);
 
         // Update the current bounds with the non outlined glyph bounds
@@ -539,22 +750,33 @@ void Text::ensureGeometryUpdate() const
         x += glyph.advance + letterSpacing;
     }
 
+    // The state after the last character, appending to the string resumes from here
+    saveCheckpoint(m_string.getSize(), x, y, minX, minY, maxX, maxY, prevChar);
+
     // If we're using the underlined style, add the last line
     if (isUnderlined && (x > 0))
     {
+        useTexture(m_runs, m_vertices, 0);
         addLine(m_vertices, x, y, m_fillColor, underlineOffset, underlineThickness);
 
         if (m_outlineThickness != 0)
+        {
+            useTexture(m_outlineRuns, m_outlineVertices, 0);
             addLine(m_outlineVertices, x, y, m_outlineColor, underlineOffset, underlineThickness, m_outlineThickness);
+        }
     }
 
     // If we're using the strike through style, add the last line across all characters
     if (isStrikeThrough && (x > 0))
     {
+        useTexture(m_runs, m_vertices, 0);
         addLine(m_vertices, x, y, m_fillColor, strikeThroughOffset, underlineThickness);
 
         if (m_outlineThickness != 0)
+        {
+            useTexture(m_outlineRuns, m_outlineVertices, 0);
             addLine(m_outlineVertices, x, y, m_outlineColor, strikeThroughOffset, underlineThickness, m_outlineThickness);
+        }
     }
 
     // Update the bounding rectangle
@@ -562,6 +784,33 @@ void Text::ensureGeometryUpdate() const
     m_bounds.top = minY;
     m_bounds.width = maxX - minX;
     m_bounds.height = maxY - minY;
+
+    // Glyphs loaded by this layout changed the texture id, but not the glyphs that are already laid out
+    m_fontTextureId = m_font->getTexture(m_characterSize).m_cacheId;
+    m_validLength = m_string.getSize();
+
+    // Share the complete layouts with the texts that look the same, changing the end of
+    // a string (e.g. a counter) doesn't fill the cache
+    if (start == 0)
+        priv::TextLayoutCache::insert(*this);
+}
+
+
+////////////////////////////////////////////////////////////
+void Text::saveCheckpoint(std::size_t index, float x, float y, float minX, float minY, float maxX, float maxY, Uint32 prevChar) const
+{
+    LayoutCheckpoint& checkpoint = m_checkpoints[index];
+    checkpoint.x                  = x;
+    checkpoint.y                  = y;
+    checkpoint.minX               = minX;
+    checkpoint.minY               = minY;
+    checkpoint.maxX               = maxX;
+    checkpoint.maxY               = maxY;
+    checkpoint.prevChar           = prevChar;
+    checkpoint.vertexCount        = m_vertices.getVertexCount();
+    checkpoint.outlineVertexCount = m_outlineVertices.getVertexCount();
+    checkpoint.runCount           = m_runs.size();
+    checkpoint.outlineRunCount    = m_outlineRuns.size();
 }
 
 } // namespace sf
@@ -0,0 +1,255 @@
+////////////////////////////////////////////////////////////
+//
+// SFML - Simple and Fast Multimedia Library
+// Copyright (C) 2007-2018 Laurent Gomila (laurent@sfml-dev.org)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include <SFML/Graphics/TextLayoutCache.hpp>
+#include <SFML/System/Lock.hpp>
+#include <SFML/System/Mutex.hpp>
+#include <cstring>
+#include <map>
+
+
+namespace
+{
+    // Mutex to protect the cache, texts may be laid out in several threads
+    sf::Mutex mutex;
+
+    // Cached entries, the most recently used first, and an index of them by hash
+    std::list<sf::Text*> entries;
+    std::multimap<sf::Uint64, sf::Text*> entryIndex;
+
+    // Number of vertices in the cache, and the maximum
+    std::size_t cachedVertexCount = 0;
+    std::size_t capacity = 65536;
+
+    // 64-bit FNV-1a constants, built from halves as C++03 has no 64-bit literals
+    const sf::Uint64 fnvOffsetBasis = (static_cast<sf::Uint64>(0xCBF29CE4u) << 32) | 0x84222325u;
+    const sf::Uint64 fnvPrime       = (static_cast<sf::Uint64>(0x00000100u) << 32) | 0x000001B3u;
+
+    // Add a value to an FNV-1a hash
+    void mix(sf::Uint64& hash, sf::Uint64 value)
+    {
+        hash = (hash ^ value) * fnvPrime;
+    }
+
+    // Bits of a float, so that hashing it doesn't depend on rounding
+    sf::Uint32 floatBits(float value)
+    {
+        sf::Uint32 bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+}
+
+
+namespace sf
+{
+namespace priv
+{
+////////////////////////////////////////////////////////////
+TextLayoutCache::Entry::Entry(const Text& text, Uint64 textHash) :
+Text       (text),
+hash       (textHash),
+vertexCount(text.m_vertices.getVertexCount() + text.m_outlineVertices.getVertexCount()),
+useCount   (0),
+cached     (true),
+position   ()
+{
+    // The checkpoints are only needed by texts that change
+    std::vector<LayoutCheckpoint>().swap(m_checkpoints);
+}
+
+
+////////////////////////////////////////////////////////////
+const Text* TextLayoutCache::acquire(const Text& text)
+{
+    Lock lock(mutex);
+
+    if (capacity == 0)
+        return NULL;
+
+    Entry* entry = find(text, hash(text));
+    if (!entry)
+        return NULL;
+
+    // Move the entry to the front, it's the most recently used now
+    entries.splice(entries.begin(), entries, entry->position);
+    entry->useCount++;
+
+    return entry;
+}
+
+
+////////////////////////////////////////////////////////////
+void TextLayoutCache::retain(const Text* layout)
+{
+    Lock lock(mutex);
+
+    static_cast<Entry*>(const_cast<Text*>(layout))->useCount++;
+}
+
+
+////////////////////////////////////////////////////////////
+void TextLayoutCache::release(const Text* layout)
+{
+    Lock lock(mutex);
+
+    // Entries that were dropped from the cache live until their last user releases them
+    Entry* entry = static_cast<Entry*>(const_cast<Text*>(layout));
+    entry->useCount--;
+    if ((entry->useCount == 0) && !entry->cached)
+        delete entry;
+}
+
+
+////////////////////////////////////////////////////////////
+void TextLayoutCache::insert(const Text& text)
+{
+    Lock lock(mutex);
+
+    std::size_t count = text.m_vertices.getVertexCount() + text.m_outlineVertices.getVertexCount();
+    if ((count == 0) || (count > capacity))
+        return;
+
+    // Another text with the same geometry may have been inserted in the meantime
+    Uint64 textHash = hash(text);
+    if (find(text, textHash))
+        return;
+
+    evict(capacity - count);
+
+    Entry* entry = new Entry(text, textHash);
+    entries.push_front(entry);
+    entry->position = entries.begin();
+    entryIndex.insert(std::make_pair(textHash, static_cast<Text*>(entry)));
+    cachedVertexCount += count;
+}
+
+
+////////////////////////////////////////////////////////////
+void TextLayoutCache::setCapacity(std::size_t vertexCount)
+{
+    Lock lock(mutex);
+
+    capacity = vertexCount;
+    evict(capacity);
+}
+
+
+////////////////////////////////////////////////////////////
+std::size_t TextLayoutCache::getCapacity()
+{
+    Lock lock(mutex);
+
+    return capacity;
+}
+
+
+////////////////////////////////////////////////////////////
+Uint64 TextLayoutCache::hash(const Text& text)
+{
+    Uint64 result = fnvOffsetBasis;
+
+    for (std::size_t i = 0; i < text.m_string.getSize(); ++i)
+        mix(result, text.m_string[i]);
+
+    mix(result, reinterpret_cast<std::size_t>(text.m_font));
+    mix(result, text.m_fontTextureId);
+    mix(result, text.m_characterSize);
+    mix(result, text.m_style);
+    mix(result, floatBits(text.m_letterSpacingFactor));
+    mix(result, floatBits(text.m_lineSpacingFactor));
+    mix(result, floatBits(text.m_outlineThickness));
+    mix(result, text.m_fillColor.toInteger());
+    mix(result, text.m_outlineColor.toInteger());
+
+    return result;
+}
+
+
+////////////////////////////////////////////////////////////
+bool TextLayoutCache::isSameLayout(const Text& left, const Text& right)
+{
+    return (left.m_font                == right.m_font)                &&
+           (left.m_fontTextureId       == right.m_fontTextureId)       &&
+           (left.m_characterSize       == right.m_characterSize)       &&
+           (left.m_style               == right.m_style)               &&
+           (left.m_letterSpacingFactor == right.m_letterSpacingFactor) &&
+           (left.m_lineSpacingFactor   == right.m_lineSpacingFactor)   &&
+           (left.m_outlineThickness    == right.m_outlineThickness)    &&
+           (left.m_fillColor           == right.m_fillColor)           &&
+           (left.m_outlineColor        == right.m_outlineColor)        &&
+           (left.m_string              == right.m_string);
+}
+
+
+////////////////////////////////////////////////////////////
+TextLayoutCache::Entry* TextLayoutCache::find(const Text& text, Uint64 textHash)
+{
+    typedef std::multimap<Uint64, Text*>::iterator Iterator;
+    std::pair<Iterator, Iterator> range = entryIndex.equal_range(textHash);
+
+    for (Iterator it = range.first; it != range.second; ++it)
+    {
+        if (isSameLayout(*it->second, text))
+            return static_cast<Entry*>(it->second);
+    }
+
+    return NULL;
+}
+
+
+////////////////////////////////////////////////////////////
+void TextLayoutCache::evict(std::size_t maxVertexCount)
+{
+    while (!entries.empty() && (cachedVertexCount > maxVertexCount))
+    {
+        Entry* entry = static_cast<Entry*>(entries.back());
+        entries.pop_back();
+        cachedVertexCount -= entry->vertexCount;
+
+        typedef std::multimap<Uint64, Text*>::iterator Iterator;
+        std::pair<Iterator, Iterator> range = entryIndex.equal_range(entry->hash);
+        for (Iterator it = range.first; it != range.second; ++it)
+        {
+            if (it->second == entry)
+            {
+                entryIndex.erase(it);
+                break;
+            }
+        }
+
+        // Texts that still use the entry keep it alive
+        entry->cached = false;
+        if (entry->useCount == 0)
+            delete entry;
+    }
+}
+
+} // namespace priv
+
+} // namespace sf
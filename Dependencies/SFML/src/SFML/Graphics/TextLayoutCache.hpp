@@ -0,0 +1,180 @@
+////////////////////////////////////////////////////////////
+//
+// SFML - Simple and Fast Multimedia Library
+// Copyright (C) 2007-2018 Laurent Gomila (laurent@sfml-dev.org)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef SFML_TEXTLAYOUTCACHE_HPP
+#define SFML_TEXTLAYOUTCACHE_HPP
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include <SFML/Graphics/Text.hpp>
+#include <list>
+
+
+namespace sf
+{
+namespace priv
+{
+////////////////////////////////////////////////////////////
+/// \brief Process-wide cache of laid out texts
+///
+/// The cache keeps copies of texts that were laid out, keyed
+/// by everything their geometry depends on: string, font,
+/// font texture, character size, style, spacing, outline
+/// and colors. A text that looks like a cached one references
+/// the cached copy and draws its geometry. Cached texts are
+/// reference counted, so a layout dropped from the cache
+/// stays alive until the last text that uses it lets it go.
+///
+////////////////////////////////////////////////////////////
+class TextLayoutCache
+{
+public:
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Find a cached layout for a text
+    ///
+    /// The text's font texture id must be up to date.
+    ///
+    /// \param text Text to find a layout for
+    ///
+    /// \return Cached text with the same geometry, or NULL if there's
+    ///         none. It must be given back with release.
+    ///
+    ////////////////////////////////////////////////////////////
+    static const Text* acquire(const Text& text);
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Take one more reference to a cached layout
+    ///
+    /// \param layout Layout returned by acquire
+    ///
+    ////////////////////////////////////////////////////////////
+    static void retain(const Text* layout);
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Give back a reference to a cached layout
+    ///
+    /// \param layout Layout returned by acquire
+    ///
+    ////////////////////////////////////////////////////////////
+    static void release(const Text* layout);
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Store a copy of a text that was just laid out
+    ///
+    /// \param text Text whose geometry is up to date
+    ///
+    ////////////////////////////////////////////////////////////
+    static void insert(const Text& text);
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Set the maximum number of vertices in the cache
+    ///
+    /// \param vertexCount Maximum number of vertices, 0 disables the cache
+    ///
+    ////////////////////////////////////////////////////////////
+    static void setCapacity(std::size_t vertexCount);
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the maximum number of vertices in the cache
+    ///
+    /// \return Maximum number of vertices
+    ///
+    ////////////////////////////////////////////////////////////
+    static std::size_t getCapacity();
+
+private:
+
+    ////////////////////////////////////////////////////////////
+    // Types
+    ////////////////////////////////////////////////////////////
+    typedef std::list<Text*> EntryList; ///< Cached entries, the most recently used first
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Cached copy of a text
+    ///
+    ////////////////////////////////////////////////////////////
+    struct Entry : public Text
+    {
+        Entry(const Text& text, Uint64 textHash);
+
+        Uint64              hash;        ///< Hash of the attributes the geometry depends on
+        std::size_t         vertexCount; ///< Number of fill and outline vertices
+        unsigned int        useCount;    ///< Number of texts that reference the entry
+        bool                cached;      ///< Is the entry still in the cache?
+        EntryList::iterator position;    ///< Position in the list of cached entries
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Hash the attributes the geometry of a text depends on
+    ///
+    /// \param text Text to hash
+    ///
+    /// \return Hash of the text
+    ///
+    ////////////////////////////////////////////////////////////
+    static Uint64 hash(const Text& text);
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Check whether two texts have the same geometry
+    ///
+    /// \param left  First text
+    /// \param right Second text
+    ///
+    /// \return True if the geometries are the same
+    ///
+    ////////////////////////////////////////////////////////////
+    static bool isSameLayout(const Text& left, const Text& right);
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Find a cached entry
+    ///
+    /// The cache must be locked.
+    ///
+    /// \param text     Text to find an entry for
+    /// \param textHash Hash of the text
+    ///
+    /// \return Entry with the same geometry, or NULL if there's none
+    ///
+    ////////////////////////////////////////////////////////////
+    static Entry* find(const Text& text, Uint64 textHash);
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Drop the least recently used entries
+    ///
+    /// The cache must be locked.
+    ///
+    /// \param maxVertexCount Number of vertices the cache may still hold
+    ///
+    ////////////////////////////////////////////////////////////
+    static void evict(std::size_t maxVertexCount);
+};
+
+} // namespace priv
+
+} // namespace sf
+
+
+#endif // SFML_TEXTLAYOUTCACHE_HPP
@@ -434,6 +434,39 @@ void Texture::update(const Uint8* pixels, unsigned int width, unsigned int heigh
 }
 
 
+////////////////////////////////////////////////////////////
+void Texture::update(const Uint8* const* pixels, const IntRect* rectangles, std::size_t count)
+{
+    if (!pixels || !rectangles || !count || !m_texture)
+        return;
+
+    TransientContextLock lock;
+
+    // Make sure that the current texture binding will be preserved
+    priv::TextureSaver save;
+
+    // Copy all the parts with a single binding
+    glCheck(glBindTexture(GL_TEXTURE_2D, m_texture));
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const IntRect& rectangle = rectangles[i];
+        assert(static_cast<unsigned int>(rectangle.left + rectangle.width) <= m_size.x);
+        assert(static_cast<unsigned int>(rectangle.top + rectangle.height) <= m_size.y);
+
+        if (pixels[i])
+            glCheck(glTexSubImage2D(GL_TEXTURE_2D, 0, rectangle.left, rectangle.top, rectangle.width, rectangle.height, GL_RGBA, GL_UNSIGNED_BYTE, pixels[i]));
+    }
+    glCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, m_isSmooth ? GL_LINEAR : GL_NEAREST));
+    m_hasMipmap = false;
+    m_pixelsFlipped = false;
+    m_cacheId = getUniqueId();
+
+    // Force an OpenGL flush, so that the texture data will appear updated
+    // in all contexts immediately (solves problems in multi-threaded apps)
+    glCheck(glFlush());
+}
+
+
 ////////////////////////////////////////////////////////////
 void Texture::update(const Texture& texture)
 {
@@ -93,32 +93,54 @@ project "Rays"
         SfmlDir .. "/include"
     }
 
-    links {
-        "winmm",
-        "flac",
-        "freetype",
-        "ogg",
-        "openal32",
-        "opengl32",
-        "vorbis",
-        "vorbisenc",
-        "vorbisfile",
-        "gdi32",
-        "SFML",
-        "user32",
-        "advapi32"
-    }
+    filter "system:windows"
+        links {
+            "winmm",
+            "flac",
+            "freetype",
+            "ogg",
+            "openal32",
+            "opengl32",
+            "vorbis",
+            "vorbisenc",
+            "vorbisfile",
+            "gdi32",
+            "SFML",
+            "user32",
+            "advapi32",
+            "psapi",
+            "ws2_32"
+        }
 
-    filter { "platforms:x64" }
+    filter { "system:windows", "platforms:x64" }
         libdirs {
             SfmlDir .. "/extlibs/libs-msvc-universal/x64"
         }
 
-    filter { "platforms:x86" }
+    filter { "system:windows", "platforms:x86" }
         libdirs {
             SfmlDir .. "/extlibs/libs-msvc-universal/x86"
         }
 
+    -- system packages: libx11 libxrandr libudev libgl freetype openal flac vorbis
+    filter "system:linux"
+        links {
+            "SFML",
+            "X11",
+            "Xrandr",
+            "udev",
+            "GL",
+            "freetype",
+            "openal",
+            "FLAC",
+            "vorbisenc",
+            "vorbisfile",
+            "vorbis",
+            "ogg",
+            "pthread",
+            "dl"
+        }
+
     filter { "configurations:Debug" }
         kind "ConsoleApp"
         floatingpoint "default"
@@ -0,0 +1,83 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iomanip>
+#include <ostream>
+
+#include "SFML/System/Clock.hpp"
+
+struct Benchmark
+{
+public:
+    enum class Stage { Integrate, Broadphase, Trace, Rasterise, Draw, Count };
+
+    struct StageStats
+    {
+    public:
+        double total = 0.0; // seconds
+        double min = 0.0;
+        double max = 0.0;
+        size_t samples = 0;
+    };
+private:
+    static constexpr size_t s_StageCount = static_cast<size_t>(Stage::Count);
+    static constexpr std::array<const char*, s_StageCount> s_StageNames = { "Integrate", "Broadphase", "Trace", "Rasterise", "Draw" };
+
+    std::array<StageStats, s_StageCount> m_Stages;
+    size_t m_Frames = 0;
+    size_t m_Rays = 0;
+    double m_FrameTime = 0.0;
+public:
+    struct ScopedStage
+    {
+    private:
+        Benchmark& m_Benchmark;
+        Stage m_Stage;
+        sf::Clock m_Clock;
+    public:
+        inline ScopedStage(Benchmark& benchmark, Stage stage) : m_Benchmark(benchmark), m_Stage(stage) {}
+        inline ~ScopedStage() { m_Benchmark.Record(m_Stage, static_cast<double>(m_Clock.getElapsedTime().asMicroseconds()) / 1e6); }
+        ScopedStage(const ScopedStage&) = delete;
+        ScopedStage& operator=(const ScopedStage&) = delete;
+    };
+
+    inline void Record(Stage stage, double seconds)
+    {
+        StageStats& stats = m_Stages[static_cast<size_t>(stage)];
+        stats.min = stats.samples == 0 ? seconds : std::min(stats.min, seconds);
+        stats.max = std::max(stats.max, seconds);
+        stats.total += seconds;
+        ++stats.samples;
+    }
+
+    inline void EndFrame(double frameSeconds, size_t rays)
+    {
+        ++m_Frames;
+        m_Rays += rays;
+        m_FrameTime += frameSeconds;
+    }
+
+    inline const StageStats& Get(Stage stage) const { return m_Stages[static_cast<size_t>(stage)]; }
+    inline size_t Frames() const { return m_Frames; }
+    inline size_t Rays() const { return m_Rays; }
+    inline double FrameTime() const { return m_FrameTime; }
+
+    inline void Print(std::ostream& os) const
+    {
+        if (m_Frames == 0)
+            return;
+
+        os << std::fixed << std::setprecision(3);
+        os << "Frames: " << m_Frames << " | avg frame: " << m_FrameTime / static_cast<double>(m_Frames) * 1e3 << "ms"
+           << " | rays/frame: " << m_Rays / m_Frames << '\n';
+        for (size_t i = 0; i < s_StageCount; ++i)
+        {
+            const StageStats& stats = m_Stages[i];
+            if (stats.samples == 0)
+                continue;
+            os << std::setw(12) << s_StageNames[i] << ": avg " << stats.total / static_cast<double>(stats.samples) * 1e3
+               << "ms min " << stats.min * 1e3 << "ms max " << stats.max * 1e3 << "ms (" << stats.samples << " samples)\n";
+        }
+    }
+};
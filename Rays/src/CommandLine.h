@@ -0,0 +1,153 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// Rays [--serve P] [--config file] [--telemetry file] [--cache-memory MiB]
+// Rays [--headless | --farm N] [--frames N] [--scene file] [--serve P] [--telemetry file] [--cache-memory MiB] [--expect-zero-allocs]
+// Rays --worker --port P [--threads N] [--delay ms]
+struct CommandLine
+{
+public:
+    bool headless = false;
+    size_t farm = 0; // number of worker processes, 0 runs no render farm
+    bool worker = false;
+    size_t frames = 600;
+    std::string scene; // empty uses the default scene
+    size_t port = 0;
+    size_t threads = 0; // 0 uses every hardware thread
+    size_t delay = 0;   // milliseconds a worker sleeps per work unit
+    size_t serve = 0;   // port of the stream server, 0 doesn't stream
+    std::string config; // tuning file watched by the window, empty uses res/tuning.cfg if it exists
+    std::string telemetry; // per frame stats are written here at exit, .json or CSV
+    size_t cacheMemory = 64; // MiB of finished rays the visibility cache keeps around
+    bool expectZeroAllocations = false; // headless run fails if its second half allocates
+private:
+    static inline bool ParseCount(const char* str, size_t& value)
+    {
+        try
+        {
+            size_t end = 0;
+            const unsigned long long parsed = std::stoull(str, &end);
+            if (str[end] != '\0' || str[0] == '-')
+                return false;
+            value = static_cast<size_t>(parsed);
+            return true;
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+    }
+public:
+    inline bool Parse(int argc, char** argv, std::ostream& err)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string_view arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+            if (arg == "--headless")
+                headless = true;
+            else if (arg == "--farm" && hasValue && ParseCount(argv[i + 1], farm) && farm != 0)
+                ++i;
+            else if (arg == "--worker")
+                worker = true;
+            else if (arg == "--frames" && hasValue && ParseCount(argv[i + 1], frames))
+                ++i;
+            else if (arg == "--port" && hasValue && ParseCount(argv[i + 1], port) && port != 0 && port <= 65535)
+                ++i;
+            else if (arg == "--threads" && hasValue && ParseCount(argv[i + 1], threads))
+                ++i;
+            else if (arg == "--delay" && hasValue && ParseCount(argv[i + 1], delay))
+                ++i;
+            else if (arg == "--serve" && hasValue && ParseCount(argv[i + 1], serve) && serve != 0 && serve <= 65535)
+                ++i;
+            else if (arg == "--scene" && hasValue)
+                scene = argv[++i];
+            else if (arg == "--config" && hasValue)
+                config = argv[++i];
+            else if (arg == "--telemetry" && hasValue)
+                telemetry = argv[++i];
+            else if (arg == "--expect-zero-allocs")
+                expectZeroAllocations = true;
+            else if (arg == "--cache-memory" && hasValue && ParseCount(argv[i + 1], cacheMemory) && cacheMemory <= SIZE_MAX / (1024 * 1024))
+                ++i;
+            else
+            {
+                err << "Invalid argument: " << arg << '\n';
+                return false;
+            }
+        }
+
+        if (static_cast<int>(headless) + static_cast<int>(farm != 0) + static_cast<int>(worker) > 1)
+        {
+            err << "--headless, --farm and --worker can't be combined\n";
+            return false;
+        }
+        if (!headless && farm == 0 && (frames != 600 || !scene.empty()))
+        {
+            err << "--frames and --scene are only available with --headless or --farm\n";
+            return false;
+        }
+        if (worker != (port != 0))
+        {
+            err << "--worker needs the --port of the coordinator\n";
+            return false;
+        }
+        if (!worker && (threads != 0 || delay != 0) && farm == 0)
+        {
+            err << "--threads and --delay are only available with --worker or --farm\n";
+            return false;
+        }
+        if (serve != 0 && (worker || farm != 0))
+        {
+            err << "--serve is only available with the window or --headless\n";
+            return false;
+        }
+        if (!config.empty() && (headless || farm != 0 || worker))
+        {
+            err << "--config is only available with the window\n";
+            return false;
+        }
+        if (!telemetry.empty() && (worker || farm != 0))
+        {
+            err << "--telemetry is only available with the window or --headless\n";
+            return false;
+        }
+        if (expectZeroAllocations && !headless)
+        {
+            err << "--expect-zero-allocs is only available with --headless\n";
+            return false;
+        }
+        if (cacheMemory != 64 && (worker || farm != 0))
+        {
+            err << "--cache-memory is only available with the window or --headless\n";
+            return false;
+        }
+        return true;
+    }
+
+    static inline void PrintUsage(std::ostream& os, const char* program)
+    {
+        os << "Usage: " << program << " [--serve P] [--config file] [--telemetry file] [--cache-memory MiB]\n"
+           << "       " << program << " [--headless | --farm N] [--frames N] [--scene file] [--serve P] [--telemetry file] [--cache-memory MiB]\n"
+           << "                [--expect-zero-allocs]\n"
+           << "       " << program << " --worker --port P [--threads N] [--delay ms]\n"
+           << "  --headless   run the frame pipeline without a window and print a throughput report\n"
+           << "  --farm N     trace the simulation with N local worker processes and print a per worker report\n"
+           << "  --frames N   number of frames to run (default 600)\n"
+           << "  --scene      scene file with the settings and the input replay (see Scene.h)\n"
+           << "  --worker     render farm worker, connects to the coordinator on --port (started by --farm)\n"
+           << "  --threads N  threads per worker (default: hardware threads / workers)\n"
+           << "  --delay ms   worker sleeps this long per work unit, with --farm only the first worker does\n"
+           << "  --serve P    stream the scene to viewers connecting on port P\n"
+           << "  --config     tuning file that is reloaded whenever it changes (default res/tuning.cfg, see Tuning.h)\n"
+           << "  --telemetry  write the stats of every frame to this file at exit (JSON if it ends with .json, CSV otherwise)\n"
+           << "               with the window T writes them at any time (default telemetry.csv)\n"
+           << "  --expect-zero-allocs  fail the headless run (exit code 1) if the second half of it allocates\n"
+           << "  --cache-memory  MiB kept by the cache that restores the rays of earlier light positions (default 64, 0 disables it)\n";
+    }
+};
@@ -0,0 +1,405 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "SFML/Graphics.hpp"
+
+#include "Ray.h"
+#include "Simulation.h"
+
+// Fixed scenes that are completely described at compile time, for deployments that never change their scene.
+// The ray directions, the tangents of every occluder and the angular bins that accelerate the tracing are
+// constexpr data, at runtime the rays are only traced against read-only tables (nothing is built at start-up).
+//
+//   struct MyScene
+//   {
+//       static constexpr ConstexprSceneDescription<2, 1> Describe() { return { { { { 300.f, 200.f, 40.f }, { 600.f, 400.f, 80.f } } }, { { { 20.f, 20.f } } } }; }
+//   };
+//   ConstexprScene<MyScene, 2048>::Trace<RayQuery::EntryExit>(rays);
+
+// The std math functions aren't constexpr in C++17
+struct ConstexprMath
+{
+public:
+    static constexpr double s_Pi = 3.14159265358979323846;
+
+    static constexpr double Abs(double x) { return x < 0.0 ? -x : x; }
+
+    static constexpr double Sqrt(double x)
+    {
+        if (x <= 0.0)
+            return 0.0;
+        double root = x > 1.0 ? x : 1.0;
+        for (size_t i = 0; i < 128; ++i)
+        {
+            const double next = 0.5 * (root + x / root);
+            if (next >= root)
+                break;
+            root = next;
+        }
+        return root;
+    }
+
+    // Angle in [-pi, pi]
+    static constexpr double Reduce(double x)
+    {
+        const double turns = x / (2.0 * s_Pi);
+        const double rounded = static_cast<double>(static_cast<long long>(turns + (turns >= 0.0 ? 0.5 : -0.5)));
+        return x - rounded * 2.0 * s_Pi;
+    }
+
+    static constexpr double Sin(double x)
+    {
+        x = Reduce(x);
+        double term = x;
+        double sum = x;
+        for (size_t i = 1; i < 24; ++i)
+        {
+            term *= -x * x / static_cast<double>((2 * i) * (2 * i + 1));
+            sum += term;
+        }
+        return sum;
+    }
+
+    static constexpr double Cos(double x)
+    {
+        x = Reduce(x);
+        double term = 1.0;
+        double sum = 1.0;
+        for (size_t i = 1; i < 24; ++i)
+        {
+            term *= -x * x / static_cast<double>((2 * i - 1) * (2 * i));
+            sum += term;
+        }
+        return sum;
+    }
+
+    static constexpr double Atan(double x)
+    {
+        if (x < 0.0)
+            return -Atan(-x);
+        if (x > 1.0)
+            return s_Pi / 2.0 - Atan(1.0 / x);
+        if (x > 0.41421356237309503) // tan(pi / 8), keeps the series short
+            return s_Pi / 4.0 + Atan((x - 1.0) / (x + 1.0));
+
+        double power = x;
+        double sum = x;
+        for (size_t i = 1; i < 40; ++i)
+        {
+            power *= -x * x;
+            sum += power / static_cast<double>(2 * i + 1);
+        }
+        return sum;
+    }
+
+    static constexpr double Atan2(double y, double x)
+    {
+        if (x > 0.0)
+            return Atan(y / x);
+        if (x < 0.0)
+            return y >= 0.0 ? Atan(y / x) + s_Pi : Atan(y / x) - s_Pi;
+        return y > 0.0 ? s_Pi / 2.0 : (y < 0.0 ? -s_Pi / 2.0 : 0.0);
+    }
+
+    static constexpr double Asin(double x)
+    {
+        return Atan2(x, Sqrt(1.0 - x * x));
+    }
+};
+
+
+// sf::Vector2 has no constexpr constructors, the description uses plain floats
+struct ConstexprCircle
+{
+public:
+    float x = 0.f;
+    float y = 0.f;
+    float radius = 0.f;
+};
+
+struct ConstexprLight
+{
+public:
+    float x = 0.f;
+    float y = 0.f;
+};
+
+template <size_t OccluderCount, size_t LightCount>
+struct ConstexprSceneDescription
+{
+public:
+    std::array<ConstexprCircle, OccluderCount> occluders;
+    std::array<ConstexprLight, LightCount> lights;
+};
+
+
+// Everything in here only runs in the compiler
+template <class Description, size_t RaysPerLight, size_t Bins>
+struct ConstexprSceneBuilder
+{
+public:
+    static constexpr auto s_Scene = Description::Describe();
+    static constexpr size_t s_Occluders = s_Scene.occluders.size();
+    static constexpr size_t s_Lights = s_Scene.lights.size();
+    static constexpr double s_BinAngle = 2.0 * ConstexprMath::s_Pi / static_cast<double>(Bins);
+    static constexpr double s_Epsilon = 1e-4; // widens the tangents a little, the runtime directions are floats
+
+    // Angular interval of an occluder as seen from a light, start going counter-clockwise over width
+    struct Tangents
+    {
+    public:
+        double start = 0.0; // [0, 2 pi)
+        double width = 0.0;
+        float nearDistance = 0.f; // lower bound of the t of any hit, the bins are sorted by it
+    };
+
+    struct Direction
+    {
+    public:
+        float x = 0.f;
+        float y = 0.f;
+    };
+
+    static constexpr std::array<Direction, RaysPerLight> BuildDirections()
+    {
+        std::array<Direction, RaysPerLight> directions{};
+        for (size_t i = 0; i < RaysPerLight; ++i)
+        {
+            const double angle = 2.0 * ConstexprMath::s_Pi * static_cast<double>(i) / static_cast<double>(RaysPerLight);
+            directions[i] = { static_cast<float>(ConstexprMath::Cos(angle)), static_cast<float>(ConstexprMath::Sin(angle)) };
+        }
+        return directions;
+    }
+
+    static constexpr std::array<Tangents, s_Lights * s_Occluders> BuildTangents()
+    {
+        std::array<Tangents, s_Lights * s_Occluders> tangents{};
+        for (size_t light = 0; light < s_Lights; ++light)
+        {
+            for (size_t i = 0; i < s_Occluders; ++i)
+            {
+                const ConstexprCircle& circle = s_Scene.occluders[i];
+                const double dx = static_cast<double>(circle.x) - static_cast<double>(s_Scene.lights[light].x);
+                const double dy = static_cast<double>(circle.y) - static_cast<double>(s_Scene.lights[light].y);
+                const double distance = ConstexprMath::Sqrt(dx * dx + dy * dy);
+                const double radius = static_cast<double>(circle.radius);
+
+                Tangents& tangent = tangents[light * s_Occluders + i];
+                if (distance <= radius + s_Epsilon)
+                {
+                    // the light is inside, every direction hits and the entry point can lie behind the light
+                    tangent.start = 0.0;
+                    tangent.width = 2.0 * ConstexprMath::s_Pi;
+                    tangent.nearDistance = static_cast<float>(-(distance + radius));
+                    continue;
+                }
+
+                const double halfWidth = ConstexprMath::Asin(radius / distance) + s_Epsilon;
+                double start = ConstexprMath::Atan2(dy, dx) - halfWidth;
+                while (start < 0.0)
+                    start += 2.0 * ConstexprMath::s_Pi;
+                tangent.start = start;
+                tangent.width = 2.0 * halfWidth;
+                tangent.nearDistance = static_cast<float>(distance - radius);
+            }
+        }
+        return tangents;
+    }
+
+    static constexpr std::array<Tangents, s_Lights * s_Occluders> s_Tangents = BuildTangents();
+
+    static constexpr size_t FirstBin(const Tangents& tangent) { return static_cast<size_t>(tangent.start / s_BinAngle); }
+    static constexpr size_t BinCount(const Tangents& tangent)
+    {
+        const size_t last = static_cast<size_t>((tangent.start + tangent.width) / s_BinAngle);
+        return last - FirstBin(tangent) + 1 < Bins ? last - FirstBin(tangent) + 1 : Bins;
+    }
+
+    static constexpr std::array<uint32_t, s_Lights * Bins + 1> BuildOffsets()
+    {
+        std::array<uint32_t, s_Lights * Bins + 1> offsets{};
+        for (size_t light = 0; light < s_Lights; ++light)
+        {
+            for (size_t i = 0; i < s_Occluders; ++i)
+            {
+                const Tangents& tangent = s_Tangents[light * s_Occluders + i];
+                for (size_t bin = 0; bin < BinCount(tangent); ++bin)
+                    ++offsets[light * Bins + (FirstBin(tangent) + bin) % Bins + 1];
+            }
+        }
+        for (size_t i = 1; i < offsets.size(); ++i)
+            offsets[i] += offsets[i - 1];
+        return offsets;
+    }
+
+    static constexpr std::array<uint32_t, s_Lights * Bins + 1> s_Offsets = BuildOffsets();
+    static constexpr size_t s_EntryCount = s_Offsets[s_Lights * Bins];
+
+    // Occluder indices of every bin, nearest first so that the tracing can stop early
+    static constexpr std::array<uint16_t, (s_EntryCount > 0 ? s_EntryCount : 1)> BuildEntries()
+    {
+        std::array<uint16_t, (s_EntryCount > 0 ? s_EntryCount : 1)> entries{};
+        std::array<uint32_t, s_Lights * Bins + 1> fill = s_Offsets;
+        for (size_t light = 0; light < s_Lights; ++light)
+        {
+            for (size_t i = 0; i < s_Occluders; ++i)
+            {
+                const Tangents& tangent = s_Tangents[light * s_Occluders + i];
+                for (size_t bin = 0; bin < BinCount(tangent); ++bin)
+                    entries[fill[light * Bins + (FirstBin(tangent) + bin) % Bins]++] = static_cast<uint16_t>(i);
+            }
+
+            for (size_t bin = light * Bins; bin < (light + 1) * Bins; ++bin)
+            {
+                for (size_t i = s_Offsets[bin] + 1; i < s_Offsets[bin + 1]; ++i)
+                {
+                    const uint16_t entry = entries[i];
+                    const float key = s_Tangents[light * s_Occluders + entry].nearDistance;
+                    size_t j = i;
+                    for (; j > s_Offsets[bin] && s_Tangents[light * s_Occluders + entries[j - 1]].nearDistance > key; --j)
+                        entries[j] = entries[j - 1];
+                    entries[j] = entry;
+                }
+            }
+        }
+        return entries;
+    }
+};
+
+
+template <class Description, size_t RaysPerLight, size_t Bins = 256>
+struct ConstexprScene
+{
+private:
+    using Builder = ConstexprSceneBuilder<Description, RaysPerLight, Bins>;
+    static_assert(Builder::s_Occluders <= UINT16_MAX, "occluder indices are stored as 16 bit");
+    static_assert(RaysPerLight != 0 && Bins != 0);
+
+    static constexpr auto s_Directions = Builder::BuildDirections();
+    static constexpr auto s_Entries = Builder::BuildEntries();
+public:
+    static constexpr auto& s_Scene = Builder::s_Scene;
+    static constexpr auto& s_Tangents = Builder::s_Tangents;
+    static constexpr size_t s_Occluders = Builder::s_Occluders;
+    static constexpr size_t s_Lights = Builder::s_Lights;
+    static constexpr size_t s_EntryCount = Builder::s_EntryCount; // occluder references over all bins
+
+    // Casts RaysPerLight rays evenly around every light (same directions as Simulation::Trace), each one stops
+    // at the nearest occluder. Every hit is passed to sink(const RayPair&), returns the hit count.
+    template <RayQuery Query, class Sink>
+    static inline size_t Trace(Sink&& sink)
+    {
+        size_t hits = 0;
+        for (size_t light = 0; light < s_Lights; ++light)
+        {
+            const sf::Vector2f origin(s_Scene.lights[light].x, s_Scene.lights[light].y);
+            for (size_t i = 0; i < RaysPerLight; ++i)
+            {
+                const sf::Vector2f direction(s_Directions[i].x, s_Directions[i].y);
+                const size_t bin = light * Bins + i * Bins / RaysPerLight;
+
+                float nearest = 0.f;
+                float exit = 0.f;
+                bool hit = false;
+                for (size_t entry = Builder::s_Offsets[bin]; entry < Builder::s_Offsets[bin + 1]; ++entry)
+                {
+                    const size_t index = s_Entries[entry];
+                    if (hit && s_Tangents[light * s_Occluders + index].nearDistance >= nearest)
+                        break; // the rest is sorted by distance, none of them can be closer
+
+                    const ConstexprCircle& circle = s_Scene.occluders[index];
+                    float tNear, tFar;
+                    if (!IntersectCircle<float, Query>(origin, direction, circle.radius, sf::Vector2f(circle.x, circle.y), tNear, tFar))
+                        continue;
+
+                    if constexpr (Query == RayQuery::AnyHit)
+                    {
+                        hit = true;
+                        break;
+                    }
+                    else if (!hit || tNear < nearest)
+                    {
+                        nearest = tNear;
+                        exit = tFar;
+                        hit = true;
+                    }
+                }
+
+                if (!hit)
+                    continue;
+
+                RayPair rays{ origin };
+                rays.light.m_Type = Ray::Type::Light;
+                if constexpr (Query != RayQuery::AnyHit)
+                    rays.light.m_Intersection = origin + direction * nearest;
+                if constexpr (Query == RayQuery::EntryExit)
+                {
+                    rays.shadow.m_Origin = origin + direction * exit;
+                    rays.shadow.m_Intersection = rays.shadow.m_Origin + direction * (exit * sg_TScalar);
+                    rays.shadow.m_Type = Ray::Type::Shadow;
+                }
+                sink(static_cast<const RayPair&>(rays));
+                ++hits;
+            }
+        }
+        return hits;
+    }
+
+    // Same output as Simulation::Trace
+    template <RayQuery Query>
+    static inline size_t Trace(std::vector<Ray>& rays)
+    {
+        rays.clear();
+        return Trace<Query>([&rays](const RayPair& pair)
+        {
+            if constexpr (Query != RayQuery::AnyHit)
+            {
+                rays.push_back(pair.light);
+                if (pair.shadow.m_Type != Ray::Type::None)
+                    rays.push_back(pair.shadow);
+            }
+        });
+    }
+
+    // For drawing and streaming, the only part that's built at runtime
+    static inline std::array<Body, s_Occluders> Occluders()
+    {
+        std::array<Body, s_Occluders> bodies;
+        for (size_t i = 0; i < s_Occluders; ++i)
+            bodies[i] = Body{ { s_Scene.occluders[i].x, s_Scene.occluders[i].y }, {}, s_Scene.occluders[i].radius };
+        return bodies;
+    }
+
+    static inline std::array<Body, s_Lights> Lights()
+    {
+        std::array<Body, s_Lights> bodies;
+        for (size_t i = 0; i < s_Lights; ++i)
+            bodies[i] = Body{ { s_Scene.lights[i].x, s_Scene.lights[i].y }, {}, 8.f };
+        return bodies;
+    }
+};
+
+
+// Ring of occluders around two lights, used by 'mode fixed' of the headless runner
+struct DemoConstexprScene
+{
+public:
+    static constexpr ConstexprSceneDescription<48, 2> Describe()
+    {
+        ConstexprSceneDescription<48, 2> scene{};
+        for (size_t i = 0; i < 48; ++i)
+        {
+            const double angle = 2.0 * ConstexprMath::s_Pi * static_cast<double>(i) / 48.0;
+            const double distance = i % 2 == 0 ? 300.0 : 200.0;
+            scene.occluders[i] = { static_cast<float>(500.0 + ConstexprMath::Cos(angle) * distance),
+                                   static_cast<float>(375.0 + ConstexprMath::Sin(angle) * distance * 0.9),
+                                   static_cast<float>(8 + i % 5 * 3) };
+        }
+        scene.lights[0] = { 420.f, 360.f };
+        scene.lights[1] = { 610.f, 400.f };
+        return scene;
+    }
+};
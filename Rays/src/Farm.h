@@ -0,0 +1,618 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iomanip>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <Windows.h>
+#else
+    #include <spawn.h>
+    #include <sys/types.h>
+    #include <sys/wait.h>
+    extern char** environ;
+#endif
+
+#include "SFML/Network.hpp"
+#include "SFML/System.hpp"
+
+#include "Benchmark.h"
+#include "Ray.h"
+#include "Scene.h"
+#include "Simulation.h"
+#include "ThreadPool.h"
+
+// Local render farm: a coordinator runs the simulation and splits every frame's rays into angular
+// ranges (work units) that worker processes trace. Everything goes through sf::Packet over loopback.
+//   coordinator -> worker: Scene (occluders, lights), Work (light, first ray, ray count), Quit
+//   worker -> coordinator: Hello (thread count), Result (the traced rays of one unit)
+enum class FarmMessage : sf::Uint8 { Hello, Scene, Work, Result, Quit };
+static inline constexpr sf::Uint32 sg_FarmProtocolVersion = 1;
+
+
+inline sf::Packet& operator<<(sf::Packet& packet, FarmMessage message)
+{
+    return packet << static_cast<sf::Uint8>(message);
+}
+
+inline sf::Packet& operator<<(sf::Packet& packet, const Ray& ray)
+{
+    return packet << ray.m_Origin.x << ray.m_Origin.y << ray.m_Intersection.x << ray.m_Intersection.y << static_cast<sf::Uint8>(ray.m_Type);
+}
+
+inline sf::Packet& operator>>(sf::Packet& packet, Ray& ray)
+{
+    sf::Uint8 type = 0;
+    packet >> ray.m_Origin.x >> ray.m_Origin.y >> ray.m_Intersection.x >> ray.m_Intersection.y >> type;
+    ray.m_Type = type <= static_cast<sf::Uint8>(Ray::Type::None) ? static_cast<Ray::Type>(type) : Ray::Type::None;
+    return packet;
+}
+
+// workers only need the shape of a body, the velocity stays on the coordinator
+inline sf::Packet& operator<<(sf::Packet& packet, const Body& body)
+{
+    return packet << body.position.x << body.position.y << body.radius;
+}
+
+inline sf::Packet& operator>>(sf::Packet& packet, Body& body)
+{
+    return packet >> body.position.x >> body.position.y >> body.radius;
+}
+
+
+// Worker processes are started by the coordinator and reaped once the run is over
+struct ChildProcess
+{
+private:
+#ifdef _WIN32
+    PROCESS_INFORMATION m_Info = {};
+#else
+    pid_t m_Pid = -1;
+#endif
+public:
+    inline bool Spawn(const std::string& program, const std::vector<std::string>& args)
+    {
+#ifdef _WIN32
+        std::string commandLine = '"' + program + '"';
+        for (const std::string& arg : args)
+            commandLine += " \"" + arg + '"';
+
+        STARTUPINFOA startupInfo = {};
+        startupInfo.cb = sizeof(startupInfo);
+        return CreateProcessA(nullptr, &commandLine[0], nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startupInfo, &m_Info) != 0;
+#else
+        std::vector<std::string> storage;
+        storage.push_back(program);
+        storage.insert(storage.end(), args.begin(), args.end());
+        std::vector<char*> argv;
+        for (std::string& arg : storage)
+            argv.push_back(&arg[0]);
+        argv.push_back(nullptr);
+        return posix_spawnp(&m_Pid, program.c_str(), nullptr, nullptr, argv.data(), environ) == 0;
+#endif
+    }
+
+    inline void Wait()
+    {
+#ifdef _WIN32
+        if (m_Info.hProcess == nullptr)
+            return;
+        WaitForSingleObject(m_Info.hProcess, INFINITE);
+        CloseHandle(m_Info.hProcess);
+        CloseHandle(m_Info.hThread);
+        m_Info = {};
+#else
+        if (m_Pid <= 0)
+            return;
+        int status = 0;
+        waitpid(m_Pid, &status, 0);
+        m_Pid = -1;
+#endif
+    }
+};
+
+
+struct FarmWorker
+{
+private:
+    ThreadPool m_Pool;
+    Simulation m_Simulation;
+    sf::TcpSocket m_Socket;
+    std::vector<Ray> m_Rays;
+    sf::Uint32 m_Frame = 0;
+    sf::Uint32 m_RaysPerLight = 0;
+    bool m_Shadows = true;
+    sf::Time m_Delay; // artificial slowdown per unit, makes re-assignment testable on one machine
+private:
+    inline void ReadScene(sf::Packet& packet)
+    {
+        sf::Uint8 shadows = 0;
+        sf::Uint32 occluderCount = 0;
+        sf::Uint32 lightCount = 0;
+        packet >> m_Frame >> m_RaysPerLight >> shadows >> occluderCount;
+        m_Shadows = shadows != 0;
+        m_Simulation.occluders.resize(occluderCount);
+        for (Body& body : m_Simulation.occluders)
+            packet >> body;
+        packet >> lightCount;
+        m_Simulation.lights.resize(lightCount);
+        for (Body& body : m_Simulation.lights)
+            packet >> body;
+    }
+
+    inline bool TraceUnit(sf::Packet& packet)
+    {
+        sf::Uint32 frame = 0, unit = 0, light = 0, first = 0, count = 0;
+        packet >> frame >> unit >> light >> first >> count;
+        if (!packet || light >= m_Simulation.lights.size() || first + count > m_RaysPerLight)
+            return false;
+
+        if (m_Delay != sf::Time::Zero)
+            sf::sleep(m_Delay);
+
+        m_Rays.clear();
+        const size_t hits = m_Shadows
+            ? m_Simulation.TraceRange<float, RayQuery::EntryExit>(light, first, count, m_RaysPerLight, m_Rays)
+            : m_Simulation.TraceRange<float, RayQuery::NearestHit>(light, first, count, m_RaysPerLight, m_Rays);
+
+        sf::Packet result;
+        result << FarmMessage::Result << frame << unit << static_cast<sf::Uint32>(hits) << static_cast<sf::Uint32>(m_Rays.size());
+        for (const Ray& ray : m_Rays)
+            result << ray;
+        return m_Socket.send(result) == sf::Socket::Done;
+    }
+public:
+    inline FarmWorker(size_t threads, sf::Time delay) : m_Pool(threads), m_Simulation(m_Pool), m_Delay(delay) {}
+
+    // Returns once the coordinator sends Quit or disconnects
+    inline int Run(const sf::IpAddress& host, unsigned short port, std::ostream& err)
+    {
+        if (m_Socket.connect(host, port, sf::seconds(10.f)) != sf::Socket::Done)
+        {
+            err << "Worker: failed to connect to " << host << ':' << port << '\n';
+            return 1;
+        }
+
+        sf::Packet hello;
+        hello << FarmMessage::Hello << sg_FarmProtocolVersion << static_cast<sf::Uint32>(m_Pool.ThreadCount());
+        if (m_Socket.send(hello) != sf::Socket::Done)
+            return 1;
+
+        while (true)
+        {
+            sf::Packet packet;
+            if (m_Socket.receive(packet) != sf::Socket::Done)
+                return 0;
+
+            sf::Uint8 type = 0;
+            packet >> type;
+            if (type == static_cast<sf::Uint8>(FarmMessage::Scene))
+                ReadScene(packet);
+            else if (type == static_cast<sf::Uint8>(FarmMessage::Work))
+            {
+                if (!TraceUnit(packet))
+                {
+                    err << "Worker: invalid work unit\n";
+                    return 1;
+                }
+            }
+            else if (type == static_cast<sf::Uint8>(FarmMessage::Quit))
+                return 0;
+        }
+    }
+};
+
+
+struct FarmCoordinator
+{
+private:
+    static inline constexpr size_t s_RaysPerUnit = 256;
+    static inline constexpr size_t s_UnitsInFlight = 2; // per worker, hides the round trip
+    static inline constexpr size_t s_MaxAssignments = 2; // a unit is handed out at most twice
+    static inline constexpr float s_SlowFactor = 3.f;    // outstanding for this many average unit times counts as slow
+
+    struct Unit
+    {
+    public:
+        sf::Uint32 light = 0;
+        sf::Uint32 first = 0;
+        sf::Uint32 count = 0;
+        bool done = false;
+        size_t assignments = 0;
+        sf::Time assigned;
+        size_t hits = 0;
+        std::vector<Ray> rays;
+    };
+
+    struct InFlight
+    {
+    public:
+        sf::Uint32 frame;
+        sf::Uint32 unit;
+        sf::Time assigned;
+    };
+
+    struct Connection
+    {
+    public:
+        std::unique_ptr<sf::TcpSocket> socket;
+        std::vector<InFlight> inFlight;
+        bool alive = true;
+        size_t threads = 0;
+        size_t units = 0;
+        size_t duplicates = 0; // results that arrived after another worker finished the unit
+        size_t rays = 0;
+        sf::Time busy; // summed round trip time of the units
+    };
+
+    Scene m_Scene;
+    ThreadPool m_Pool;
+    Simulation m_Simulation;
+    Benchmark m_Benchmark;
+    sf::TcpListener m_Listener;
+    sf::SocketSelector m_Selector;
+    std::vector<Connection> m_Connections;
+    std::vector<ChildProcess> m_Children;
+    std::vector<Unit> m_Units;
+    std::deque<size_t> m_Pending;
+    size_t m_Remaining = 0;
+    sf::Uint32 m_Frame = 0;
+    sf::Clock m_Clock;
+    sf::Time m_UnitTime; // moving average of the round trip of one unit
+    size_t m_Reassigned = 0;
+    size_t m_LocalUnits = 0;
+    std::vector<Ray> m_Rays; // merged result of the current frame
+private:
+    inline bool AcceptWorkers(size_t count, std::ostream& err)
+    {
+        m_Selector.add(m_Listener);
+        const sf::Clock timeout;
+        while (m_Connections.size() < count)
+        {
+            if (timeout.getElapsedTime() > sf::seconds(10.f) || !m_Selector.wait(sf::seconds(1.f)))
+            {
+                if (timeout.getElapsedTime() > sf::seconds(10.f))
+                {
+                    err << "Coordinator: only " << m_Connections.size() << " of " << count << " workers connected\n";
+                    break;
+                }
+                continue;
+            }
+
+            Connection connection;
+            connection.socket = std::make_unique<sf::TcpSocket>();
+            if (m_Listener.accept(*connection.socket) != sf::Socket::Done)
+                continue;
+
+            sf::Packet hello;
+            sf::Uint8 type = 0;
+            sf::Uint32 version = 0, threads = 0;
+            if (connection.socket->receive(hello) != sf::Socket::Done || !(hello >> type >> version >> threads)
+                || type != static_cast<sf::Uint8>(FarmMessage::Hello) || version != sg_FarmProtocolVersion)
+            {
+                err << "Coordinator: rejected a worker with an invalid handshake\n";
+                continue;
+            }
+
+            connection.threads = threads;
+            m_Selector.add(*connection.socket);
+            m_Connections.push_back(std::move(connection));
+        }
+        m_Selector.remove(m_Listener);
+        return !m_Connections.empty();
+    }
+
+    inline void Disconnect(Connection& connection)
+    {
+        connection.alive = false;
+        m_Selector.remove(*connection.socket);
+        connection.socket->disconnect();
+        for (const InFlight& inFlight : connection.inFlight)
+            if (inFlight.frame == m_Frame && !m_Units[inFlight.unit].done)
+                m_Pending.push_front(inFlight.unit);
+        connection.inFlight.clear();
+    }
+
+    inline void Send(Connection& connection, sf::Packet& packet)
+    {
+        if (connection.alive && connection.socket->send(packet) != sf::Socket::Done)
+            Disconnect(connection);
+    }
+
+    inline void BroadcastScene()
+    {
+        sf::Packet packet;
+        packet << FarmMessage::Scene << m_Frame << static_cast<sf::Uint32>(m_Scene.raysPerLight) << static_cast<sf::Uint8>(m_Scene.shadow)
+               << static_cast<sf::Uint32>(m_Simulation.occluders.size());
+        for (const Body& body : m_Simulation.occluders)
+            packet << body;
+        packet << static_cast<sf::Uint32>(m_Simulation.lights.size());
+        for (const Body& body : m_Simulation.lights)
+            packet << body;
+
+        for (Connection& connection : m_Connections)
+            Send(connection, packet);
+    }
+
+    inline void Assign(Connection& connection, size_t index)
+    {
+        Unit& unit = m_Units[index];
+        const sf::Time now = m_Clock.getElapsedTime();
+        unit.assigned = now;
+        ++unit.assignments;
+        connection.inFlight.push_back({ m_Frame, static_cast<sf::Uint32>(index), now });
+
+        sf::Packet packet;
+        packet << FarmMessage::Work << m_Frame << static_cast<sf::Uint32>(index) << unit.light << unit.first << unit.count;
+        Send(connection, packet);
+    }
+
+    inline bool IsAssignedTo(const Connection& connection, size_t index) const
+    {
+        for (const InFlight& inFlight : connection.inFlight)
+            if (inFlight.frame == m_Frame && inFlight.unit == index)
+                return true;
+        return false;
+    }
+
+    // Hands out pending units, once there are none left idle workers duplicate units that are
+    // taking much longer than usual, whichever copy comes back first is used
+    inline void Dispatch()
+    {
+        for (Connection& connection : m_Connections)
+        {
+            while (connection.alive && connection.inFlight.size() < s_UnitsInFlight && !m_Pending.empty())
+            {
+                const size_t index = m_Pending.front();
+                m_Pending.pop_front();
+                if (!m_Units[index].done)
+                    Assign(connection, index);
+            }
+        }
+
+        if (!m_Pending.empty() || m_UnitTime == sf::Time::Zero)
+            return;
+
+        const sf::Time now = m_Clock.getElapsedTime();
+        const sf::Time slow = std::max(m_UnitTime * s_SlowFactor, sf::milliseconds(2));
+        for (Connection& connection : m_Connections)
+        {
+            if (!connection.alive || !connection.inFlight.empty())
+                continue;
+
+            size_t oldest = m_Units.size();
+            for (size_t i = 0; i < m_Units.size(); ++i)
+            {
+                const Unit& unit = m_Units[i];
+                if (!unit.done && unit.assignments < s_MaxAssignments && now - unit.assigned > slow && !IsAssignedTo(connection, i)
+                    && (oldest == m_Units.size() || unit.assigned < m_Units[oldest].assigned))
+                    oldest = i;
+            }
+            if (oldest == m_Units.size())
+                return;
+
+            ++m_Reassigned;
+            Assign(connection, oldest);
+        }
+    }
+
+    inline void Receive(Connection& connection)
+    {
+        sf::Packet packet;
+        if (connection.socket->receive(packet) != sf::Socket::Done)
+        {
+            Disconnect(connection);
+            return;
+        }
+
+        sf::Uint8 type = 0;
+        sf::Uint32 frame = 0, index = 0, hits = 0, rayCount = 0;
+        if (!(packet >> type >> frame >> index >> hits >> rayCount) || type != static_cast<sf::Uint8>(FarmMessage::Result))
+        {
+            Disconnect(connection);
+            return;
+        }
+
+        const auto inFlight = std::find_if(connection.inFlight.begin(), connection.inFlight.end(),
+            [&](const InFlight& unit) { return unit.frame == frame && unit.unit == index; });
+        if (inFlight == connection.inFlight.end())
+        {
+            Disconnect(connection); // never handed out to this worker
+            return;
+        }
+
+        const sf::Time roundTrip = m_Clock.getElapsedTime() - inFlight->assigned;
+        connection.inFlight.erase(inFlight);
+        connection.busy += roundTrip;
+        m_UnitTime = m_UnitTime == sf::Time::Zero ? roundTrip : (m_UnitTime * static_cast<sf::Int64>(7) + roundTrip) / static_cast<sf::Int64>(8);
+
+        if (frame != m_Frame || m_Units[index].done)
+        {
+            ++connection.duplicates;
+            return;
+        }
+
+        Unit& unit = m_Units[index];
+        unit.rays.resize(rayCount);
+        for (Ray& ray : unit.rays)
+            packet >> ray;
+        if (!packet)
+        {
+            Disconnect(connection);
+            return;
+        }
+
+        unit.hits = hits;
+        unit.done = true;
+        --m_Remaining;
+        ++connection.units;
+        connection.rays += rayCount;
+    }
+
+    // Without any workers left the coordinator finishes the frame itself
+    inline void TraceLocally()
+    {
+        for (Unit& unit : m_Units)
+        {
+            if (unit.done)
+                continue;
+            unit.rays.clear();
+            unit.hits = m_Scene.shadow
+                ? m_Simulation.TraceRange<float, RayQuery::EntryExit>(unit.light, unit.first, unit.count, m_Scene.raysPerLight, unit.rays)
+                : m_Simulation.TraceRange<float, RayQuery::NearestHit>(unit.light, unit.first, unit.count, m_Scene.raysPerLight, unit.rays);
+            unit.done = true;
+            ++m_LocalUnits;
+        }
+        m_Remaining = 0;
+        m_Pending.clear();
+    }
+
+    inline bool AnyAlive() const
+    {
+        return std::any_of(m_Connections.begin(), m_Connections.end(), [](const Connection& connection) { return connection.alive; });
+    }
+
+    // Returns the number of hits, the merged rays are in the same order Simulation::Trace produces
+    inline size_t TraceFrame()
+    {
+        const Benchmark::ScopedStage stage(m_Benchmark, Benchmark::Stage::Trace);
+        BroadcastScene();
+
+        m_Units.clear();
+        m_Pending.clear();
+        for (size_t light = 0; light < m_Simulation.lights.size(); ++light)
+        {
+            for (size_t first = 0; first < m_Scene.raysPerLight; first += s_RaysPerUnit)
+            {
+                Unit unit;
+                unit.light = static_cast<sf::Uint32>(light);
+                unit.first = static_cast<sf::Uint32>(first);
+                unit.count = static_cast<sf::Uint32>(std::min(s_RaysPerUnit, m_Scene.raysPerLight - first));
+                m_Pending.push_back(m_Units.size());
+                m_Units.push_back(std::move(unit));
+            }
+        }
+        m_Remaining = m_Units.size();
+
+        while (m_Remaining != 0)
+        {
+            if (!AnyAlive())
+            {
+                TraceLocally();
+                break;
+            }
+
+            Dispatch();
+            if (!m_Selector.wait(sf::milliseconds(1)))
+                continue;
+            for (Connection& connection : m_Connections)
+                if (connection.alive && m_Selector.isReady(*connection.socket))
+                    Receive(connection);
+        }
+
+        m_Rays.clear();
+        size_t hits = 0;
+        for (const Unit& unit : m_Units)
+        {
+            m_Rays.insert(m_Rays.end(), unit.rays.begin(), unit.rays.end());
+            hits += unit.hits;
+        }
+        return hits;
+    }
+
+    inline void Report(std::ostream& os, size_t frames, double seconds) const
+    {
+        size_t rays = 0;
+        for (const Connection& connection : m_Connections)
+            rays += connection.rays;
+
+        os << std::fixed << std::setprecision(2);
+        os << "Render farm: " << m_Connections.size() << " workers, " << frames << " frames in " << seconds << "s\n";
+        os << "Frames/sec: " << static_cast<double>(frames) / seconds << " | Rays/sec: " << static_cast<double>(m_Benchmark.Rays()) / seconds
+           << " | reassigned units: " << m_Reassigned << " | traced by the coordinator: " << m_LocalUnits << '\n';
+        os << "Worker  Threads    Units  Duplicates        Rays     Rays/sec  Avg unit(ms)  Share(%)\n";
+        for (size_t i = 0; i < m_Connections.size(); ++i)
+        {
+            const Connection& connection = m_Connections[i];
+            const size_t handled = connection.units + connection.duplicates;
+            os << std::setw(6) << i << std::setw(9) << connection.threads << std::setw(9) << connection.units << std::setw(12) << connection.duplicates
+               << std::setw(12) << connection.rays << std::setw(13) << static_cast<double>(connection.rays) / seconds
+               << std::setw(14) << (handled == 0 ? 0.0 : static_cast<double>(connection.busy.asMicroseconds()) / 1e3 / static_cast<double>(handled))
+               << std::setw(10) << (rays == 0 ? 0.0 : static_cast<double>(connection.rays) * 100.0 / static_cast<double>(rays))
+               << (connection.alive ? "" : "  (disconnected)") << '\n';
+        }
+        m_Benchmark.Print(os);
+    }
+public:
+    inline explicit FarmCoordinator(const Scene& scene) : m_Scene(scene), m_Simulation(m_Pool) {}
+
+    // Spawns the workers (program is the path of this executable), runs the frames and prints the report.
+    // threads is per worker (0 splits the hardware threads evenly), the first worker sleeps delayMs per unit.
+    inline int Run(const std::string& program, size_t workers, size_t threads, size_t delayMs, size_t frames, std::ostream& os, std::ostream& err)
+    {
+        if (m_Listener.listen(sf::Socket::AnyPort, sf::IpAddress::LocalHost) != sf::Socket::Done)
+        {
+            err << "Coordinator: failed to listen on loopback\n";
+            return 1;
+        }
+
+        if (threads == 0)
+            threads = std::max<size_t>(std::thread::hardware_concurrency() / workers, 1);
+        for (size_t i = 0; i < workers; ++i)
+        {
+            std::vector<std::string> args = { "--worker", "--port", std::to_string(static_cast<unsigned int>(m_Listener.getLocalPort())), "--threads", std::to_string(threads) };
+            if (i == 0 && delayMs != 0)
+                args.insert(args.end(), { "--delay", std::to_string(delayMs) });
+
+            ChildProcess child;
+            if (!child.Spawn(program, args))
+                err << "Coordinator: failed to start worker " << i << '\n';
+            else
+                m_Children.push_back(child);
+        }
+
+        if (!AcceptWorkers(m_Children.size(), err))
+            err << "Coordinator: no workers, tracing everything locally\n";
+
+        const sf::Vector2f bounds(static_cast<float>(m_Scene.size.x), static_cast<float>(m_Scene.size.y));
+        m_Simulation.Spawn(m_Scene.occluders, m_Scene.lights, bounds, m_Scene.seed);
+
+        const sf::Clock clock;
+        sf::Time previous;
+        for (size_t frame = 0; frame < frames; ++frame)
+        {
+            m_Frame = static_cast<sf::Uint32>(frame);
+            m_Simulation.Advance(m_Scene.timeStep, m_Benchmark);
+            TraceFrame();
+
+            const sf::Time now = clock.getElapsedTime();
+            m_Benchmark.EndFrame(static_cast<double>((now - previous).asMicroseconds()) / 1e6, m_Rays.size());
+            previous = now;
+        }
+        const double seconds = std::max(static_cast<double>(clock.getElapsedTime().asMicroseconds()) / 1e6, 1e-6);
+
+        sf::Packet quit;
+        quit << FarmMessage::Quit;
+        for (Connection& connection : m_Connections)
+            Send(connection, quit);
+        for (ChildProcess& child : m_Children)
+            child.Wait();
+
+        Report(os, frames, seconds);
+        return 0;
+    }
+
+    inline const std::vector<Ray>& Rays() const { return m_Rays; }
+};
@@ -0,0 +1,106 @@
+#pragma once
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+#ifdef __linux__
+    #include <cstring>
+    #include <fcntl.h>
+    #include <sys/inotify.h>
+    #include <unistd.h>
+#endif
+
+#include "SFML/System/Clock.hpp"
+
+// Reports changes of a single file, cheap enough to be polled every frame.
+// Linux uses inotify on the parent directory (editors often save by renaming a temporary file),
+// everywhere else or if inotify isn't available the modification time is polled twice a second.
+struct FileWatcher
+{
+private:
+    std::filesystem::path m_Path;
+    std::filesystem::file_time_type m_LastWrite;
+    sf::Clock m_PollClock;
+#ifdef __linux__
+    int m_Fd = -1;
+#endif
+private:
+    inline std::filesystem::file_time_type LastWrite() const
+    {
+        std::error_code error;
+        const std::filesystem::file_time_type time = std::filesystem::last_write_time(m_Path, error);
+        return error ? std::filesystem::file_time_type::min() : time;
+    }
+
+#ifdef __linux__
+    // drains every pending event, returns true if one of them was about the file
+    inline bool ReadEvents()
+    {
+        alignas(inotify_event) char buffer[4096];
+        const std::string name = m_Path.filename().string();
+        bool changed = false;
+        while (true)
+        {
+            const ssize_t length = read(m_Fd, buffer, sizeof(buffer));
+            if (length <= 0)
+                return changed;
+
+            for (ssize_t offset = 0; offset < length;)
+            {
+                inotify_event event;
+                std::memcpy(&event, buffer + offset, sizeof(event));
+                if (event.len != 0 && name == buffer + offset + sizeof(inotify_event))
+                    changed = true;
+                offset += static_cast<ssize_t>(sizeof(inotify_event) + event.len);
+            }
+        }
+    }
+#endif
+public:
+    inline explicit FileWatcher(const std::string& path) : m_Path(path), m_LastWrite(LastWrite())
+    {
+#ifdef __linux__
+        m_Fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (m_Fd == -1)
+            return;
+
+        std::filesystem::path directory = m_Path.parent_path();
+        if (directory.empty())
+            directory = ".";
+        if (inotify_add_watch(m_Fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) == -1)
+        {
+            close(m_Fd);
+            m_Fd = -1;
+        }
+#endif
+    }
+
+    inline ~FileWatcher()
+    {
+#ifdef __linux__
+        if (m_Fd != -1)
+            close(m_Fd);
+#endif
+    }
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // True once per change of the file
+    inline bool Poll()
+    {
+#ifdef __linux__
+        if (m_Fd != -1)
+            return ReadEvents();
+#endif
+        if (m_PollClock.getElapsedTime() < sf::milliseconds(500))
+            return false;
+        m_PollClock.restart();
+
+        const std::filesystem::file_time_type lastWrite = LastWrite();
+        if (lastWrite == m_LastWrite)
+            return false;
+        m_LastWrite = lastWrite;
+        return true;
+    }
+};
@@ -0,0 +1,186 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// Fixed capacity array on memory of a FrameArena, never owns or frees anything.
+// Elements past size() aren't constructed, push_back constructs them in place.
+template <class T>
+struct ArenaArray
+{
+private:
+    T* m_Data = nullptr;
+    size_t m_Size = 0;
+    size_t m_Capacity = 0;
+public:
+    ArenaArray() = default;
+    inline ArenaArray(T* data, size_t size, size_t capacity) : m_Data(data), m_Size(size), m_Capacity(capacity) {}
+
+    inline void push_back(const T& value) { assert(m_Size < m_Capacity); new (m_Data + m_Size++) T(value); }
+    inline void clear() { m_Size = 0; }
+
+    inline T* data() { return m_Data; }
+    inline const T* data() const { return m_Data; }
+    inline size_t size() const { return m_Size; }
+    inline size_t capacity() const { return m_Capacity; }
+    inline bool empty() const { return m_Size == 0; }
+    inline T* begin() { return m_Data; }
+    inline T* end() { return m_Data + m_Size; }
+    inline const T* begin() const { return m_Data; }
+    inline const T* end() const { return m_Data + m_Size; }
+    inline T& operator[](size_t i) { return m_Data[i]; }
+    inline const T& operator[](size_t i) const { return m_Data[i]; }
+};
+
+
+// Bump allocator for transient per frame data (ray slots, culling candidates, scanlines).
+// Every thread of the owning ThreadPool bumps in its own region, so parallel jobs never contend.
+// Reset() at the start of a recompute frees everything at once. If a region runs out, the rest of the
+// frame falls back to the heap and the next Reset() grows the region to the high-water mark,
+// so frames in steady state don't allocate at all.
+struct FrameArena
+{
+public:
+    struct Stats
+    {
+    public:
+        size_t capacity = 0;  // bytes reserved over all regions
+        size_t highWater = 0; // most bytes a single frame needed
+        size_t overflows = 0; // heap allocations because a region was full, counted at Reset()
+        size_t resets = 0;
+    };
+private:
+    static constexpr size_t s_Alignment = 64;
+    static constexpr size_t s_MinRegionSize = 64 * 1024;
+
+    struct alignas(64) Region
+    {
+    public:
+        std::unique_ptr<unsigned char[]> memory;
+        size_t capacity = 0;
+        size_t used = 0;
+        size_t peak = 0; // this frame, including the overflow
+        size_t overflowBytes = 0;
+        size_t overflows = 0; // since the last Reset(), added to the stats there so that threads never share a counter
+        std::vector<std::unique_ptr<unsigned char[]>> overflow;
+    };
+
+    static inline thread_local const FrameArena* s_Owner = nullptr;
+    static inline thread_local size_t s_ThreadIndex = 0;
+
+    std::vector<Region> m_Regions;
+    Stats m_Stats;
+private:
+    // Threads that weren't bound (the one calling ParallelFor) use the first region
+    inline Region& Local()
+    {
+        return m_Regions[s_Owner == this ? s_ThreadIndex : 0];
+    }
+
+    inline void* Allocate(size_t bytes, size_t alignment)
+    {
+        Region& region = Local();
+        const size_t offset = (region.used + alignment - 1) / alignment * alignment;
+        if (offset + bytes <= region.capacity)
+        {
+            region.used = offset + bytes;
+            region.peak = std::max(region.peak, region.used + region.overflowBytes);
+            return region.memory.get() + offset;
+        }
+
+        // new already aligns to alignof(std::max_align_t), anything above that gets some slack
+        const size_t slack = alignment > alignof(std::max_align_t) ? alignment : 0;
+        region.overflow.push_back(std::make_unique<unsigned char[]>(bytes + slack));
+        region.overflowBytes += bytes;
+        region.peak = std::max(region.peak, region.used + region.overflowBytes);
+        ++region.overflows;
+
+        void* ptr = region.overflow.back().get();
+        size_t space = bytes + slack;
+        return std::align(alignment, bytes, ptr, space);
+    }
+public:
+    inline explicit FrameArena(size_t threads) : m_Regions(std::max<size_t>(threads, 1)) {}
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // Called once by every worker thread of the pool before it runs any job
+    inline void BindThread(size_t index)
+    {
+        assert(index < m_Regions.size());
+        s_Owner = this;
+        s_ThreadIndex = index;
+    }
+
+    // Invalidates everything that was allocated, must not be called while a ParallelFor is running
+    inline void Reset()
+    {
+        size_t frameBytes = 0;
+        for (Region& region : m_Regions)
+        {
+            frameBytes += region.peak;
+            if (region.peak > region.capacity)
+            {
+                const size_t capacity = std::max(region.peak + region.peak / 2, s_MinRegionSize);
+                m_Stats.capacity += capacity - region.capacity;
+                region.memory = std::make_unique<unsigned char[]>(capacity);
+                region.capacity = capacity;
+            }
+            m_Stats.overflows += region.overflows;
+            region.overflows = 0;
+            region.overflow.clear();
+            region.overflowBytes = 0;
+            region.used = 0;
+            region.peak = 0;
+        }
+        m_Stats.highWater = std::max(m_Stats.highWater, frameBytes);
+        ++m_Stats.resets;
+    }
+
+    // Default constructed, the memory is gone after the next Reset()
+    template <class T>
+    inline T* Allocate(size_t count)
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "arena memory is never destroyed");
+        T* data = static_cast<T*>(Allocate(count * sizeof(T), std::max(alignof(T), s_Alignment)));
+        std::uninitialized_default_construct_n(data, count);
+        return data;
+    }
+
+    // Only reserves the memory, nothing is constructed up front
+    template <class T>
+    inline ArenaArray<T> AllocateArray(size_t capacity)
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "arena memory is never destroyed");
+        return ArenaArray<T>(static_cast<T*>(Allocate(capacity * sizeof(T), std::max(alignof(T), s_Alignment))), 0, capacity);
+    }
+
+    // Frees everything the calling thread allocated since the scope was opened
+    struct Scope
+    {
+    private:
+        Region& m_Region;
+        size_t m_Used;
+        size_t m_OverflowBytes;
+        size_t m_Overflows;
+    public:
+        inline explicit Scope(FrameArena& arena)
+            : m_Region(arena.Local()), m_Used(m_Region.used), m_OverflowBytes(m_Region.overflowBytes), m_Overflows(m_Region.overflow.size()) {}
+
+        inline ~Scope()
+        {
+            m_Region.used = m_Used;
+            m_Region.overflowBytes = m_OverflowBytes;
+            m_Region.overflow.resize(m_Overflows);
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    inline const Stats& GetStats() const { return m_Stats; }
+};
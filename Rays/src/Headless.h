@@ -0,0 +1,336 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <vector>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <Windows.h>
+    #include <Psapi.h>
+#else
+    #include <sys/resource.h>
+#endif
+
+#include "SFML/Graphics.hpp"
+
+#include "Benchmark.h"
+#include "ConstexprScene.h"
+#include "LightMap.h"
+#include "Ray.h"
+#include "RayCache.h"
+#include "Scene.h"
+#include "SdfEngine.h"
+#include "Simulation.h"
+#include "Stream.h"
+#include "Telemetry.h"
+#include "ThreadPool.h"
+#include "VisibilityCache.h"
+
+// Peak resident set size of the process in bytes, 0 if it can't be queried
+inline size_t PeakMemoryUsage()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) == 0)
+        return 0;
+    return static_cast<size_t>(counters.PeakWorkingSetSize);
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+    #ifdef __APPLE__
+        return static_cast<size_t>(usage.ru_maxrss); // bytes on macOS
+    #else
+        return static_cast<size_t>(usage.ru_maxrss) * 1024; // kilobytes on Linux
+    #endif
+#endif
+}
+
+
+// Runs the per frame pipeline of the app without a window (input replay, recompute,
+// CPU rasterise, HUD stats), nothing in here needs a display or an OpenGL context
+struct HeadlessRunner
+{
+private:
+    using FixedScene = ConstexprScene<DemoConstexprScene, 4096>;
+
+    Scene m_Scene;
+    StreamServer& m_Stream;
+    Telemetry& m_Telemetry;
+    ThreadPool m_Pool;
+    Benchmark m_Benchmark;
+    Simulation m_Simulation;
+    SdfScene m_SdfScene = DemoSdfScene();
+    SdfTracer m_SdfTracer;
+    LightMap m_LightMap;
+    CompactRayCache m_RayCache;
+    VisibilityCache m_VisibilityCache;
+    std::vector<Ray> m_Rays;
+    std::vector<LightMap::Light> m_Lights;
+    std::vector<sf::Uint8> m_SdfPixels;
+    uint64_t m_OccluderVersion = 0;
+    uint64_t m_SdfVersion = UINT64_MAX;
+    bool m_Dirty = true; // same as circleOrLightMoved of the window loop
+    size_t m_NextEvent = 0;
+
+    // HUD values of the last frame
+    size_t m_LightRays = 0;
+    size_t m_ShadowRays = 0;
+    size_t m_StepTime = 0;
+private:
+    inline sf::FloatRect View() const
+    {
+        return sf::FloatRect(0.f, 0.f, static_cast<float>(m_Scene.size.x), static_cast<float>(m_Scene.size.y));
+    }
+
+    inline void ApplyEvents(size_t frame)
+    {
+        for (; m_NextEvent < m_Scene.events.size() && m_Scene.events[m_NextEvent].frame <= frame; ++m_NextEvent)
+        {
+            const Scene::Event& event = m_Scene.events[m_NextEvent];
+            switch (event.type)
+            {
+            case Scene::Event::Type::MoveLight:
+                m_Scene.lightPosition = event.value;
+                break;
+            case Scene::Event::Type::MoveCircle:
+                m_Scene.circlePosition = event.value;
+                ++m_OccluderVersion;
+                break;
+            case Scene::Event::Type::SetRadius:
+                m_Scene.radius = std::max(event.value.x, 1.f);
+                ++m_OccluderVersion;
+                break;
+            case Scene::Event::Type::ToggleLight:
+                m_Scene.light = !m_Scene.light;
+                break;
+            case Scene::Event::Type::ToggleShadow:
+                m_Scene.shadow = !m_Scene.shadow;
+                break;
+            case Scene::Event::Type::ToggleLightMap:
+                m_Scene.lightMap = !m_Scene.lightMap;
+                break;
+            case Scene::Event::Type::SetMode:
+                m_Scene.mode = event.mode;
+                break;
+            case Scene::Event::Type::Resize:
+                m_Scene.size = sf::Vector2u(static_cast<unsigned int>(event.value.x), static_cast<unsigned int>(event.value.y));
+                ++m_OccluderVersion;
+                break;
+            default:
+                break;
+            }
+            m_Dirty = true;
+        }
+    }
+
+    // Every event of the replay can lead to a new visibility cache key, reserving an entry for each one
+    // keeps the cache misses of the run from allocating
+    inline void WarmVisibilityCache()
+    {
+        bool staticMode = m_Scene.mode == Scene::Mode::Static;
+        for (const Scene::Event& event : m_Scene.events)
+            staticMode |= event.type == Scene::Event::Type::SetMode && event.mode == Scene::Mode::Static;
+        if (staticMode)
+            m_VisibilityCache.Reserve(m_Scene.events.size() + 1, m_Scene.rays);
+    }
+
+    template <class Occluders>
+    inline void RenderLightMap(const Occluders& occluders)
+    {
+        const Benchmark::ScopedStage stage(m_Benchmark, Benchmark::Stage::Rasterise);
+        m_LightMap.Render(m_Lights, occluders, m_Scene.size, m_Pool);
+    }
+
+    // Returns the number of rays that were calculated this frame
+    inline size_t SimulationFrame()
+    {
+        const sf::Vector2f bounds(static_cast<float>(m_Scene.size.x), static_cast<float>(m_Scene.size.y));
+        if (m_Simulation.occluders.empty())
+            m_Simulation.Spawn(m_Scene.occluders, m_Scene.lights, bounds, m_Scene.seed);
+        m_Simulation.SetBounds(bounds);
+
+        const auto start = std::chrono::steady_clock::now();
+        const bool stepped = m_Simulation.Advance(m_Scene.timeStep, m_Benchmark) != 0;
+        size_t rays = 0;
+        if (m_Scene.lightMap)
+        {
+            m_Lights.clear();
+            for (const Body& light : m_Simulation.lights)
+                m_Lights.push_back({ light.position, Ray::LightColor() });
+            RenderLightMap(m_Simulation.occluders);
+            m_LightRays = m_ShadowRays = 0;
+        }
+        else if (stepped || m_Dirty)
+        {
+            const size_t hits = m_Scene.shadow
+                ? m_Simulation.Trace<float, RayQuery::EntryExit>(m_Scene.raysPerLight, m_Rays, m_Benchmark)
+                : m_Simulation.Trace<float, RayQuery::NearestHit>(m_Scene.raysPerLight, m_Rays, m_Benchmark);
+            m_RayCache.Assign(m_Rays, View());
+            m_LightRays = hits;
+            m_ShadowRays = m_Scene.shadow ? hits : 0;
+            rays = m_Rays.size();
+        }
+        m_StepTime = static_cast<size_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+        return rays;
+    }
+
+    inline size_t SdfFrame()
+    {
+        if (!m_Dirty)
+            return 0;
+
+        m_SdfScene.primitives.back().a = m_Scene.circlePosition;
+        m_SdfScene.primitives.back().radius = m_Scene.radius;
+        if (m_SdfVersion != m_OccluderVersion)
+        {
+            const Benchmark::ScopedStage stage(m_Benchmark, Benchmark::Stage::Rasterise);
+            m_SdfVersion = m_OccluderVersion;
+            m_SdfScene.Rasterise(m_SdfPixels, m_Scene.size, sf::Color::White, m_Pool);
+        }
+
+        const Benchmark::ScopedStage stage(m_Benchmark, Benchmark::Stage::Trace);
+        const size_t hits = m_SdfTracer.Trace(m_SdfScene, m_Scene.lightPosition, m_Scene.sdfRays, m_Scene.shadow, m_Pool, m_Rays);
+        m_RayCache.Assign(m_Rays, View());
+        m_LightRays = hits;
+        m_ShadowRays = m_Scene.shadow ? hits : 0;
+        return m_Rays.size();
+    }
+
+    // Nothing moves, the rays only change with the shadow toggle
+    inline size_t FixedFrame()
+    {
+        if (!m_Dirty)
+            return 0;
+
+        if (m_Scene.lightMap)
+        {
+            m_Lights.clear();
+            for (const Body& light : FixedScene::Lights())
+                m_Lights.push_back({ light.position, Ray::LightColor() });
+            RenderLightMap(FixedScene::Occluders());
+            m_LightRays = m_ShadowRays = 0;
+            return 0;
+        }
+
+        const Benchmark::ScopedStage stage(m_Benchmark, Benchmark::Stage::Trace);
+        const size_t hits = m_Scene.shadow
+            ? FixedScene::Trace<RayQuery::EntryExit>(m_Rays)
+            : FixedScene::Trace<RayQuery::NearestHit>(m_Rays);
+        m_RayCache.Assign(m_Rays, View());
+        m_LightRays = hits;
+        m_ShadowRays = m_Scene.shadow ? hits : 0;
+        return m_Rays.size();
+    }
+
+    inline size_t StaticFrame()
+    {
+        if (!m_Dirty)
+            return 0;
+
+        if (m_Scene.lightMap)
+        {
+            m_Lights.assign(1, { m_Scene.lightPosition, Ray::LightColor() });
+            RenderLightMap(std::array<Body, 1>{ Body{ m_Scene.circlePosition, {}, m_Scene.radius } });
+            m_LightRays = m_ShadowRays = 0;
+            return 0;
+        }
+        if (!m_Scene.light && !m_Scene.shadow)
+            return 0;
+
+        const Benchmark::ScopedStage stage(m_Benchmark, Benchmark::Stage::Trace);
+        const size_t misses = m_VisibilityCache.Misses();
+        const auto [lightRays, shadowRays] = TraceStaticScene(m_VisibilityCache, m_RayCache, m_Scene.lightPosition, m_Scene.circlePosition,
+            m_Scene.radius, m_OccluderVersion, m_Scene.rays, SweepStep(), m_Scene.shadow, View());
+        m_LightRays = lightRays;
+        m_ShadowRays = shadowRays;
+        return m_VisibilityCache.Misses() != misses ? lightRays + shadowRays : 0;
+    }
+public:
+    inline HeadlessRunner(const Scene& scene, StreamServer& stream, Telemetry& telemetry, size_t visibilityCacheMemory)
+        : m_Scene(scene), m_Stream(stream), m_Telemetry(telemetry), m_Simulation(m_Pool), m_VisibilityCache(visibilityCacheMemory) {}
+
+    // With expectZeroAllocations the run fails (returns 1) if the second half, the steady state, allocated
+    inline int Run(size_t frames, bool expectZeroAllocations, std::ostream& os)
+    {
+        WarmVisibilityCache();
+        const auto start = std::chrono::steady_clock::now();
+        auto previous = start;
+        size_t totalRays = 0;
+        size_t vertices = 0;
+        const size_t allocationsAtStart = sg_Allocations.load(std::memory_order_relaxed);
+        size_t allocationsAtHalf = allocationsAtStart;
+
+        for (size_t frame = 0; frame < frames; ++frame)
+        {
+            if (frame == frames / 2)
+                allocationsAtHalf = sg_Allocations.load(std::memory_order_relaxed); // the second half is the steady state
+            ApplyEvents(frame);
+
+            size_t rays = 0;
+            if (m_Scene.mode == Scene::Mode::Simulation)
+                rays = SimulationFrame();
+            else if (m_Scene.mode == Scene::Mode::Sdf)
+                rays = SdfFrame();
+            else if (m_Scene.mode == Scene::Mode::Fixed)
+                rays = FixedFrame();
+            else
+                rays = StaticFrame();
+            m_Dirty = false;
+
+            if (!m_Scene.lightMap || m_Scene.mode == Scene::Mode::Sdf)
+            {
+                // what the window loop hands to the GPU
+                const Benchmark::ScopedStage stage(m_Benchmark, Benchmark::Stage::Draw);
+                vertices += m_RayCache.Expand(m_Scene.light, m_Scene.shadow);
+            }
+
+            if (m_Scene.mode == Scene::Mode::Simulation)
+                m_Stream.Publish(m_Simulation.occluders, m_Simulation.lights, m_RayCache.Rays());
+            else if (m_Scene.mode == Scene::Mode::Fixed)
+                m_Stream.Publish(FixedScene::Occluders(), FixedScene::Lights(), m_RayCache.Rays());
+            else
+                m_Stream.Publish(std::array<Body, 1>{ Body{ m_Scene.circlePosition, {}, m_Scene.radius } },
+                    std::array<Body, 1>{ Body{ m_Scene.lightPosition, {}, 20.f } }, m_RayCache.Rays());
+
+            const auto now = std::chrono::steady_clock::now();
+            const double frameSeconds = std::chrono::duration<double>(now - previous).count();
+            m_Benchmark.EndFrame(frameSeconds, rays);
+            m_Telemetry.EndFrame(m_Benchmark, frameSeconds, rays, m_Scene.light ? m_LightRays : 0, m_Scene.shadow ? m_ShadowRays : 0);
+            previous = now;
+            totalRays += rays;
+        }
+
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        os << std::fixed << std::setprecision(2);
+        os << "Headless run: " << frames << " frames in " << seconds << "s\n";
+        os << "Frames/sec: " << (seconds > 0.0 ? static_cast<double>(frames) / seconds : 0.0) << '\n';
+        os << "Rays/sec: " << (seconds > 0.0 ? static_cast<double>(totalRays) / seconds : 0.0) << " (" << totalRays << " rays calculated)\n";
+        os << "Vertices expanded: " << vertices << '\n';
+        const size_t allocations = sg_Allocations.load(std::memory_order_relaxed);
+        const FrameArena::Stats& arena = m_Pool.Arena().GetStats();
+        os << "Heap allocations: " << allocations - allocationsAtStart << " (" << allocations - allocationsAtHalf << " in the second half)\n";
+        os << "Frame arena: high-water " << static_cast<double>(arena.highWater) / 1024.0 << "KiB, reserved "
+           << static_cast<double>(arena.capacity) / 1024.0 << "KiB, " << arena.overflows << " overflows\n";
+        os << "Peak RSS: " << static_cast<double>(PeakMemoryUsage()) / (1024.0 * 1024.0) << "MiB\n";
+        os << "Last frame HUD: light rays " << (m_Scene.light ? m_LightRays : 0) << " | shadow rays " << (m_Scene.shadow ? m_ShadowRays : 0)
+           << " | step " << m_StepTime << "us | cache hits " << m_VisibilityCache.HitRate() << "%\n";
+        m_Benchmark.Print(os);
+        m_Stream.Print(os);
+        if (expectZeroAllocations && allocations != allocationsAtHalf)
+        {
+            os << "Expected no heap allocations in the second half, got " << allocations - allocationsAtHalf << '\n';
+            return 1;
+        }
+        return 0;
+    }
+};
@@ -0,0 +1,226 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <limits>
+#include <ostream>
+#include <thread>
+
+#include "SFML/System/Vector2.hpp"
+
+// Microseconds on the steady clock, comparable across threads
+inline int64_t InputTimestamp()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+// Lock-free ring buffer for exactly one producer and one consumer thread, Push fails if it's full
+template <class T, size_t Capacity>
+struct SpscQueue
+{
+private:
+    static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "Capacity has to be a power of two");
+
+    std::array<T, Capacity> m_Items;
+    alignas(64) std::atomic<size_t> m_Head{ 0 }; // next item to pop, written by the consumer
+    alignas(64) std::atomic<size_t> m_Tail{ 0 }; // next free slot, written by the producer
+public:
+    inline bool Push(const T& item)
+    {
+        const size_t tail = m_Tail.load(std::memory_order_relaxed);
+        if (tail - m_Head.load(std::memory_order_acquire) == Capacity)
+            return false;
+        m_Items[tail & (Capacity - 1)] = item;
+        m_Tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    inline bool Pop(T& item)
+    {
+        const size_t head = m_Head.load(std::memory_order_relaxed);
+        if (head == m_Tail.load(std::memory_order_acquire))
+            return false;
+        item = m_Items[head & (Capacity - 1)];
+        m_Head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Only meaningful on the consumer side
+    inline const T* Peek() const
+    {
+        const size_t head = m_Head.load(std::memory_order_relaxed);
+        if (head == m_Tail.load(std::memory_order_acquire))
+            return nullptr;
+        return &m_Items[head & (Capacity - 1)];
+    }
+};
+
+
+struct InputEvent
+{
+public:
+    enum class Type { MoveCircle, MoveLight, ResizeCircle };
+
+    Type type = Type::MoveCircle;
+    sf::Vector2f value; // new center, x holds the radius change for ResizeCircle
+    int64_t timestamp = 0;
+};
+
+
+// What the simulation thread owns, the render thread only ever sees copies
+struct SceneState
+{
+public:
+    sf::Vector2f circlePosition; // center
+    float radius = 100.f;
+    sf::Vector2f lightPosition;  // center
+    int64_t inputTimestamp = 0;  // oldest input that went into this state
+};
+
+
+// Applies the input events at a fixed tick rate on its own thread and publishes every changed state.
+// Events are only applied once the tick has caught up with their timestamp, so a burst of events that
+// arrives late is still spread over the ticks it happened in.
+struct SceneThread
+{
+private:
+    static constexpr int64_t s_TickRate = 240; // ticks per second
+    static constexpr int64_t s_TickTime = 1000000 / s_TickRate;
+
+    SpscQueue<InputEvent, 1024> m_Events;
+    SpscQueue<SceneState, 64> m_States;
+    SceneState m_State;
+    std::atomic<bool> m_Running{ true };
+    std::thread m_Thread;
+private:
+    inline bool Apply(const InputEvent& event)
+    {
+        switch (event.type)
+        {
+        case InputEvent::Type::MoveCircle:
+            if (m_State.circlePosition == event.value)
+                return false;
+            m_State.circlePosition = event.value;
+            return true;
+        case InputEvent::Type::MoveLight:
+            if (m_State.lightPosition == event.value)
+                return false;
+            m_State.lightPosition = event.value;
+            return true;
+        case InputEvent::Type::ResizeCircle:
+        {
+            const float radius = std::max(m_State.radius + event.value.x, 1.f);
+            if (radius == m_State.radius)
+                return false;
+            m_State.radius = radius;
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+
+    inline void Run()
+    {
+        bool pending = false; // changes that didn't fit into the state queue yet
+        int64_t tick = InputTimestamp();
+        while (m_Running.load(std::memory_order_relaxed))
+        {
+            tick += s_TickTime;
+            std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::microseconds(tick)));
+
+            const InputEvent* next = m_Events.Peek();
+            while (next != nullptr && next->timestamp <= tick)
+            {
+                InputEvent event;
+                m_Events.Pop(event);
+                if (Apply(event))
+                {
+                    m_State.inputTimestamp = pending ? std::min(m_State.inputTimestamp, event.timestamp) : event.timestamp;
+                    pending = true;
+                }
+                next = m_Events.Peek();
+            }
+
+            if (pending && m_States.Push(m_State))
+                pending = false;
+
+            // don't try to catch up after the process was suspended
+            tick = std::max(tick, InputTimestamp() - s_TickTime);
+        }
+    }
+public:
+    inline explicit SceneThread(const SceneState& initial) : m_State(initial), m_Thread([this]() { Run(); }) {}
+
+    inline ~SceneThread()
+    {
+        m_Running.store(false, std::memory_order_relaxed);
+        m_Thread.join();
+    }
+
+    SceneThread(const SceneThread&) = delete;
+    SceneThread& operator=(const SceneThread&) = delete;
+
+    // Render thread only, drops the event if the simulation thread is that far behind
+    inline bool Post(InputEvent::Type type, const sf::Vector2f& value)
+    {
+        InputEvent event;
+        event.type = type;
+        event.value = value;
+        event.timestamp = InputTimestamp();
+        return m_Events.Push(event);
+    }
+
+    // Render thread only, returns false if nothing changed since the last call.
+    // state is set to the newest state, its timestamp to the oldest input of all states that were skipped.
+    inline bool Latest(SceneState& state)
+    {
+        SceneState next;
+        if (!m_States.Pop(next))
+            return false;
+
+        int64_t oldest = next.inputTimestamp;
+        do
+        {
+            state = next;
+            oldest = std::min(oldest, next.inputTimestamp);
+        } while (m_States.Pop(next));
+        state.inputTimestamp = oldest;
+        return true;
+    }
+};
+
+
+// End to end latency from an input event to the frame that shows it
+struct InputLatency
+{
+private:
+    int64_t m_Total = 0;
+    int64_t m_Max = 0;
+    int64_t m_Min = std::numeric_limits<int64_t>::max();
+    size_t m_Samples = 0;
+public:
+    inline int64_t Record(int64_t inputTimestamp)
+    {
+        const int64_t latency = InputTimestamp() - inputTimestamp;
+        m_Total += latency;
+        m_Max = std::max(m_Max, latency);
+        m_Min = std::min(m_Min, latency);
+        ++m_Samples;
+        return latency;
+    }
+
+    inline void Print(std::ostream& os) const
+    {
+        if (m_Samples == 0)
+            return;
+        os << std::fixed << std::setprecision(3);
+        os << "Input latency: avg " << static_cast<double>(m_Total) / static_cast<double>(m_Samples) / 1e3 << "ms min "
+           << static_cast<double>(m_Min) / 1e3 << "ms max " << static_cast<double>(m_Max) / 1e3 << "ms (" << m_Samples << " inputs)\n";
+    }
+};
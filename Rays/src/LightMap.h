@@ -0,0 +1,282 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "SFML/Graphics.hpp"
+
+#include "Ray.h"
+#include "ThreadPool.h"
+
+// Per pixel light map on the CPU. The screen is split into tiles that are shaded in parallel,
+// every tile only tests the shadow wedges that overlap it (found through a per tile bin list).
+// The bins of all tiles share one flat buffer, they are counted first and filled after a prefix sum.
+struct LightMap
+{
+public:
+    struct Light
+    {
+    public:
+        sf::Vector2f position;
+        sf::Color color = sf::Color::White;
+        float range = 700.f; // intensity falls off to 0 at this distance
+    };
+private:
+    // the region behind an occluder that a light can't reach
+    struct Wedge
+    {
+    public:
+        sf::Vector2f center;
+        float radius;
+        uint32_t light;
+        sf::Vector2f leftNormal;  // both edges point inwards
+        sf::Vector2f rightNormal;
+        sf::Vector2f axis;        // unit vector from the light to the occluder
+        float nearDistance;       // along the axis, nothing in front of the occluder is shadowed
+        float farDistance;        // along the axis, everything inside of the wedge past this is shadowed
+        sf::FloatRect bounds;
+    };
+
+    static inline constexpr unsigned int s_TileSize = 32;
+    static inline constexpr size_t s_MaxLights = 32; // shadowed lights of a pixel are tracked in a 32 bit mask
+
+    std::vector<sf::Uint8> m_Pixels;
+    std::vector<Wedge> m_Wedges;
+    std::vector<uint32_t> m_BinWedges; // wedge indices of all tiles, reused every frame
+    std::vector<uint32_t> m_BinStart;  // per tile offset into m_BinWedges
+    std::vector<uint32_t> m_BinSize;   // per tile, the count while binning and the filled size afterwards
+    std::vector<uint32_t> m_Shadowed;  // lights completely blocked for the whole tile
+    unsigned int m_TilesX = 0;
+    unsigned int m_TilesY = 0;
+public:
+    sf::Color ambient = sf::Color(25, 25, 30);
+private:
+    // Bounding box of the wedge clipped to the range of its light: tangent points, the far ends
+    // of both edges and every axis extreme of the range circle that lies inside of the wedge
+    static inline sf::FloatRect WedgeBounds(const Light& light, float angle, float halfAngle, float tangentLength, const sf::Vector2f& center, float radius)
+    {
+        float minX = center.x - radius, minY = center.y - radius;
+        float maxX = center.x + radius, maxY = center.y + radius;
+        const auto add = [&](float x, float y)
+        {
+            minX = std::min(minX, x);
+            minY = std::min(minY, y);
+            maxX = std::max(maxX, x);
+            maxY = std::max(maxY, y);
+        };
+
+        for (const float edge : { angle - halfAngle, angle + halfAngle })
+        {
+            add(light.position.x + std::cos(edge) * tangentLength, light.position.y + std::sin(edge) * tangentLength);
+            add(light.position.x + std::cos(edge) * light.range, light.position.y + std::sin(edge) * light.range);
+        }
+
+        constexpr float pi = 3.14159265f;
+        for (const float axis : { 0.f, pi * 0.5f, pi, pi * 1.5f })
+        {
+            const float difference = std::remainder(axis - angle, 2.f * pi);
+            if (std::abs(difference) <= halfAngle)
+                add(light.position.x + std::cos(axis) * light.range, light.position.y + std::sin(axis) * light.range);
+        }
+        return sf::FloatRect(minX, minY, maxX - minX, maxY - minY);
+    }
+
+    template <class Occluders>
+    inline void BuildWedges(const std::vector<Light>& lights, const Occluders& occluders)
+    {
+        m_Wedges.clear();
+        const size_t lightCount = std::min(lights.size(), s_MaxLights);
+        m_Wedges.reserve(lightCount * occluders.size()); // the most there can be, so a moving scene doesn't grow it
+        for (size_t l = 0; l < lightCount; ++l)
+        {
+            const Light& light = lights[l];
+            const size_t first = m_Wedges.size();
+            for (const auto& occluder : occluders)
+            {
+                const sf::Vector2f offset = occluder.position - light.position;
+                const float distance = std::sqrt(offset.x * offset.x + offset.y * offset.y);
+                if (distance <= occluder.radius || distance - occluder.radius >= light.range)
+                    continue; // light inside of the occluder or out of reach
+
+                const float halfAngle = std::asin(occluder.radius / distance);
+                const float angle = std::atan2(offset.y, offset.x);
+                const float tangentLength = std::sqrt(distance * distance - occluder.radius * occluder.radius);
+
+                Wedge wedge;
+                wedge.center = occluder.position;
+                wedge.radius = occluder.radius;
+                wedge.light = static_cast<uint32_t>(l);
+                wedge.leftNormal = { -std::sin(angle - halfAngle), std::cos(angle - halfAngle) };
+                wedge.rightNormal = { std::sin(angle + halfAngle), -std::cos(angle + halfAngle) };
+                wedge.axis = offset / distance;
+                wedge.nearDistance = distance - occluder.radius;
+                wedge.farDistance = distance;
+                wedge.bounds = WedgeBounds(light, angle, halfAngle, tangentLength, occluder.position, occluder.radius);
+                m_Wedges.push_back(wedge);
+            }
+
+            // close occluders first, they shadow the most pixels and let the rest be skipped early
+            std::sort(m_Wedges.begin() + static_cast<std::ptrdiff_t>(first), m_Wedges.end(),
+                [](const Wedge& a, const Wedge& b) { return a.nearDistance < b.nearDistance; });
+        }
+    }
+
+    // Bins a row of tiles, each row is only ever touched by one thread. Tiles outside of either edge
+    // or in front of the occluder are skipped, tiles fully behind the occluder are marked as shadowed.
+    // The first pass only counts the wedges per tile, the second one writes them. Shadowed bits are only
+    // ever added, so the second pass skips at least the wedges the first one did and stays within the count.
+    template <bool Fill>
+    inline void BinRow(const std::vector<Light>& lights, unsigned int tileY, const sf::Vector2u& size)
+    {
+        const float tile = static_cast<float>(s_TileSize);
+        const float top = static_cast<float>(tileY) * tile;
+        const float bottom = std::min(top + tile, static_cast<float>(size.y));
+
+        for (size_t i = 0; i < m_Wedges.size(); ++i)
+        {
+            const Wedge& wedge = m_Wedges[i];
+            if (wedge.bounds.top > bottom || wedge.bounds.top + wedge.bounds.height < top)
+                continue;
+
+            const int x0 = std::max(static_cast<int>(std::floor(wedge.bounds.left / tile)), 0);
+            const int x1 = std::min(static_cast<int>(std::floor((wedge.bounds.left + wedge.bounds.width) / tile)), static_cast<int>(m_TilesX) - 1);
+            const sf::Vector2f& origin = lights[wedge.light].position;
+            const uint32_t bit = 1u << wedge.light;
+            for (int x = x0; x <= x1; ++x)
+            {
+                const size_t index = static_cast<size_t>(tileY) * m_TilesX + static_cast<size_t>(x);
+                if (m_Shadowed[index] & bit)
+                    continue;
+
+                const float left = static_cast<float>(x) * tile;
+                const float right = std::min(left + tile, static_cast<float>(size.x));
+                const std::array<sf::Vector2f, 4> corners = { sf::Vector2f(left, top) - origin, sf::Vector2f(right, top) - origin,
+                    sf::Vector2f(left, bottom) - origin, sf::Vector2f(right, bottom) - origin };
+
+                size_t insideLeft = 0, insideRight = 0, pastNear = 0, pastFar = 0;
+                for (const sf::Vector2f& corner : corners)
+                {
+                    insideLeft += corner.x * wedge.leftNormal.x + corner.y * wedge.leftNormal.y >= 0.f;
+                    insideRight += corner.x * wedge.rightNormal.x + corner.y * wedge.rightNormal.y >= 0.f;
+                    const float along = corner.x * wedge.axis.x + corner.y * wedge.axis.y;
+                    pastNear += along >= wedge.nearDistance;
+                    pastFar += along >= wedge.farDistance;
+                }
+
+                if (insideLeft == 0 || insideRight == 0 || pastNear == 0)
+                    continue;
+                if (insideLeft == 4 && insideRight == 4 && pastFar == 4)
+                    m_Shadowed[index] |= bit;
+                else if constexpr (Fill)
+                    m_BinWedges[m_BinStart[index] + m_BinSize[index]++] = static_cast<uint32_t>(i);
+                else
+                    ++m_BinSize[index];
+            }
+        }
+    }
+
+    inline void ShadeTile(const std::vector<Light>& lights, unsigned int tileX, unsigned int tileY, const sf::Vector2u& size)
+    {
+        const size_t tile = static_cast<size_t>(tileY) * m_TilesX + tileX;
+        const uint32_t* binBegin = m_BinWedges.data() + m_BinStart[tile];
+        const uint32_t* binEnd = binBegin + m_BinSize[tile];
+        const size_t lightCount = std::min(lights.size(), s_MaxLights);
+        const unsigned int endX = std::min((tileX + 1) * s_TileSize, size.x);
+        const unsigned int endY = std::min((tileY + 1) * s_TileSize, size.y);
+
+        for (unsigned int y = tileY * s_TileSize; y < endY; ++y)
+        {
+            sf::Uint8* pixel = &m_Pixels[(static_cast<size_t>(y) * size.x + tileX * s_TileSize) * 4];
+            for (unsigned int x = tileX * s_TileSize; x < endX; ++x, pixel += 4)
+            {
+                const sf::Vector2f position(static_cast<float>(x) + 0.5f, static_cast<float>(y) + 0.5f);
+
+                // a pixel is shadowed if the segment from the light to it hits the occluder before reaching it
+                uint32_t shadowed = m_Shadowed[tile];
+                for (const uint32_t* index = binBegin; index != binEnd; ++index)
+                {
+                    const Wedge& wedge = m_Wedges[*index];
+                    const uint32_t bit = 1u << wedge.light;
+                    if (shadowed & bit)
+                        continue;
+
+                    const sf::Vector2f& origin = lights[wedge.light].position;
+                    if (SegmentHitsCircle(origin, position - origin, wedge.radius, wedge.center))
+                        shadowed |= bit;
+                }
+
+                float r = ambient.r, g = ambient.g, b = ambient.b;
+                for (size_t l = 0; l < lightCount; ++l)
+                {
+                    if (shadowed & (1u << l))
+                        continue;
+
+                    const Light& light = lights[l];
+                    const sf::Vector2f offset = position - light.position;
+                    const float distanceSquared = offset.x * offset.x + offset.y * offset.y;
+                    if (distanceSquared >= light.range * light.range)
+                        continue;
+
+                    const float falloff = 1.f - std::sqrt(distanceSquared) / light.range;
+                    const float intensity = falloff * falloff;
+                    r += light.color.r * intensity;
+                    g += light.color.g * intensity;
+                    b += light.color.b * intensity;
+                }
+
+                pixel[0] = static_cast<sf::Uint8>(std::min(r, 255.f));
+                pixel[1] = static_cast<sf::Uint8>(std::min(g, 255.f));
+                pixel[2] = static_cast<sf::Uint8>(std::min(b, 255.f));
+                pixel[3] = 255;
+            }
+        }
+    }
+public:
+    // Occluders is any range of objects with a position and radius. Returns the RGBA pixels, they stay valid
+    // until the next call and can go straight into sf::Texture::update() without copying them into an sf::Image
+    template <class Occluders>
+    inline const sf::Uint8* Render(const std::vector<Light>& lights, const Occluders& occluders, const sf::Vector2u& size, ThreadPool& pool)
+    {
+        m_Pixels.resize(static_cast<size_t>(size.x) * size.y * 4);
+        m_TilesX = (size.x + s_TileSize - 1) / s_TileSize;
+        m_TilesY = (size.y + s_TileSize - 1) / s_TileSize;
+        const size_t tiles = static_cast<size_t>(m_TilesX) * m_TilesY;
+        m_BinStart.resize(tiles);
+        m_BinSize.assign(tiles, 0);
+        m_Shadowed.assign(tiles, 0);
+
+        BuildWedges(lights, occluders);
+        pool.ParallelFor(m_TilesY, 1, [&](size_t begin, size_t end)
+        {
+            for (size_t row = begin; row < end; ++row)
+                BinRow<false>(lights, static_cast<unsigned int>(row), size);
+        });
+
+        uint32_t total = 0;
+        for (size_t tile = 0; tile < tiles; ++tile)
+        {
+            m_BinStart[tile] = total;
+            total += m_BinSize[tile];
+            m_BinSize[tile] = 0;
+        }
+        if (total > m_BinWedges.size())
+            m_BinWedges.resize(static_cast<size_t>(total) * 2); // room for the bins of a moving scene to vary
+
+        pool.ParallelFor(m_TilesY, 1, [&](size_t begin, size_t end)
+        {
+            for (size_t row = begin; row < end; ++row)
+                BinRow<true>(lights, static_cast<unsigned int>(row), size);
+        });
+
+        pool.ParallelFor(tiles, 4, [&](size_t begin, size_t end)
+        {
+            for (size_t tile = begin; tile < end; ++tile)
+                ShadeTile(lights, static_cast<unsigned int>(tile % m_TilesX), static_cast<unsigned int>(tile / m_TilesX), size);
+        });
+
+        return m_Pixels.data();
+    }
+};
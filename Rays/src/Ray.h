@@ -0,0 +1,334 @@
+#pragma once
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+#include "SFML/Graphics.hpp"
+
+inline float sg_TScalar = 10000.f; // length of the shadow rays as a multiple of t, tunable at runtime (see Tuning.h)
+
+struct Ray
+{
+private:
+    static sf::Color s_LightColor;
+    static sf::Color s_ShadowColor;
+public:
+    enum class Type { Light, Shadow, None };
+
+    sf::Vector2f m_Origin;
+    sf::Vector2f m_Intersection;
+    Type m_Type = Type::None;
+
+    inline Ray() = default;
+    inline explicit Ray(const sf::Vector2f& origin) : m_Origin(origin) {}
+
+    inline void Draw(sf::RenderWindow& window) const
+    {
+        if (m_Type == Type::Light)
+        {
+            const std::array<sf::Vertex, 2> line =
+            {
+                sf::Vertex(m_Origin, s_LightColor),
+                sf::Vertex(m_Intersection, s_LightColor)
+            };
+            window.draw(&line[0], 2, sf::Lines);
+        }
+        else
+        {
+            const std::array<sf::Vertex, 2> line =
+            {
+                sf::Vertex(m_Origin, s_ShadowColor),
+                sf::Vertex(m_Intersection, s_ShadowColor)
+            };
+            window.draw(&line[0], 2, sf::Lines);
+        }
+    }
+
+    static inline const sf::Color& LightColor() { return s_LightColor; }
+    static inline const sf::Color& ShadowColor() { return s_ShadowColor; }
+    static inline void SetColors(const sf::Color& light, const sf::Color& shadow) { s_LightColor = light; s_ShadowColor = shadow; }
+};
+inline sf::Color Ray::s_LightColor = sf::Color(255, 255, 102);
+inline sf::Color Ray::s_ShadowColor = sf::Color(70, 70, 70);
+
+
+struct RayPair
+{
+public:
+    Ray light;
+    Ray shadow;
+    inline explicit RayPair(const sf::Vector2f& origin) : light(origin) {}
+};
+
+
+// What a ray query has to resolve, everything the mode doesn't need is compiled out
+//  AnyHit:     only whether the circle is hit, no endpoints are calculated
+//  NearestHit: the light ray up to the nearest intersection
+//  EntryExit:  the light ray and the shadow ray starting at the exit point
+enum class RayQuery { AnyHit, NearestHit, EntryExit };
+
+
+// Direction change per ray of the static sweep, x is subtracted and y added (mirrored for the second half)
+struct SweepStep
+{
+public:
+    float x = 0.228f; // 0.225f
+    float y = 0.228f; // 0.225f
+
+    inline bool operator==(const SweepStep& other) const { return x == other.x && y == other.y; }
+    inline bool operator!=(const SweepStep& other) const { return !(*this == other); }
+};
+
+
+template <class T, RayQuery Query>
+inline void SetProperValues(Ray& light, Ray& shadow, const sf::Vector2<T>& origin, const sf::Vector2<T>& direction, T b, T root, T denominator);
+template <class T, RayQuery Query>
+inline RayPair CalculateRays(const sf::Vector2<T>& origin, const sf::Vector2<T>& direction, T radius, const sf::Vector2<T>& circlePos);
+inline RayPair CalculateRays(const sf::Vector2f& origin, const sf::Vector2f& direction, float radius, const sf::Vector2f& circlePos);
+template <class T, RayQuery Query>
+inline bool IntersectCircle(const sf::Vector2<T>& origin, const sf::Vector2<T>& direction, T radius, const sf::Vector2<T>& circlePos, T& tNear, T& tFar);
+template <class T>
+inline bool SegmentHitsCircle(const sf::Vector2<T>& origin, const sf::Vector2<T>& direction, T radius, const sf::Vector2<T>& circlePos);
+template <class T, RayQuery Query, class Occluders>
+inline RayPair TraceNearest(const sf::Vector2<T>& origin, const sf::Vector2<T>& direction, const Occluders& occluders);
+template <RayQuery Query, class Sink>
+inline size_t SweepCircle(const sf::Vector2f& origin, float radius, const sf::Vector2f& circlePos, size_t numRays, const SweepStep& step, float viewHeight, Sink&& sink);
+
+
+// The roots of the ray/circle quadratic are (-b +- root) / denominator
+template <class T, RayQuery Query>
+inline void SetProperValues(Ray& light, Ray& shadow, const sf::Vector2<T>& origin, const sf::Vector2<T>& direction, T b, T root, T denominator)
+{
+    static_assert(Query != RayQuery::AnyHit, "AnyHit has no endpoints");
+    if constexpr (Query == RayQuery::NearestHit)
+    {
+        // only the root closer to the origin, it's the one where b and root partly cancel out
+        static_cast<void>(shadow);
+        const T t = (b > 0 ? root - b : -b - root) / denominator;
+        light.m_Intersection = sf::Vector2f(origin + direction * t);
+    }
+    else
+    {
+        const T t1 = (-b + root) / denominator;
+        const T t2 = (-b - root) / denominator;
+        const sf::Vector2<T> point1 = origin + direction * t1;
+        const sf::Vector2<T> point2 = origin + direction * t2;
+
+        const sf::Vector2<T> vec1 = point1 - origin;
+        const sf::Vector2<T> vec2 = point2 - origin;
+
+        const T length1 = vec1.x * vec1.x + vec1.y * vec1.y;
+        const T length2 = vec2.x * vec2.x + vec2.y * vec2.y;
+
+        if (length1 < length2)
+        {
+            shadow.m_Origin = sf::Vector2f(point2);
+            shadow.m_Intersection = sf::Vector2f(point2 + direction * (t2 * static_cast<T>(sg_TScalar)));
+            light.m_Intersection = sf::Vector2f(point1);
+        }
+        else
+        {
+            shadow.m_Origin = sf::Vector2f(point1);
+            shadow.m_Intersection = sf::Vector2f(point1 + direction * (t1 * static_cast<T>(sg_TScalar)));
+            light.m_Intersection = sf::Vector2f(point2);
+        }
+    }
+}
+
+
+template <class T, RayQuery Query>
+inline RayPair CalculateRays(const sf::Vector2<T>& origin, const sf::Vector2<T>& direction, T radius, const sf::Vector2<T>& circlePos)
+{
+    RayPair rays{ sf::Vector2f(origin) };
+
+    const T a = direction.x * direction.x + direction.y * direction.y;
+    const T b = T(2) * origin.x * direction.x - T(2) * direction.x * circlePos.x + T(2) * origin.y * direction.y - T(2) * direction.y * circlePos.y;
+    const T c = origin.x * origin.x - T(2) * origin.x * circlePos.x + circlePos.x * circlePos.x + origin.y * origin.y - T(2) * origin.y * circlePos.y + circlePos.y * circlePos.y - radius * radius;
+
+    T discriminant = b * b - T(4) * a * c;
+    if (discriminant < 0)
+        return rays;
+
+    if constexpr (Query != RayQuery::AnyHit)
+    {
+        const T denominator = T(2) * a;
+        if (discriminant > 0)
+        {
+            SetProperValues<T, Query>(rays.light, rays.shadow, origin, direction, b, std::sqrt(discriminant), denominator);
+        }
+        else // discriminant == 0
+        {
+            const T t = -b / denominator;
+            const sf::Vector2<T> intersection = origin + direction * t;
+            rays.light.m_Intersection = sf::Vector2f(intersection);
+            if constexpr (Query == RayQuery::EntryExit)
+            {
+                rays.shadow.m_Origin = rays.light.m_Intersection;
+                rays.shadow.m_Intersection = sf::Vector2f(intersection + direction * (t * static_cast<T>(sg_TScalar))); // arbitrary scalar
+            }
+        }
+    }
+
+    rays.light.m_Type = Ray::Type::Light;
+    if constexpr (Query == RayQuery::EntryExit)
+        rays.shadow.m_Type = Ray::Type::Shadow;
+    return rays;
+}
+
+
+inline RayPair CalculateRays(const sf::Vector2f& origin, const sf::Vector2f& direction, float radius, const sf::Vector2f& circlePos)
+{
+    return CalculateRays<float, RayQuery::EntryExit>(origin, direction, radius, circlePos);
+}
+
+
+// Same quadratic as CalculateRays but only reports the t values, tNear <= tFar
+// Returns false if the ray misses or the circle lies behind the origin
+// AnyHit doesn't touch tNear and tFar, NearestHit only writes tNear
+template <class T, RayQuery Query>
+inline bool IntersectCircle(const sf::Vector2<T>& origin, const sf::Vector2<T>& direction, T radius, const sf::Vector2<T>& circlePos, T& tNear, T& tFar)
+{
+    const sf::Vector2<T> offset = origin - circlePos;
+    const T a = direction.x * direction.x + direction.y * direction.y;
+    const T b = T(2) * (offset.x * direction.x + offset.y * direction.y);
+    const T c = offset.x * offset.x + offset.y * offset.y - radius * radius;
+
+    const T discriminant = b * b - T(4) * a * c;
+    if (discriminant < 0)
+        return false;
+
+    if constexpr (Query == RayQuery::AnyHit)
+    {
+        static_cast<void>(tNear);
+        static_cast<void>(tFar);
+        return c > 0 && b < 0; // origin outside and facing the circle means both roots are positive
+    }
+    else
+    {
+        const T root = std::sqrt(discriminant);
+        const T denominator = T(2) * a;
+        tNear = (-b - root) / denominator;
+        if constexpr (Query == RayQuery::EntryExit)
+            tFar = (-b + root) / denominator;
+        return tNear > 0;
+    }
+}
+
+
+// Whether the segment from origin to origin + direction passes through the circle, for occlusion tests.
+// It does if the circle is in front of both of its ends (or contains the far end), that's two AnyHit
+// tests and no square root.
+template <class T>
+inline bool SegmentHitsCircle(const sf::Vector2<T>& origin, const sf::Vector2<T>& direction, T radius, const sf::Vector2<T>& circlePos)
+{
+    T unused = T(0);
+    if (!IntersectCircle<T, RayQuery::AnyHit>(origin, direction, radius, circlePos, unused, unused))
+        return false;
+
+    const sf::Vector2<T> end = origin + direction;
+    const sf::Vector2<T> offset = end - circlePos;
+    if (offset.x * offset.x + offset.y * offset.y < radius * radius)
+        return true;
+    return IntersectCircle<T, RayQuery::AnyHit>(end, -direction, radius, circlePos, unused, unused);
+}
+
+
+// Nearest hit of one ray against a range of occluders (anything with a position and radius)
+// AnyHit returns at the first occluder in front and only flags the light ray
+template <class T, RayQuery Query, class Occluders>
+inline RayPair TraceNearest(const sf::Vector2<T>& origin, const sf::Vector2<T>& direction, const Occluders& occluders)
+{
+    RayPair rays{ sf::Vector2f(origin) };
+
+    T nearest = T(0);
+    T exit = T(0);
+    bool hit = false;
+    for (const auto& occluder : occluders)
+    {
+        T tNear, tFar;
+        if (IntersectCircle<T, Query>(origin, direction, static_cast<T>(occluder.radius), sf::Vector2<T>(occluder.position), tNear, tFar))
+        {
+            if constexpr (Query == RayQuery::AnyHit)
+            {
+                rays.light.m_Type = Ray::Type::Light;
+                return rays;
+            }
+            else if (!hit || tNear < nearest)
+            {
+                nearest = tNear;
+                if constexpr (Query == RayQuery::EntryExit)
+                    exit = tFar;
+                hit = true;
+            }
+        }
+    }
+
+    if (!hit)
+        return rays;
+
+    rays.light.m_Intersection = sf::Vector2f(origin + direction * nearest);
+    rays.light.m_Type = Ray::Type::Light;
+    if constexpr (Query == RayQuery::EntryExit)
+    {
+        const sf::Vector2<T> exitPoint = origin + direction * exit;
+        rays.shadow.m_Origin = sf::Vector2f(exitPoint);
+        rays.shadow.m_Intersection = sf::Vector2f(exitPoint + direction * (exit * static_cast<T>(sg_TScalar)));
+        rays.shadow.m_Type = Ray::Type::Shadow;
+    }
+    return rays;
+}
+
+
+// Sweep of the static scene, the rays fan out from the light on both sides of the horizontal
+// until they stop hitting the circle or point past the view. Every hit is passed to sink(const RayPair&), returns the hit count.
+template <RayQuery Query, class Sink>
+inline size_t SweepCircle(const sf::Vector2f& origin, float radius, const sf::Vector2f& circlePos, size_t numRays, const SweepStep& step, float viewHeight, Sink&& sink)
+{
+    constexpr float YDir = 0.f;
+    constexpr float XDir = 1000.f;
+
+    sf::Vector2f direction(XDir, YDir);
+    float YOffset = step.y;
+    float XOffset = step.x;
+
+    size_t hits = 0;
+    bool foundInArea = false;
+    for (size_t j = 0; j < 2; ++j)
+    {
+        bool found = false;
+        size_t foundIndex = 0;
+        for (size_t i = 0; i < numRays; ++i)
+        {
+            if ((direction.x < 0.f && direction.y > viewHeight) || (direction.x < 0.f && direction.y < 0.f))
+                break;
+
+            const RayPair lines = CalculateRays<float, Query>(origin, direction, radius, circlePos);
+            if (lines.light.m_Type == Ray::Type::Light) // is only true if ray hits the circle
+            {
+                if (!found)
+                    foundIndex = i;
+                found = true;
+
+                sink(lines);
+                ++hits;
+            }
+            else if (found)
+            {
+                if (foundIndex != 0)
+                    foundInArea = true;
+                break;
+            }
+
+            direction.y += YOffset;
+            direction.x -= XOffset;
+        }
+        if (foundInArea)
+            break;
+
+        direction.x = XDir;
+        direction.y = YDir;
+        YOffset = step.y * -1;
+        XOffset = step.x;
+    }
+    return hits;
+}
@@ -0,0 +1,201 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define RAYS_CACHE_SSE2
+#endif
+
+#include "SFML/Graphics.hpp"
+
+#include "Ray.h"
+
+// 8 byte line segment, endpoints in 16 bit fixed point relative to the top left corner of the view
+struct CompactRay
+{
+public:
+    int16_t x0;
+    int16_t y0;
+    int16_t x1;
+    int16_t y1;
+};
+static_assert(sizeof(CompactRay) == 8, "CompactRay has to stay tightly packed, the expansion loads two at once");
+
+
+struct CompactRays
+{
+public:
+    std::vector<CompactRay> light;
+    std::vector<CompactRay> shadow;
+    sf::FloatRect view;
+
+    inline size_t MemoryUsage() const { return (light.capacity() + shadow.capacity()) * sizeof(CompactRay); }
+};
+
+
+// Redraw cache for rays, replaces storing full Ray objects (20 bytes) with 8 byte quantised segments.
+// The type isn't stored per ray at all, light and shadow rays live in separate arrays.
+// Segments are clipped to the view before quantising, that's what keeps the far away
+// shadow endpoints (sg_TScalar) inside the 16 bit range.
+struct CompactRayCache
+{
+private:
+    static inline constexpr int s_FractionBits = 2; // quarter pixel precision, +-8191 pixels range
+    static inline constexpr float s_ToFixed = static_cast<float>(1 << s_FractionBits);
+    static inline constexpr float s_ToFloat = 1.f / s_ToFixed;
+    static inline constexpr float s_MaxExtent = 32767.f / s_ToFixed;
+    static inline constexpr size_t s_ChunkRays = 4096; // rays expanded per draw call, keeps the vertex buffer at a fixed 160KB
+
+    CompactRays m_Rays;
+    std::vector<sf::Vertex> m_Vertices; // scratch buffer for one chunk of the expansion, reused every frame
+private:
+    static inline int16_t Quantise(float value)
+    {
+        return static_cast<int16_t>(std::lround(value * s_ToFixed));
+    }
+
+    // Liang-Barsky, returns false if the segment lies completely outside of the view
+    inline bool Clip(sf::Vector2f& start, sf::Vector2f& end) const
+    {
+        const sf::Vector2f delta = end - start;
+        const std::array<float, 4> p = { -delta.x, delta.x, -delta.y, delta.y };
+        const sf::FloatRect& view = m_Rays.view;
+        const std::array<float, 4> q = { start.x, view.width - start.x, start.y, view.height - start.y };
+
+        float tMin = 0.f;
+        float tMax = 1.f;
+        for (size_t i = 0; i < 4; ++i)
+        {
+            if (p[i] == 0.f)
+            {
+                if (q[i] < 0.f)
+                    return false;
+                continue;
+            }
+
+            const float t = q[i] / p[i];
+            if (p[i] < 0.f)
+                tMin = std::max(tMin, t);
+            else
+                tMax = std::min(tMax, t);
+            if (tMin > tMax)
+                return false;
+        }
+
+        end = start + delta * tMax;
+        start = start + delta * tMin;
+        return true;
+    }
+
+    inline void ExpandInto(const CompactRay* rays, size_t count, const sf::Color& color, sf::Vertex* out) const
+    {
+        const sf::FloatRect& view = m_Rays.view;
+        size_t i = 0;
+#ifdef RAYS_CACHE_SSE2
+        const __m128 scale = _mm_set1_ps(s_ToFloat);
+        const __m128 offset = _mm_setr_ps(view.left, view.top, view.left, view.top);
+        for (; i + 2 <= count; i += 2)
+        {
+            // two rays per load, sign extend the 16 bit values and convert them to float
+            const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&rays[i]));
+            const __m128 first = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16)), scale), offset);
+            const __m128 second = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(packed, packed), 16)), scale), offset);
+
+            sf::Vertex* vertices = out + i * 2;
+            _mm_storel_pi(reinterpret_cast<__m64*>(&vertices[0].position), first);
+            _mm_storeh_pi(reinterpret_cast<__m64*>(&vertices[1].position), first);
+            _mm_storel_pi(reinterpret_cast<__m64*>(&vertices[2].position), second);
+            _mm_storeh_pi(reinterpret_cast<__m64*>(&vertices[3].position), second);
+            vertices[0].color = vertices[1].color = vertices[2].color = vertices[3].color = color;
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            const CompactRay& ray = rays[i];
+            out[i * 2] = sf::Vertex({ view.left + static_cast<float>(ray.x0) * s_ToFloat, view.top + static_cast<float>(ray.y0) * s_ToFloat }, color);
+            out[i * 2 + 1] = sf::Vertex({ view.left + static_cast<float>(ray.x1) * s_ToFloat, view.top + static_cast<float>(ray.y1) * s_ToFloat }, color);
+        }
+    }
+public:
+    inline void Clear(const sf::FloatRect& view)
+    {
+        m_Rays.view = view;
+        m_Rays.view.width = std::min(view.width, s_MaxExtent);
+        m_Rays.view.height = std::min(view.height, s_MaxExtent);
+        m_Rays.light.clear();
+        m_Rays.shadow.clear();
+    }
+
+    inline void Add(const Ray& ray)
+    {
+        if (ray.m_Type == Ray::Type::None)
+            return;
+
+        sf::Vector2f start(ray.m_Origin.x - m_Rays.view.left, ray.m_Origin.y - m_Rays.view.top);
+        sf::Vector2f end(ray.m_Intersection.x - m_Rays.view.left, ray.m_Intersection.y - m_Rays.view.top);
+        if (!Clip(start, end))
+            return;
+
+        const CompactRay compact = { Quantise(start.x), Quantise(start.y), Quantise(end.x), Quantise(end.y) };
+        if (ray.m_Type == Ray::Type::Light)
+            m_Rays.light.push_back(compact);
+        else
+            m_Rays.shadow.push_back(compact);
+    }
+
+    inline void Assign(const std::vector<Ray>& rays, const sf::FloatRect& view)
+    {
+        Clear(view);
+        for (const Ray& ray : rays)
+            Add(ray);
+    }
+
+    // Expands the cached rays into line vertices one chunk at a time, callback(const sf::Vertex*, size_t)
+    // gets every chunk while it's still in the cache. Returns the total vertex count.
+    template <class Callback>
+    inline size_t ExpandChunks(bool light, bool shadow, Callback&& callback)
+    {
+        size_t vertexCount = 0;
+        const auto expand = [&](const std::vector<CompactRay>& rays, const sf::Color& color)
+        {
+            for (size_t first = 0; first < rays.size(); first += s_ChunkRays)
+            {
+                const size_t count = std::min(s_ChunkRays, rays.size() - first);
+                if (m_Vertices.empty())
+                    m_Vertices.resize(s_ChunkRays * 2);
+                ExpandInto(rays.data() + first, count, color, m_Vertices.data());
+                callback(static_cast<const sf::Vertex*>(m_Vertices.data()), count * 2);
+                vertexCount += count * 2;
+            }
+        };
+
+        if (light)
+            expand(m_Rays.light, Ray::LightColor());
+        if (shadow)
+            expand(m_Rays.shadow, Ray::ShadowColor());
+        return vertexCount;
+    }
+
+    // Expands without drawing, returns the vertex count
+    inline size_t Expand(bool light, bool shadow)
+    {
+        return ExpandChunks(light, shadow, [](const sf::Vertex*, size_t) {});
+    }
+
+    inline void Draw(sf::RenderTarget& target, bool light, bool shadow)
+    {
+        ExpandChunks(light, shadow, [&target](const sf::Vertex* vertices, size_t vertexCount) { target.draw(vertices, vertexCount, sf::Lines); });
+    }
+
+    inline const CompactRays& Rays() const { return m_Rays; }
+    inline void Restore(const CompactRays& rays) { m_Rays = rays; } // reuses the capacity that's already there
+
+    inline size_t LightCount() const { return m_Rays.light.size(); }
+    inline size_t ShadowCount() const { return m_Rays.shadow.size(); }
+    inline size_t MemoryUsage() const { return m_Rays.MemoryUsage() + m_Vertices.capacity() * sizeof(sf::Vertex); }
+};
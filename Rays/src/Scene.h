@@ -0,0 +1,199 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "SFML/System/Vector2.hpp"
+
+// Scene description for the headless mode, one setting per line, '#' starts a comment
+//   mode static|simulation|sdf|fixed size 1000 750         seed 1
+//   light 20 20                      circle 500 375 100    rays 4450
+//   occluders 2000                   lights 4              raysperlight 2048
+//   sdfrays 4096                     timestep 0.016666     lightmap on|off
+//   showlight on|off                 shadow on|off
+// Input replay, applied at the start of the given frame:
+//   at <frame> light <x> <y>          at <frame> circle <x> <y>   at <frame> radius <r>
+//   at <frame> toggle light|shadow|lightmap   at <frame> mode <mode>   at <frame> resize <w> <h>
+struct Scene
+{
+public:
+    enum class Mode { Static, Simulation, Sdf, Fixed }; // Fixed traces the compiled DemoConstexprScene
+
+    struct Event
+    {
+    public:
+        enum class Type { MoveLight, MoveCircle, SetRadius, ToggleLight, ToggleShadow, ToggleLightMap, SetMode, Resize };
+
+        size_t frame = 0;
+        Type type = Type::MoveLight;
+        sf::Vector2f value;
+        Mode mode = Mode::Static;
+    };
+
+    Mode mode = Mode::Static;
+    sf::Vector2u size = { 1000, 750 };
+    sf::Vector2f lightPosition = { 20.f, 20.f };
+    sf::Vector2f circlePosition = { 500.f, 375.f }; // center
+    float radius = 100.f;
+    bool light = true;
+    bool shadow = true;
+    bool lightMap = false;
+    size_t rays = 4450;
+    size_t occluders = 2000;
+    size_t lights = 4;
+    size_t raysPerLight = 2048;
+    size_t sdfRays = 4096;
+    unsigned int seed = 1;
+    float timeStep = 1.f / 60.f; // simulated frame time, keeps runs reproducible
+    std::vector<Event> events; // sorted by frame
+private:
+    static inline bool ParseMode(const std::string& str, Mode& mode)
+    {
+        if (str == "static")
+            mode = Mode::Static;
+        else if (str == "simulation")
+            mode = Mode::Simulation;
+        else if (str == "sdf")
+            mode = Mode::Sdf;
+        else if (str == "fixed")
+            mode = Mode::Fixed;
+        else
+            return false;
+        return true;
+    }
+
+    static inline bool ParseSwitch(const std::string& str, bool& value)
+    {
+        if (str == "on")
+            value = true;
+        else if (str == "off")
+            value = false;
+        else
+            return false;
+        return true;
+    }
+
+    static inline bool ParseEvent(std::istringstream& line, Event& event)
+    {
+        std::string type;
+        if (!(line >> event.frame >> type))
+            return false;
+
+        if (type == "light" || type == "circle")
+        {
+            event.type = type == "light" ? Event::Type::MoveLight : Event::Type::MoveCircle;
+            return static_cast<bool>(line >> event.value.x >> event.value.y);
+        }
+        if (type == "radius")
+        {
+            event.type = Event::Type::SetRadius;
+            return static_cast<bool>(line >> event.value.x);
+        }
+        if (type == "resize")
+        {
+            event.type = Event::Type::Resize;
+            return static_cast<bool>(line >> event.value.x >> event.value.y) && event.value.x >= 1.f && event.value.y >= 1.f;
+        }
+        if (type == "mode")
+        {
+            event.type = Event::Type::SetMode;
+            std::string mode;
+            return line >> mode && ParseMode(mode, event.mode);
+        }
+        if (type == "toggle")
+        {
+            std::string target;
+            if (!(line >> target))
+                return false;
+            if (target == "light")
+                event.type = Event::Type::ToggleLight;
+            else if (target == "shadow")
+                event.type = Event::Type::ToggleShadow;
+            else if (target == "lightmap")
+                event.type = Event::Type::ToggleLightMap;
+            else
+                return false;
+            return true;
+        }
+        return false;
+    }
+
+    inline bool ParseLine(const std::string& key, std::istringstream& line)
+    {
+        std::string str;
+        if (key == "mode")
+            return line >> str && ParseMode(str, mode);
+        if (key == "size")
+            return line >> size.x >> size.y && size.x != 0 && size.y != 0;
+        if (key == "light")
+            return static_cast<bool>(line >> lightPosition.x >> lightPosition.y);
+        if (key == "circle")
+            return line >> circlePosition.x >> circlePosition.y >> radius && radius >= 1.f;
+        if (key == "showlight")
+            return line >> str && ParseSwitch(str, light);
+        if (key == "shadow")
+            return line >> str && ParseSwitch(str, shadow);
+        if (key == "lightmap")
+            return line >> str && ParseSwitch(str, lightMap);
+        if (key == "rays")
+            return static_cast<bool>(line >> rays);
+        if (key == "occluders")
+            return static_cast<bool>(line >> occluders);
+        if (key == "lights")
+            return static_cast<bool>(line >> lights);
+        if (key == "raysperlight")
+            return line >> raysPerLight && raysPerLight != 0;
+        if (key == "sdfrays")
+            return static_cast<bool>(line >> sdfRays);
+        if (key == "seed")
+            return static_cast<bool>(line >> seed);
+        if (key == "timestep")
+            return line >> timeStep && timeStep > 0.f;
+        if (key == "at")
+        {
+            Event event;
+            if (!ParseEvent(line, event))
+                return false;
+            events.push_back(event);
+            return true;
+        }
+        return false;
+    }
+public:
+    // Errors are written to err together with the line they occurred in
+    inline bool LoadFromFile(const std::string& path, std::ostream& err)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            err << "Failed to open scene file: " << path << '\n';
+            return false;
+        }
+
+        std::string str;
+        size_t lineNumber = 0;
+        while (std::getline(file, str))
+        {
+            ++lineNumber;
+            str = str.substr(0, str.find('#'));
+            std::istringstream line(str);
+            std::string key;
+            if (!(line >> key))
+                continue;
+
+            std::string rest;
+            if (!ParseLine(key, line) || line >> rest)
+            {
+                err << path << ':' << lineNumber << ": invalid line '" << str << "'\n";
+                return false;
+            }
+        }
+
+        std::stable_sort(events.begin(), events.end(), [](const Event& a, const Event& b) { return a.frame < b.frame; });
+        return true;
+    }
+};
@@ -0,0 +1,426 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+#include "SFML/Graphics.hpp"
+
+#include "FrameArena.h"
+#include "Ray.h"
+#include "ThreadPool.h"
+
+// Second ray engine that sphere traces a 2D signed distance field instead of solving
+// the circle quadratic, so arbitrary occluder shapes work without a dedicated intersector.
+// Negative distances are inside of an occluder.
+
+struct SdfPrimitive
+{
+public:
+    // Circle:  a = center, radius
+    // Box:     a = center, b = half extents, radius = corner rounding
+    // Capsule: a and b = endpoints, radius
+    enum class Kind { Circle, Box, Capsule };
+
+    Kind kind = Kind::Circle;
+    sf::Vector2f a;
+    sf::Vector2f b;
+    float radius = 0.f;
+};
+
+
+// Distance field baked from an image, one cell per pixel scaled by cellSize
+struct SdfGrid
+{
+private:
+    static inline constexpr float s_Infinity = 1e20f;
+
+    std::vector<float> m_Distances;
+    unsigned int m_Width = 0;
+    unsigned int m_Height = 0;
+    sf::Vector2f m_Origin;
+    float m_CellSize = 1.f;
+private:
+    // Felzenszwalb & Huttenlocher, exact 1D squared euclidean distance transform
+    static inline void Transform1D(const float* f, size_t n, float* d, std::vector<size_t>& v, std::vector<float>& z)
+    {
+        size_t k = 0;
+        v[0] = 0;
+        z[0] = -s_Infinity;
+        z[1] = s_Infinity;
+        for (size_t q = 1; q < n; ++q)
+        {
+            const float fq = f[q] + static_cast<float>(q * q);
+            float s = (fq - (f[v[k]] + static_cast<float>(v[k] * v[k]))) / (2.f * static_cast<float>(q) - 2.f * static_cast<float>(v[k]));
+            while (s <= z[k])
+            {
+                --k;
+                s = (fq - (f[v[k]] + static_cast<float>(v[k] * v[k]))) / (2.f * static_cast<float>(q) - 2.f * static_cast<float>(v[k]));
+            }
+            ++k;
+            v[k] = q;
+            z[k] = s;
+            z[k + 1] = s_Infinity;
+        }
+
+        k = 0;
+        for (size_t q = 0; q < n; ++q)
+        {
+            while (z[k + 1] < static_cast<float>(q))
+                ++k;
+            const float offset = static_cast<float>(q) - static_cast<float>(v[k]);
+            d[q] = offset * offset + f[v[k]];
+        }
+    }
+
+    // squared distance of every cell to the nearest cell where feature is true
+    static inline std::vector<float> Transform2D(const std::vector<bool>& feature, unsigned int width, unsigned int height)
+    {
+        std::vector<float> grid(feature.size());
+        for (size_t i = 0; i < feature.size(); ++i)
+            grid[i] = feature[i] ? 0.f : s_Infinity;
+
+        const size_t longest = std::max(width, height);
+        std::vector<float> f(longest), d(longest), z(longest + 1);
+        std::vector<size_t> v(longest);
+        for (size_t x = 0; x < width; ++x)
+        {
+            for (size_t y = 0; y < height; ++y)
+                f[y] = grid[y * width + x];
+            Transform1D(f.data(), height, d.data(), v, z);
+            for (size_t y = 0; y < height; ++y)
+                grid[y * width + x] = d[y];
+        }
+        for (size_t y = 0; y < height; ++y)
+        {
+            Transform1D(&grid[y * width], width, d.data(), v, z);
+            std::copy(d.begin(), d.begin() + static_cast<std::ptrdiff_t>(width), grid.begin() + static_cast<std::ptrdiff_t>(y * width));
+        }
+        return grid;
+    }
+
+    inline float At(unsigned int x, unsigned int y) const { return m_Distances[static_cast<size_t>(y) * m_Width + x]; }
+public:
+    // Dark, opaque pixels (average below threshold, alpha >= 128) are solid
+    inline bool Bake(const sf::Image& image, const sf::Vector2f& origin, float cellSize, uint8_t threshold = 128)
+    {
+        m_Width = image.getSize().x;
+        m_Height = image.getSize().y;
+        if (m_Width == 0 || m_Height == 0)
+            return false;
+
+        const sf::Uint8* pixels = image.getPixelsPtr();
+        std::vector<bool> solid(static_cast<size_t>(m_Width) * m_Height);
+        std::vector<bool> empty(solid.size());
+        for (size_t i = 0; i < solid.size(); ++i)
+        {
+            const sf::Uint8* pixel = pixels + i * 4;
+            const unsigned int average = (static_cast<unsigned int>(pixel[0]) + pixel[1] + pixel[2]) / 3;
+            solid[i] = average < threshold && pixel[3] >= 128;
+            empty[i] = !solid[i];
+        }
+
+        const std::vector<float> outside = Transform2D(solid, m_Width, m_Height);
+        const std::vector<float> inside = Transform2D(empty, m_Width, m_Height);
+        m_Distances.resize(solid.size());
+        for (size_t i = 0; i < solid.size(); ++i)
+            m_Distances[i] = (std::sqrt(outside[i]) - std::sqrt(inside[i])) * cellSize;
+
+        m_Origin = origin;
+        m_CellSize = cellSize;
+        return true;
+    }
+
+    inline bool Empty() const { return m_Distances.empty(); }
+
+    // bilinear, points outside of the grid add their distance to the grid bounds
+    inline float Sample(float x, float y) const
+    {
+        const float gx = (x - m_Origin.x) / m_CellSize;
+        const float gy = (y - m_Origin.y) / m_CellSize;
+        const float maxX = static_cast<float>(m_Width - 1);
+        const float maxY = static_cast<float>(m_Height - 1);
+        const float cx = std::clamp(gx, 0.f, maxX);
+        const float cy = std::clamp(gy, 0.f, maxY);
+        const float outside = std::hypot(gx - cx, gy - cy) * m_CellSize;
+
+        const unsigned int x0 = static_cast<unsigned int>(cx);
+        const unsigned int y0 = static_cast<unsigned int>(cy);
+        const unsigned int x1 = std::min(x0 + 1, m_Width - 1);
+        const unsigned int y1 = std::min(y0 + 1, m_Height - 1);
+        const float fx = cx - static_cast<float>(x0);
+        const float fy = cy - static_cast<float>(y0);
+        const float top = At(x0, y0) + (At(x1, y0) - At(x0, y0)) * fx;
+        const float bottom = At(x0, y1) + (At(x1, y1) - At(x0, y1)) * fx;
+        return top + (bottom - top) * fy + outside;
+    }
+};
+
+
+struct SdfScene
+{
+private:
+    static inline constexpr float s_Far = 1e30f;
+public:
+    std::vector<SdfPrimitive> primitives;
+    SdfGrid grid;
+    float smoothing = 0.f; // radius of the smooth union, 0 is a hard union
+private:
+    inline float Combine(float first, float second) const
+    {
+        if (smoothing <= 0.f)
+            return std::min(first, second);
+
+        // polynomial smooth minimum
+        const float h = std::max(smoothing - std::abs(first - second), 0.f) / smoothing;
+        return std::min(first, second) - h * h * smoothing * 0.25f;
+    }
+public:
+    // Evaluates the field for a packet of points, primitives are the outer loop so that
+    // the inner loop runs the same code for every lane
+    inline void Evaluate(const float* x, const float* y, float* out, size_t count) const
+    {
+        for (size_t i = 0; i < count; ++i)
+            out[i] = s_Far;
+
+        for (const SdfPrimitive& primitive : primitives)
+        {
+            switch (primitive.kind)
+            {
+            case SdfPrimitive::Kind::Circle:
+                for (size_t i = 0; i < count; ++i)
+                {
+                    const float dx = x[i] - primitive.a.x;
+                    const float dy = y[i] - primitive.a.y;
+                    out[i] = Combine(out[i], std::sqrt(dx * dx + dy * dy) - primitive.radius);
+                }
+                break;
+            case SdfPrimitive::Kind::Box:
+                for (size_t i = 0; i < count; ++i)
+                {
+                    const float qx = std::abs(x[i] - primitive.a.x) - primitive.b.x + primitive.radius;
+                    const float qy = std::abs(y[i] - primitive.a.y) - primitive.b.y + primitive.radius;
+                    const float ox = std::max(qx, 0.f);
+                    const float oy = std::max(qy, 0.f);
+                    const float distance = std::sqrt(ox * ox + oy * oy) + std::min(std::max(qx, qy), 0.f) - primitive.radius;
+                    out[i] = Combine(out[i], distance);
+                }
+                break;
+            case SdfPrimitive::Kind::Capsule:
+            {
+                const sf::Vector2f ba = primitive.b - primitive.a;
+                const float inverseLength = 1.f / std::max(ba.x * ba.x + ba.y * ba.y, 1e-6f);
+                for (size_t i = 0; i < count; ++i)
+                {
+                    const float pax = x[i] - primitive.a.x;
+                    const float pay = y[i] - primitive.a.y;
+                    const float h = std::clamp((pax * ba.x + pay * ba.y) * inverseLength, 0.f, 1.f);
+                    const float dx = pax - ba.x * h;
+                    const float dy = pay - ba.y * h;
+                    out[i] = Combine(out[i], std::sqrt(dx * dx + dy * dy) - primitive.radius);
+                }
+                break;
+            }
+            default:
+                break;
+            }
+        }
+
+        if (!grid.Empty())
+            for (size_t i = 0; i < count; ++i)
+                out[i] = std::min(out[i], grid.Sample(x[i], y[i]));
+    }
+
+    inline float Evaluate(float x, float y) const
+    {
+        float distance;
+        Evaluate(&x, &y, &distance, 1);
+        return distance;
+    }
+
+    // RGBA pixels, color inside of an occluder and transparent everywhere else
+    inline void Rasterise(std::vector<sf::Uint8>& pixels, const sf::Vector2u& size, const sf::Color& color, ThreadPool& pool) const
+    {
+        pixels.resize(static_cast<size_t>(size.x) * size.y * 4);
+        FrameArena& arena = pool.Arena();
+        arena.Reset();
+        pool.ParallelFor(size.y, 8, [&](size_t begin, size_t end)
+        {
+            const FrameArena::Scope scope(arena);
+            float* xs = arena.Allocate<float>(size.x);
+            float* ys = arena.Allocate<float>(size.x);
+            float* distances = arena.Allocate<float>(size.x);
+            for (size_t y = begin; y < end; ++y)
+            {
+                for (size_t x = 0; x < size.x; ++x)
+                {
+                    xs[x] = static_cast<float>(x) + 0.5f;
+                    ys[x] = static_cast<float>(y) + 0.5f;
+                }
+                Evaluate(xs, ys, distances, size.x);
+
+                sf::Uint8* row = &pixels[y * size.x * 4];
+                for (size_t x = 0; x < size.x; ++x)
+                {
+                    const sf::Color pixel = distances[x] <= 0.f ? color : sf::Color::Transparent;
+                    row[x * 4] = pixel.r;
+                    row[x * 4 + 1] = pixel.g;
+                    row[x * 4 + 2] = pixel.b;
+                    row[x * 4 + 3] = pixel.a;
+                }
+            }
+        });
+    }
+};
+
+
+struct SdfTracer
+{
+private:
+    static inline constexpr size_t s_PacketSize = 8;
+    static inline constexpr size_t s_MaxSteps = 128;
+    static inline constexpr float s_Epsilon = 0.05f;
+    enum class State : uint8_t { Marching, Hit, Miss };
+
+    std::vector<sf::Vector2f> m_Directions;
+    ArenaArray<Ray> m_Slots; // two per direction, written in parallel, lives in the frame arena
+public:
+    float maxDistance = 4000.f;
+private:
+    // Continues behind the hit by stepping the negated distance until the ray leaves the occluder
+    inline float FindExit(const SdfScene& scene, const sf::Vector2f& origin, const sf::Vector2f& direction, float t) const
+    {
+        t += s_Epsilon * 2.f;
+        for (size_t step = 0; step < s_MaxSteps && t < maxDistance; ++step)
+        {
+            const float distance = scene.Evaluate(origin.x + direction.x * t, origin.y + direction.y * t);
+            if (distance > 0.f)
+                return t;
+            t += std::max(-distance, s_Epsilon);
+        }
+        return t;
+    }
+
+    inline void TracePacket(const SdfScene& scene, const sf::Vector2f& origin, const sf::Vector2f* directions, size_t lanes, bool shadows, Ray* out) const
+    {
+        std::array<float, s_PacketSize> x, y, t, distance;
+        std::array<State, s_PacketSize> state;
+        t.fill(0.f);
+        state.fill(State::Marching);
+
+        size_t active = lanes;
+        for (size_t step = 0; step < s_MaxSteps && active != 0; ++step) // early out once every lane is done
+        {
+            for (size_t i = 0; i < lanes; ++i)
+            {
+                x[i] = origin.x + directions[i].x * t[i];
+                y[i] = origin.y + directions[i].y * t[i];
+            }
+            scene.Evaluate(x.data(), y.data(), distance.data(), lanes);
+
+            for (size_t i = 0; i < lanes; ++i)
+            {
+                if (state[i] != State::Marching)
+                    continue;
+
+                if (distance[i] < s_Epsilon)
+                {
+                    // starting inside of an occluder doesn't produce a ray
+                    state[i] = step == 0 && distance[i] < 0.f ? State::Miss : State::Hit;
+                    --active;
+                }
+                else
+                {
+                    t[i] += distance[i];
+                    if (t[i] > maxDistance)
+                    {
+                        state[i] = State::Miss;
+                        --active;
+                    }
+                }
+            }
+        }
+
+        for (size_t i = 0; i < lanes; ++i)
+        {
+            Ray& light = out[i * 2];
+            Ray& shadow = out[i * 2 + 1];
+            light = Ray(origin);
+            shadow = Ray();
+            if (state[i] != State::Hit)
+                continue;
+
+            light.m_Intersection = origin + directions[i] * t[i];
+            light.m_Type = Ray::Type::Light;
+            if (!shadows)
+                continue;
+
+            const float exit = FindExit(scene, origin, directions[i], t[i]);
+            shadow.m_Origin = origin + directions[i] * exit;
+            shadow.m_Intersection = shadow.m_Origin + directions[i] * (exit * sg_TScalar);
+            shadow.m_Type = Ray::Type::Shadow;
+        }
+    }
+public:
+    // Same output as Simulation::Trace, rays evenly around the origin, returns the number of hits
+    inline size_t Trace(const SdfScene& scene, const sf::Vector2f& origin, size_t rayCount, bool shadows, ThreadPool& pool, std::vector<Ray>& rays)
+    {
+        if (m_Directions.size() != rayCount)
+        {
+            m_Directions.resize(rayCount);
+            for (size_t i = 0; i < rayCount; ++i)
+            {
+                const double angle = 6.283185307179586 * static_cast<double>(i) / static_cast<double>(rayCount);
+                m_Directions[i] = sf::Vector2f(static_cast<float>(std::cos(angle)), static_cast<float>(std::sin(angle)));
+            }
+        }
+
+        FrameArena& arena = pool.Arena();
+        arena.Reset();
+        m_Slots = ArenaArray<Ray>(arena.Allocate<Ray>(rayCount * 2), rayCount * 2, rayCount * 2);
+        const size_t packets = (rayCount + s_PacketSize - 1) / s_PacketSize;
+        pool.ParallelFor(packets, 4, [&](size_t begin, size_t end)
+        {
+            for (size_t packet = begin; packet < end; ++packet)
+            {
+                const size_t first = packet * s_PacketSize;
+                const size_t lanes = std::min(s_PacketSize, rayCount - first);
+                TracePacket(scene, origin, &m_Directions[first], lanes, shadows, &m_Slots[first * 2]);
+            }
+        });
+
+        rays.clear();
+        size_t hits = 0;
+        for (const Ray& ray : m_Slots)
+        {
+            if (ray.m_Type == Ray::Type::None)
+                continue;
+            if (ray.m_Type == Ray::Type::Light)
+                ++hits;
+            rays.push_back(ray);
+        }
+        return hits;
+    }
+};
+
+
+// Scene shown by the app, the user circle is always the last primitive and gets moved around with it
+inline SdfScene DemoSdfScene()
+{
+    SdfScene scene;
+    scene.smoothing = 25.f;
+    scene.primitives.push_back({ SdfPrimitive::Kind::Box, { 780.f, 180.f }, { 60.f, 40.f }, 8.f });
+    scene.primitives.push_back({ SdfPrimitive::Kind::Box, { 230.f, 220.f }, { 30.f, 90.f }, 0.f });
+    scene.primitives.push_back({ SdfPrimitive::Kind::Capsule, { 150.f, 600.f }, { 350.f, 530.f }, 18.f });
+    scene.primitives.push_back({ SdfPrimitive::Kind::Circle, {}, {}, 0.f });
+    if (std::ifstream("res/level.png").good()) // optional level geometry, dark pixels are solid
+    {
+        sf::Image level;
+        if (level.loadFromFile("res/level.png"))
+            scene.grid.Bake(level, { 0.f, 0.f }, 1.f);
+    }
+    return scene;
+}
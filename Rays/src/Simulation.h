@@ -0,0 +1,367 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <numeric>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "SFML/Graphics.hpp"
+
+#include "Benchmark.h"
+#include "FrameArena.h"
+#include "Ray.h"
+#include "ThreadPool.h"
+
+struct Body
+{
+public:
+    sf::Vector2f position;
+    sf::Vector2f velocity;
+    float radius = 0.f;
+
+    inline float MinX() const { return position.x - radius; }
+    inline float MaxX() const { return position.x + radius; }
+};
+
+
+// Keeps the bodies sorted by their left edge across steps, since they barely move
+// between two steps the insertion sort is close to linear
+struct SweepAndPrune
+{
+private:
+    std::vector<size_t> m_Order;
+    std::vector<std::pair<size_t, size_t>> m_Pairs;
+public:
+    inline const std::vector<std::pair<size_t, size_t>>& FindPairs(const std::vector<Body>& bodies)
+    {
+        if (m_Order.size() != bodies.size())
+        {
+            m_Order.resize(bodies.size());
+            std::iota(m_Order.begin(), m_Order.end(), size_t(0));
+        }
+
+        for (size_t i = 1; i < m_Order.size(); ++i)
+        {
+            const size_t key = m_Order[i];
+            const float minX = bodies[key].MinX();
+            size_t j = i;
+            for (; j > 0 && bodies[m_Order[j - 1]].MinX() > minX; --j)
+                m_Order[j] = m_Order[j - 1];
+            m_Order[j] = key;
+        }
+
+        m_Pairs.clear();
+        for (size_t i = 0; i < m_Order.size(); ++i)
+        {
+            const Body& first = bodies[m_Order[i]];
+            const float maxX = first.MaxX();
+            for (size_t j = i + 1; j < m_Order.size() && bodies[m_Order[j]].MinX() <= maxX; ++j)
+            {
+                const Body& second = bodies[m_Order[j]];
+                if (std::abs(first.position.y - second.position.y) <= first.radius + second.radius)
+                    m_Pairs.emplace_back(m_Order[i], m_Order[j]);
+            }
+        }
+        return m_Pairs;
+    }
+};
+
+
+struct Simulation
+{
+private:
+    static inline constexpr float s_TimeStep = 1.f / 120.f;
+    static inline constexpr size_t s_MaxStepsPerFrame = 8; // avoids the spiral of death if a frame takes too long
+    static inline constexpr size_t s_BodyGrain = 256;
+    static inline constexpr size_t s_PacketGrain = 4;
+    static inline constexpr size_t s_PacketSize = 16;
+    static inline constexpr size_t s_SubPacketSize = 4;
+    static inline constexpr size_t s_DivergenceLimit = 24; // candidates above which a packet is split into narrower ones
+    static inline constexpr size_t s_CircleSegments = 12;
+
+    ThreadPool& m_Pool;
+    SweepAndPrune m_Broadphase;
+    sf::Vector2f m_Bounds;
+    float m_Accumulator = 0.f;
+    std::vector<sf::Vector2<double>> m_Directions;
+    ArenaArray<Ray> m_Slots; // two per direction and light, written in parallel, lives in the frame arena
+public:
+    std::vector<Body> occluders;
+    std::vector<Body> lights;
+private:
+    inline void Integrate(std::vector<Body>& bodies)
+    {
+        m_Pool.ParallelFor(bodies.size(), s_BodyGrain, [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                Body& body = bodies[i];
+                body.position += body.velocity * s_TimeStep;
+
+                if ((body.MinX() < 0.f && body.velocity.x < 0.f) || (body.MaxX() > m_Bounds.x && body.velocity.x > 0.f))
+                    body.velocity.x = -body.velocity.x;
+                if ((body.position.y - body.radius < 0.f && body.velocity.y < 0.f) || (body.position.y + body.radius > m_Bounds.y && body.velocity.y > 0.f))
+                    body.velocity.y = -body.velocity.y;
+            }
+        });
+    }
+
+    // elastic collision of two discs, mass is proportional to the area
+    static inline void Resolve(Body& first, Body& second)
+    {
+        const sf::Vector2f delta = second.position - first.position;
+        const float distanceSquared = delta.x * delta.x + delta.y * delta.y;
+        const float minDistance = first.radius + second.radius;
+        if (distanceSquared >= minDistance * minDistance || distanceSquared == 0.f)
+            return;
+
+        const float distance = std::sqrt(distanceSquared);
+        const sf::Vector2f normal = delta / distance;
+        const float firstMass = first.radius * first.radius;
+        const float secondMass = second.radius * second.radius;
+        const float inverseTotal = 1.f / (firstMass + secondMass);
+
+        const float overlap = minDistance - distance;
+        first.position -= normal * (overlap * secondMass * inverseTotal);
+        second.position += normal * (overlap * firstMass * inverseTotal);
+
+        const sf::Vector2f relative = second.velocity - first.velocity;
+        const float approaching = relative.x * normal.x + relative.y * normal.y;
+        if (approaching >= 0.f)
+            return;
+
+        const float impulse = 2.f * approaching * inverseTotal;
+        first.velocity += normal * (impulse * secondMass);
+        second.velocity -= normal * (impulse * firstMass);
+    }
+
+    // Frustum culling: gathers the occluders that can touch the wedge spanned by the rays [first, first + count).
+    // Conservative, a circle is kept if it isn't completely outside of one of the two edges or behind the origin.
+    template <class Occluders>
+    inline void Cull(const sf::Vector2f& origin, size_t first, size_t count, const Occluders& from, ArenaArray<Body>& to) const
+    {
+        to.clear();
+        const sf::Vector2f firstDirection(m_Directions[first]);
+        const sf::Vector2f lastDirection(m_Directions[first + count - 1]);
+        const sf::Vector2f firstNormal(-firstDirection.y, firstDirection.x); // both normals point into the wedge
+        const sf::Vector2f lastNormal(lastDirection.y, -lastDirection.x);
+        const sf::Vector2f middle = firstDirection + lastDirection;
+        const float middleLength = std::sqrt(middle.x * middle.x + middle.y * middle.y);
+
+        for (const Body& body : from)
+        {
+            const sf::Vector2f offset = body.position - origin;
+            if (offset.x * firstNormal.x + offset.y * firstNormal.y >= -body.radius
+                && offset.x * lastNormal.x + offset.y * lastNormal.y >= -body.radius
+                && offset.x * middle.x + offset.y * middle.y >= -body.radius * middleLength)
+                to.push_back(body);
+        }
+    }
+
+    template <class T, RayQuery Query, class Occluders>
+    inline void TraceRays(size_t light, size_t first, size_t count, size_t raysPerLight, const Occluders& candidates)
+    {
+        const sf::Vector2<T> origin(lights[light].position);
+        for (size_t i = first; i < first + count; ++i)
+        {
+            const RayPair pair = TraceNearest<T, Query>(origin, sf::Vector2<T>(m_Directions[i]), candidates);
+            const size_t slot = (light * raysPerLight + i) * 2;
+            m_Slots[slot] = pair.light;
+            m_Slots[slot + 1] = pair.shadow;
+        }
+    }
+
+    // Neighbouring rays are tested together against the occluder bounds, whole packets skip
+    // everything outside of their wedge. If too many occluders survive (the packet diverges)
+    // it's split into narrower packets that are culled again.
+    template <class T, RayQuery Query>
+    inline void TracePacket(size_t light, size_t first, size_t count, size_t raysPerLight, ArenaArray<Body>& candidates, ArenaArray<Body>& subCandidates)
+    {
+        const sf::Vector2f origin = lights[light].position;
+        const float span = 6.2831853f * static_cast<float>(count) / static_cast<float>(raysPerLight);
+        if (span >= 1.5707963f) // culling relies on narrow wedges
+        {
+            TraceRays<T, Query>(light, first, count, raysPerLight, occluders);
+            return;
+        }
+
+        Cull(origin, first, count, occluders, candidates);
+        if (candidates.size() <= s_DivergenceLimit)
+        {
+            TraceRays<T, Query>(light, first, count, raysPerLight, candidates);
+            return;
+        }
+
+        for (size_t sub = first; sub < first + count; sub += s_SubPacketSize)
+        {
+            const size_t subCount = std::min(s_SubPacketSize, first + count - sub);
+            Cull(origin, sub, subCount, candidates, subCandidates);
+            TraceRays<T, Query>(light, sub, subCount, raysPerLight, subCandidates);
+        }
+    }
+
+    // Starts a new recompute, everything from the previous one in the frame arena is gone afterwards
+    inline void PrepareDirections(size_t raysPerLight)
+    {
+        if (m_Directions.size() != raysPerLight)
+        {
+            m_Directions.resize(raysPerLight);
+            for (size_t i = 0; i < raysPerLight; ++i)
+            {
+                const double angle = 6.283185307179586 * static_cast<double>(i) / static_cast<double>(raysPerLight);
+                m_Directions[i] = { std::cos(angle), std::sin(angle) };
+            }
+        }
+        FrameArena& arena = m_Pool.Arena();
+        arena.Reset();
+        const size_t slots = lights.size() * raysPerLight * 2;
+        m_Slots = ArenaArray<Ray>(arena.Allocate<Ray>(slots), slots, slots);
+    }
+
+    // Appends the valid rays of the slots [begin, end), returns the number of hits
+    template <RayQuery Query>
+    inline size_t Collect(size_t begin, size_t end, std::vector<Ray>& rays) const
+    {
+        size_t hits = 0;
+        for (size_t i = begin; i < end; ++i)
+        {
+            const Ray& ray = m_Slots[i];
+            if (ray.m_Type == Ray::Type::Light)
+                ++hits;
+            if constexpr (Query != RayQuery::AnyHit)
+                if (ray.m_Type != Ray::Type::None)
+                    rays.push_back(ray);
+        }
+        return hits;
+    }
+
+    static inline void AppendCircle(sf::VertexArray& vertices, const Body& body, const sf::Color& color)
+    {
+        constexpr float step = 6.28318530718f / static_cast<float>(s_CircleSegments);
+        sf::Vector2f previous(body.position.x + body.radius, body.position.y);
+        for (size_t i = 1; i <= s_CircleSegments; ++i)
+        {
+            const float angle = step * static_cast<float>(i);
+            const sf::Vector2f current(body.position.x + body.radius * std::cos(angle), body.position.y + body.radius * std::sin(angle));
+            vertices.append(sf::Vertex(body.position, color));
+            vertices.append(sf::Vertex(previous, color));
+            vertices.append(sf::Vertex(current, color));
+            previous = current;
+        }
+    }
+public:
+    inline explicit Simulation(ThreadPool& pool) : m_Pool(pool) {}
+
+    inline void SetBounds(const sf::Vector2f& bounds) { m_Bounds = bounds; }
+
+    inline void Spawn(size_t occluderCount, size_t lightCount, const sf::Vector2f& bounds, unsigned int seed = 1)
+    {
+        std::mt19937 engine(seed);
+        std::uniform_real_distribution<float> xDist(0.f, bounds.x);
+        std::uniform_real_distribution<float> yDist(0.f, bounds.y);
+        std::uniform_real_distribution<float> speedDist(-80.f, 80.f);
+        std::uniform_real_distribution<float> radiusDist(2.f, 7.f);
+
+        m_Bounds = bounds;
+        m_Accumulator = 0.f;
+        occluders.resize(occluderCount);
+        for (Body& body : occluders)
+            body = { { xDist(engine), yDist(engine) }, { speedDist(engine), speedDist(engine) }, radiusDist(engine) };
+
+        lights.resize(lightCount);
+        for (Body& light : lights)
+            light = { { xDist(engine), yDist(engine) }, { speedDist(engine), speedDist(engine) }, 8.f };
+    }
+
+    // Runs as many fixed steps as fit into the elapsed time, returns the number of steps taken
+    inline size_t Advance(float frameSeconds, Benchmark& benchmark)
+    {
+        m_Accumulator += frameSeconds;
+        size_t steps = 0;
+        while (m_Accumulator >= s_TimeStep && steps < s_MaxStepsPerFrame)
+        {
+            {
+                const Benchmark::ScopedStage stage(benchmark, Benchmark::Stage::Integrate);
+                Integrate(occluders);
+                Integrate(lights);
+            }
+            {
+                const Benchmark::ScopedStage stage(benchmark, Benchmark::Stage::Broadphase);
+                for (const std::pair<size_t, size_t>& pair : m_Broadphase.FindPairs(occluders))
+                    Resolve(occluders[pair.first], occluders[pair.second]);
+            }
+            m_Accumulator -= s_TimeStep;
+            ++steps;
+        }
+
+        if (steps == s_MaxStepsPerFrame)
+            m_Accumulator = 0.f;
+        return steps;
+    }
+
+    // Batch API: casts raysPerLight rays evenly around every light, each one stops at the nearest occluder
+    // Every precision/query instantiation can be used, AnyHit only counts the hits since it has no endpoints
+    // Returns the number of rays that hit an occluder
+    template <class T = float, RayQuery Query = RayQuery::EntryExit>
+    inline size_t Trace(size_t raysPerLight, std::vector<Ray>& rays, Benchmark& benchmark)
+    {
+        const Benchmark::ScopedStage stage(benchmark, Benchmark::Stage::Trace);
+        PrepareDirections(raysPerLight);
+
+        const size_t packetsPerLight = (raysPerLight + s_PacketSize - 1) / s_PacketSize;
+        m_Pool.ParallelFor(lights.size() * packetsPerLight, s_PacketGrain, [&](size_t begin, size_t end)
+        {
+            // candidates are a subset of the occluders, both buffers are handed back after the chunk
+            FrameArena& arena = m_Pool.Arena();
+            const FrameArena::Scope scope(arena);
+            ArenaArray<Body> candidates = arena.AllocateArray<Body>(occluders.size());
+            ArenaArray<Body> subCandidates = arena.AllocateArray<Body>(occluders.size());
+            for (size_t packet = begin; packet < end; ++packet)
+            {
+                const size_t first = (packet % packetsPerLight) * s_PacketSize;
+                const size_t count = std::min(s_PacketSize, raysPerLight - first);
+                TracePacket<T, Query>(packet / packetsPerLight, first, count, raysPerLight, candidates, subCandidates);
+            }
+        });
+
+        rays.clear();
+        return Collect<Query>(0, m_Slots.size(), rays);
+    }
+
+    // Same as Trace but only for the rays [first, first + count) of one light, the render farm
+    // hands these angular ranges out as work units. The rays are appended in the order Trace produces them.
+    template <class T = float, RayQuery Query = RayQuery::EntryExit>
+    inline size_t TraceRange(size_t light, size_t first, size_t count, size_t raysPerLight, std::vector<Ray>& rays)
+    {
+        PrepareDirections(raysPerLight);
+
+        const size_t packets = (count + s_PacketSize - 1) / s_PacketSize;
+        m_Pool.ParallelFor(packets, s_PacketGrain, [&](size_t begin, size_t end)
+        {
+            // candidates are a subset of the occluders, both buffers are handed back after the chunk
+            FrameArena& arena = m_Pool.Arena();
+            const FrameArena::Scope scope(arena);
+            ArenaArray<Body> candidates = arena.AllocateArray<Body>(occluders.size());
+            ArenaArray<Body> subCandidates = arena.AllocateArray<Body>(occluders.size());
+            for (size_t packet = begin; packet < end; ++packet)
+            {
+                const size_t packetFirst = first + packet * s_PacketSize;
+                TracePacket<T, Query>(light, packetFirst, std::min(s_PacketSize, first + count - packetFirst), raysPerLight, candidates, subCandidates);
+            }
+        });
+
+        const size_t slot = (light * raysPerLight + first) * 2;
+        return Collect<Query>(slot, slot + count * 2, rays);
+    }
+
+    inline void AppendBodies(sf::VertexArray& vertices) const
+    {
+        vertices.setPrimitiveType(sf::Triangles);
+        for (const Body& body : occluders)
+            AppendCircle(vertices, body, sf::Color::White);
+        for (const Body& light : lights)
+            AppendCircle(vertices, light, sf::Color(255, 255, 102));
+    }
+};
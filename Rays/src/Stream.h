@@ -0,0 +1,363 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include "SFML/Network.hpp"
+
+#include "RayCache.h"
+
+// Scene streaming to remote viewers (see Viewer/), shared by the server in the app and the viewer.
+//   server -> viewer: Snapshot (bodies delta encoded against the base state, lights, rays)
+//   viewer -> server: Ack (the newest snapshot it decoded, becomes the base of the next delta)
+// A viewer without a usable base gets a keyframe, which is a delta against an empty state.
+enum class StreamMessage : sf::Uint8 { Snapshot, Ack };
+static inline constexpr sf::Uint32 sg_StreamNoBase = 0xFFFFFFFF;
+
+
+// Position in 1/8 pixels, radius in 1/8 pixels as well, the quantised values are what gets
+// compared, so a delta chain can't drift away from the state the server has
+struct StreamBody
+{
+public:
+    sf::Int32 x = 0;
+    sf::Int32 y = 0;
+    sf::Uint16 radius = 0;
+
+    static inline constexpr float s_Scale = 8.f;
+
+    template <class T>
+    static inline StreamBody From(const T& body)
+    {
+        StreamBody quantised;
+        quantised.x = static_cast<sf::Int32>(std::lround(body.position.x * s_Scale));
+        quantised.y = static_cast<sf::Int32>(std::lround(body.position.y * s_Scale));
+        quantised.radius = static_cast<sf::Uint16>(std::clamp(std::lround(body.radius * s_Scale), 0l, 65535l));
+        return quantised;
+    }
+
+    inline sf::Vector2f Position() const { return { static_cast<float>(x) / s_Scale, static_cast<float>(y) / s_Scale }; }
+    inline float Radius() const { return static_cast<float>(radius) / s_Scale; }
+    inline bool operator==(const StreamBody& other) const { return x == other.x && y == other.y && radius == other.radius; }
+    inline bool operator!=(const StreamBody& other) const { return !(*this == other); }
+};
+
+
+struct StreamState
+{
+public:
+    sf::Uint32 sequence = sg_StreamNoBase;
+    std::vector<StreamBody> bodies;
+    std::vector<StreamBody> lights;
+    CompactRays rays;
+private:
+    // per changed body: flags, then either a 16 bit delta or the absolute position, then the radius if it changed
+    enum Flags : sf::Uint8 { SmallDelta = 1, Absolute = 2, Radius = 4 };
+
+    static inline bool SameRays(const CompactRays& a, const CompactRays& b)
+    {
+        const auto same = [](const std::vector<CompactRay>& x, const std::vector<CompactRay>& y)
+        {
+            return x.size() == y.size() && std::equal(x.begin(), x.end(), y.begin(),
+                [](const CompactRay& r, const CompactRay& s) { return r.x0 == s.x0 && r.y0 == s.y0 && r.x1 == s.x1 && r.y1 == s.y1; });
+        };
+        return a.view == b.view && same(a.light, b.light) && same(a.shadow, b.shadow);
+    }
+
+    static inline bool FitsInt16(sf::Int32 value)
+    {
+        return value >= std::numeric_limits<sf::Int16>::min() && value <= std::numeric_limits<sf::Int16>::max();
+    }
+
+    static inline void WriteRays(sf::Packet& packet, const std::vector<CompactRay>& rays)
+    {
+        packet << static_cast<sf::Uint32>(rays.size());
+        for (const CompactRay& ray : rays)
+            packet << ray.x0 << ray.y0 << ray.x1 << ray.y1;
+    }
+
+    static inline bool ReadRays(sf::Packet& packet, std::vector<CompactRay>& rays)
+    {
+        sf::Uint32 count = 0;
+        if (!(packet >> count) || count > packet.getDataSize() / sizeof(CompactRay))
+            return false;
+        rays.resize(count);
+        for (CompactRay& ray : rays)
+            packet >> ray.x0 >> ray.y0 >> ray.x1 >> ray.y1;
+        return static_cast<bool>(packet);
+    }
+public:
+    // Writes everything after the message header, base is nullptr for a keyframe
+    inline void Encode(sf::Packet& packet, const StreamState* base) const
+    {
+        static const StreamState s_Empty;
+        const StreamState& from = base != nullptr ? *base : s_Empty;
+
+        packet << static_cast<sf::Uint32>(bodies.size());
+        sf::Uint32 changed = 0;
+        for (size_t i = 0; i < bodies.size(); ++i)
+            changed += i >= from.bodies.size() || bodies[i] != from.bodies[i];
+        packet << changed;
+
+        for (size_t i = 0; i < bodies.size(); ++i)
+        {
+            const StreamBody& body = bodies[i];
+            const bool hasBase = i < from.bodies.size();
+            if (hasBase && body == from.bodies[i])
+                continue;
+
+            const sf::Int32 dx = hasBase ? body.x - from.bodies[i].x : 0;
+            const sf::Int32 dy = hasBase ? body.y - from.bodies[i].y : 0;
+            sf::Uint8 flags = 0;
+            if (!hasBase || body.radius != from.bodies[i].radius)
+                flags |= Radius;
+            if (hasBase && FitsInt16(dx) && FitsInt16(dy))
+                flags |= (dx != 0 || dy != 0) ? SmallDelta : 0;
+            else
+                flags |= Absolute;
+
+            packet << static_cast<sf::Uint32>(i) << flags;
+            if (flags & SmallDelta)
+                packet << static_cast<sf::Int16>(dx) << static_cast<sf::Int16>(dy);
+            else if (flags & Absolute)
+                packet << body.x << body.y;
+            if (flags & Radius)
+                packet << body.radius;
+        }
+
+        packet << static_cast<sf::Uint32>(lights.size());
+        for (const StreamBody& light : lights)
+            packet << light.x << light.y << light.radius;
+
+        const bool raysChanged = base == nullptr || !SameRays(rays, base->rays);
+        packet << static_cast<sf::Uint8>(raysChanged);
+        if (raysChanged)
+        {
+            packet << rays.view.left << rays.view.top << rays.view.width << rays.view.height;
+            WriteRays(packet, rays.light);
+            WriteRays(packet, rays.shadow);
+        }
+    }
+
+    // Counterpart of Encode, returns false on malformed data
+    inline bool Decode(sf::Packet& packet, const StreamState* base)
+    {
+        static const StreamState s_Empty;
+        const StreamState& from = base != nullptr ? *base : s_Empty;
+
+        sf::Uint32 bodyCount = 0, changed = 0;
+        if (!(packet >> bodyCount >> changed) || bodyCount > packet.getDataSize() || changed > bodyCount)
+            return false;
+
+        bodies.assign(from.bodies.begin(), from.bodies.begin() + static_cast<std::ptrdiff_t>(std::min<size_t>(bodyCount, from.bodies.size())));
+        bodies.resize(bodyCount);
+        for (sf::Uint32 c = 0; c < changed; ++c)
+        {
+            sf::Uint32 index = 0;
+            sf::Uint8 flags = 0;
+            if (!(packet >> index >> flags) || index >= bodyCount)
+                return false;
+
+            StreamBody& body = bodies[index];
+            if (flags & SmallDelta)
+            {
+                sf::Int16 dx = 0, dy = 0;
+                packet >> dx >> dy;
+                body.x += dx;
+                body.y += dy;
+            }
+            else if (flags & Absolute)
+                packet >> body.x >> body.y;
+            if (flags & Radius)
+                packet >> body.radius;
+        }
+
+        sf::Uint32 lightCount = 0;
+        if (!(packet >> lightCount) || lightCount > packet.getDataSize())
+            return false;
+        lights.resize(lightCount);
+        for (StreamBody& light : lights)
+            packet >> light.x >> light.y >> light.radius;
+
+        sf::Uint8 raysChanged = 0;
+        if (!(packet >> raysChanged))
+            return false;
+        if (raysChanged == 0)
+        {
+            if (base == nullptr)
+                return false;
+            rays = base->rays;
+            return true;
+        }
+
+        packet >> rays.view.left >> rays.view.top >> rays.view.width >> rays.view.height;
+        return ReadRays(packet, rays.light) && ReadRays(packet, rays.shadow);
+    }
+};
+
+
+// Streams the scene to every connected viewer, polled once per frame from the main loop.
+// All sockets are non blocking, a viewer that can't keep up skips snapshots instead of stalling the app.
+struct StreamServer
+{
+private:
+    static inline constexpr size_t s_History = 32; // states a viewer can acknowledge before it gets a keyframe
+
+    struct Viewer
+    {
+    public:
+        std::unique_ptr<sf::TcpSocket> socket;
+        sf::Uint32 acknowledged = sg_StreamNoBase;
+        sf::Packet pending; // partially sent snapshot
+        bool sending = false;
+    };
+
+    sf::TcpListener m_Listener;
+    std::vector<Viewer> m_Viewers;
+    std::deque<StreamState> m_History; // back is the newest state
+    StreamState m_Next;
+    sf::Uint32 m_Sequence = 0;
+    bool m_Listening = false;
+
+    size_t m_Snapshots = 0;
+    size_t m_Keyframes = 0;
+    size_t m_Skipped = 0;
+    size_t m_Bytes = 0;
+    size_t m_MaxViewers = 0;
+private:
+    inline const StreamState* FindState(sf::Uint32 sequence) const
+    {
+        if (sequence == sg_StreamNoBase)
+            return nullptr;
+        for (const StreamState& state : m_History)
+            if (state.sequence == sequence)
+                return &state;
+        return nullptr;
+    }
+
+    inline void Accept()
+    {
+        while (true)
+        {
+            Viewer viewer;
+            viewer.socket = std::make_unique<sf::TcpSocket>();
+            if (m_Listener.accept(*viewer.socket) != sf::Socket::Done)
+                return;
+            viewer.socket->setBlocking(false);
+            m_Viewers.push_back(std::move(viewer));
+            m_MaxViewers = std::max(m_MaxViewers, m_Viewers.size());
+        }
+    }
+
+    // returns false if the viewer disconnected
+    inline bool ReadAcks(Viewer& viewer)
+    {
+        while (true)
+        {
+            sf::Packet packet;
+            const sf::Socket::Status status = viewer.socket->receive(packet);
+            if (status == sf::Socket::NotReady || status == sf::Socket::Partial)
+                return true;
+            if (status != sf::Socket::Done)
+                return false;
+
+            sf::Uint8 type = 0;
+            sf::Uint32 sequence = 0;
+            if (!(packet >> type >> sequence) || type != static_cast<sf::Uint8>(StreamMessage::Ack))
+                return false;
+            viewer.acknowledged = sequence;
+        }
+    }
+
+    inline bool Flush(Viewer& viewer)
+    {
+        const sf::Socket::Status status = viewer.socket->send(viewer.pending);
+        viewer.sending = status == sf::Socket::Partial;
+        return status == sf::Socket::Done || status == sf::Socket::Partial || status == sf::Socket::NotReady;
+    }
+public:
+    inline bool Listen(unsigned short port, std::ostream& err)
+    {
+        if (m_Listener.listen(port) != sf::Socket::Done)
+        {
+            err << "Stream server: failed to listen on port " << port << '\n';
+            return false;
+        }
+        m_Listener.setBlocking(false);
+        m_Listening = true;
+        return true;
+    }
+
+    inline bool Listening() const { return m_Listening; }
+
+    // Occluders and lights are ranges of anything with a position and radius
+    template <class Occluders, class Lights>
+    inline void Publish(const Occluders& occluders, const Lights& lights, const CompactRays& rays)
+    {
+        if (!m_Listening)
+            return;
+
+        Accept();
+        if (m_Viewers.empty())
+            return;
+
+        m_Next.sequence = m_Sequence++;
+        m_Next.bodies.clear();
+        for (const auto& occluder : occluders)
+            m_Next.bodies.push_back(StreamBody::From(occluder));
+        m_Next.lights.clear();
+        for (const auto& light : lights)
+            m_Next.lights.push_back(StreamBody::From(light));
+        m_Next.rays.view = rays.view;
+        m_Next.rays.light.assign(rays.light.begin(), rays.light.end());
+        m_Next.rays.shadow.assign(rays.shadow.begin(), rays.shadow.end());
+
+        for (size_t i = 0; i < m_Viewers.size();)
+        {
+            Viewer& viewer = m_Viewers[i];
+            bool alive = ReadAcks(viewer);
+            if (alive && viewer.sending)
+            {
+                alive = Flush(viewer);
+                ++m_Skipped;
+            }
+            else if (alive)
+            {
+                const StreamState* base = FindState(viewer.acknowledged);
+                viewer.pending.clear();
+                viewer.pending << static_cast<sf::Uint8>(StreamMessage::Snapshot) << m_Next.sequence << (base != nullptr ? base->sequence : sg_StreamNoBase);
+                m_Next.Encode(viewer.pending, base);
+                m_Bytes += viewer.pending.getDataSize();
+                ++m_Snapshots;
+                m_Keyframes += base == nullptr;
+                alive = Flush(viewer);
+            }
+
+            if (alive)
+                ++i;
+            else
+                m_Viewers.erase(m_Viewers.begin() + static_cast<std::ptrdiff_t>(i));
+        }
+
+        m_History.push_back(m_Next);
+        if (m_History.size() > s_History)
+            m_History.pop_front();
+    }
+
+    inline void Print(std::ostream& os) const
+    {
+        if (!m_Listening || m_Snapshots == 0)
+            return;
+
+        os << std::fixed << std::setprecision(2);
+        os << "Stream: " << m_MaxViewers << " viewers at most | snapshots " << m_Snapshots << " (keyframes " << m_Keyframes << ", skipped " << m_Skipped
+           << ") | avg snapshot " << static_cast<double>(m_Bytes) / static_cast<double>(m_Snapshots) / 1024.0 << "KiB\n";
+    }
+};
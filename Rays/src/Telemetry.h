@@ -0,0 +1,132 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+
+// Number of calls to the global operator new, counted by the replacements in main.cpp
+inline std::atomic<size_t> sg_Allocations = 0;
+
+// Keeps the stats of the last frames in a ring buffer that is allocated once, recording a frame never allocates.
+// Recompute and draw times are taken from the Benchmark stages that were recorded during the frame.
+struct Telemetry
+{
+public:
+    struct Frame
+    {
+    public:
+        uint64_t index = 0;
+        float frameTime = 0.f;     // milliseconds
+        float recomputeTime = 0.f; // milliseconds spent integrating, tracing and rasterising
+        float drawTime = 0.f;      // milliseconds
+        uint32_t rays = 0;         // rays calculated this frame, 0 if the cached ones were reused
+        uint32_t lightRays = 0;
+        uint32_t shadowRays = 0;
+        uint32_t allocations = 0;
+    };
+private:
+    static constexpr size_t s_StageCount = static_cast<size_t>(Benchmark::Stage::Count);
+
+    std::vector<Frame> m_Frames;
+    size_t m_Next = 0;
+    uint64_t m_Recorded = 0;
+    std::array<double, s_StageCount> m_StageTotals = {};
+    size_t m_Allocations = sg_Allocations.load(std::memory_order_relaxed);
+private:
+    // seconds the stage took since the last call
+    inline double StageDelta(const Benchmark& benchmark, Benchmark::Stage stage)
+    {
+        double& last = m_StageTotals[static_cast<size_t>(stage)];
+        const double total = benchmark.Get(stage).total;
+        const double delta = total - last;
+        last = total;
+        return delta;
+    }
+
+    template <class Fn>
+    inline void ForEach(Fn&& fn) const
+    {
+        const size_t count = Size();
+        const size_t first = m_Recorded > m_Frames.size() ? m_Next : 0;
+        for (size_t i = 0; i < count; ++i)
+            fn(m_Frames[(first + i) % m_Frames.size()]);
+    }
+public:
+    inline explicit Telemetry(size_t capacity = 60 * 60 * 10) : m_Frames(std::max<size_t>(capacity, 1)) {} // 10 minutes at 60 fps
+
+    inline void EndFrame(const Benchmark& benchmark, double frameSeconds, size_t rays, size_t lightRays, size_t shadowRays)
+    {
+        double recompute = 0.0;
+        for (const Benchmark::Stage stage : { Benchmark::Stage::Integrate, Benchmark::Stage::Broadphase, Benchmark::Stage::Trace, Benchmark::Stage::Rasterise })
+            recompute += StageDelta(benchmark, stage);
+        const double draw = StageDelta(benchmark, Benchmark::Stage::Draw);
+
+        const size_t allocations = sg_Allocations.load(std::memory_order_relaxed);
+        Frame& frame = m_Frames[m_Next];
+        frame.index = m_Recorded;
+        frame.frameTime = static_cast<float>(frameSeconds * 1e3);
+        frame.recomputeTime = static_cast<float>(recompute * 1e3);
+        frame.drawTime = static_cast<float>(draw * 1e3);
+        frame.rays = static_cast<uint32_t>(rays);
+        frame.lightRays = static_cast<uint32_t>(lightRays);
+        frame.shadowRays = static_cast<uint32_t>(shadowRays);
+        frame.allocations = static_cast<uint32_t>(allocations - m_Allocations);
+        m_Allocations = allocations;
+
+        m_Next = (m_Next + 1) % m_Frames.size();
+        ++m_Recorded;
+    }
+
+    inline size_t Size() const { return static_cast<size_t>(std::min<uint64_t>(m_Recorded, m_Frames.size())); }
+    inline uint64_t Recorded() const { return m_Recorded; }
+
+    // Oldest frame first
+    inline void ExportCsv(std::ostream& os) const
+    {
+        os << "frame,frame_ms,recompute_ms,draw_ms,rays,light_rays,shadow_rays,allocations\n";
+        ForEach([&os](const Frame& frame)
+        {
+            os << frame.index << ',' << frame.frameTime << ',' << frame.recomputeTime << ',' << frame.drawTime << ',' << frame.rays << ','
+               << frame.lightRays << ',' << frame.shadowRays << ',' << frame.allocations << '\n';
+        });
+    }
+
+    inline void ExportJson(std::ostream& os) const
+    {
+        os << "{\n  \"recorded\": " << m_Recorded << ",\n  \"frames\": [";
+        bool first = true;
+        ForEach([&os, &first](const Frame& frame)
+        {
+            os << (first ? "\n" : ",\n") << "    { \"frame\": " << frame.index << ", \"frame_ms\": " << frame.frameTime
+               << ", \"recompute_ms\": " << frame.recomputeTime << ", \"draw_ms\": " << frame.drawTime << ", \"rays\": " << frame.rays
+               << ", \"light_rays\": " << frame.lightRays << ", \"shadow_rays\": " << frame.shadowRays << ", \"allocations\": " << frame.allocations << " }";
+            first = false;
+        });
+        os << "\n  ]\n}\n";
+    }
+
+    // Writes JSON if the path ends with .json and CSV otherwise
+    inline bool Export(const std::string& path, std::ostream& err) const
+    {
+        std::ofstream file(path);
+        if (!file)
+        {
+            err << "Failed to open telemetry file: " << path << '\n';
+            return false;
+        }
+
+        const bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+        if (json)
+            ExportJson(file);
+        else
+            ExportCsv(file);
+        return static_cast<bool>(file);
+    }
+};
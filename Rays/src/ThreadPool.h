@@ -0,0 +1,121 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "FrameArena.h"
+
+// Persistent workers so that per-step work doesn't pay for thread creation.
+// ParallelFor splits [0, count) into chunks of 'grain', the calling thread helps out.
+// Jobs get their scratch memory from Arena(), which has a region for every thread of the pool.
+struct ThreadPool
+{
+private:
+    std::vector<std::thread> m_Workers;
+    std::mutex m_Mutex;
+    std::condition_variable m_WorkCondition;
+    std::condition_variable m_DoneCondition;
+    const void* m_Job = nullptr; // the callable of the running ParallelFor, lives on the caller's stack
+    void (*m_Invoke)(const void* job, size_t begin, size_t end) = nullptr;
+    FrameArena m_Arena;
+    std::atomic<size_t> m_NextChunk{ 0 };
+    size_t m_Count = 0;
+    size_t m_Grain = 1;
+    size_t m_Generation = 0;
+    size_t m_Busy = 0;
+    bool m_Stop = false;
+private:
+    inline void RunChunks()
+    {
+        const size_t chunks = (m_Count + m_Grain - 1) / m_Grain;
+        for (size_t chunk = m_NextChunk++; chunk < chunks; chunk = m_NextChunk++)
+        {
+            const size_t begin = chunk * m_Grain;
+            m_Invoke(m_Job, begin, std::min(begin + m_Grain, m_Count));
+        }
+    }
+
+    inline void WorkerLoop()
+    {
+        size_t seenGeneration = 0;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_WorkCondition.wait(lock, [&]() { return m_Stop || m_Generation != seenGeneration; });
+                if (m_Stop)
+                    return;
+                seenGeneration = m_Generation;
+            }
+
+            RunChunks();
+
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (--m_Busy == 0)
+                m_DoneCondition.notify_one();
+        }
+    }
+public:
+    inline explicit ThreadPool(size_t threads = std::max<size_t>(std::thread::hardware_concurrency(), 1)) : m_Arena(threads)
+    {
+        // the calling thread is a worker as well
+        for (size_t i = 1; i < threads; ++i)
+            m_Workers.emplace_back([this, i]() { m_Arena.BindThread(i); WorkerLoop(); });
+    }
+
+    inline ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stop = true;
+        }
+        m_WorkCondition.notify_all();
+        for (std::thread& worker : m_Workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    inline size_t ThreadCount() const { return m_Workers.size() + 1; }
+    inline FrameArena& Arena() { return m_Arena; }
+
+    // func(begin, end) is called for disjoint ranges, returns once all of them are done
+    // func isn't copied, nothing is allocated per call
+    template <class Fn>
+    inline void ParallelFor(size_t count, size_t grain, const Fn& func)
+    {
+        if (count == 0)
+            return;
+
+        grain = std::max<size_t>(grain, 1);
+        if (m_Workers.empty() || count <= grain)
+        {
+            func(0, count);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Job = &func;
+            m_Invoke = [](const void* job, size_t begin, size_t end) { (*static_cast<const Fn*>(job))(begin, end); };
+            m_Count = count;
+            m_Grain = grain;
+            m_NextChunk = 0;
+            m_Busy = m_Workers.size(); // every worker checks in once per generation
+            ++m_Generation;
+        }
+        m_WorkCondition.notify_all();
+
+        RunChunks();
+
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_DoneCondition.wait(lock, [&]() { return m_Busy == 0; });
+        m_Job = nullptr;
+        m_Invoke = nullptr;
+    }
+};
@@ -0,0 +1,95 @@
+#pragma once
+#include <fstream>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+#include "SFML/Graphics/Color.hpp"
+#include "SFML/System/Vector2.hpp"
+
+#include "Ray.h"
+
+// Knobs of the interactive mode that can be changed while the app is running, one setting per line, '#' starts a comment
+//   xoffset 0.228          yoffset 0.228          rays 4450          tscalar 10000
+//   lightcolor 255 255 102                        shadowcolor 70 70 70
+//   backgroundcolor 105 105 105                   circlecolor 255 255 255
+//   window 1000 750
+struct Tuning
+{
+public:
+    SweepStep step;
+    size_t rays = 4450;
+    float tScalar = 10000.f;
+    sf::Color lightColor = sf::Color(255, 255, 102);
+    sf::Color shadowColor = sf::Color(70, 70, 70);
+    sf::Color backgroundColor = sf::Color(105, 105, 105);
+    sf::Color circleColor = sf::Color::White;
+    sf::Vector2u windowSize = { 1000, 750 };
+private:
+    static inline bool ParseColor(std::istringstream& line, sf::Color& color)
+    {
+        unsigned int r, g, b;
+        if (!(line >> r >> g >> b) || r > 255 || g > 255 || b > 255)
+            return false;
+        color = sf::Color(static_cast<sf::Uint8>(r), static_cast<sf::Uint8>(g), static_cast<sf::Uint8>(b));
+        return true;
+    }
+
+    inline bool ParseLine(const std::string& key, std::istringstream& line)
+    {
+        if (key == "xoffset")
+            return line >> step.x && step.x > 0.f;
+        if (key == "yoffset")
+            return line >> step.y && step.y > 0.f;
+        if (key == "rays")
+            return line >> rays && rays != 0;
+        if (key == "tscalar")
+            return line >> tScalar && tScalar > 0.f;
+        if (key == "lightcolor")
+            return ParseColor(line, lightColor);
+        if (key == "shadowcolor")
+            return ParseColor(line, shadowColor);
+        if (key == "backgroundcolor")
+            return ParseColor(line, backgroundColor);
+        if (key == "circlecolor")
+            return ParseColor(line, circleColor);
+        if (key == "window")
+            return line >> windowSize.x >> windowSize.y && windowSize.x != 0 && windowSize.y != 0;
+        return false;
+    }
+public:
+    // Errors are written to err together with the line they occurred in, the values are only replaced if the whole file is valid
+    // so that a half saved file doesn't break the running app. Settings missing from the file go back to their defaults.
+    inline bool LoadFromFile(const std::string& path, std::ostream& err)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            err << "Failed to open config file: " << path << '\n';
+            return false;
+        }
+
+        Tuning tuning;
+        std::string str;
+        size_t lineNumber = 0;
+        while (std::getline(file, str))
+        {
+            ++lineNumber;
+            str = str.substr(0, str.find('#'));
+            std::istringstream line(str);
+            std::string key;
+            if (!(line >> key))
+                continue;
+
+            std::string rest;
+            if (!tuning.ParseLine(key, line) || line >> rest)
+            {
+                err << path << ':' << lineNumber << ": invalid line '" << str << "'\n";
+                return false;
+            }
+        }
+
+        *this = tuning;
+        return true;
+    }
+};
@@ -0,0 +1,263 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "SFML/System/Vector2.hpp"
+
+#include "RayCache.h"
+
+struct VisibilityKey
+{
+public:
+    int32_t lightX = 0;
+    int32_t lightY = 0;
+    uint64_t occluderVersion = 0;
+    uint32_t rayBudget = 0;
+    bool shadows = false; // without shadows only the light rays were calculated
+
+    inline bool operator==(const VisibilityKey& other) const
+    {
+        return lightX == other.lightX && lightY == other.lightY && occluderVersion == other.occluderVersion
+            && rayBudget == other.rayBudget && shadows == other.shadows;
+    }
+};
+
+
+struct VisibilityKeyHash
+{
+    inline size_t operator()(const VisibilityKey& key) const noexcept
+    {
+        uint64_t hash = 14695981039346656037ull; // FNV-1a over the fields
+        const auto mix = [&hash](uint64_t value) { hash = (hash ^ value) * 1099511628211ull; };
+        mix(static_cast<uint32_t>(key.lightX));
+        mix(static_cast<uint32_t>(key.lightY));
+        mix(key.occluderVersion);
+        mix(key.rayBudget);
+        mix(key.shadows);
+        return static_cast<size_t>(hash);
+    }
+};
+
+
+// Bounded LRU cache of finished ray results, dragging the light back to a spot it has
+// already been at restores the rays instead of tracing them again
+struct VisibilityCache
+{
+public:
+    struct Entry
+    {
+    public:
+        VisibilityKey key;
+        CompactRays rays;
+        size_t lightRays = 0;
+        size_t shadowRays = 0;
+    };
+private:
+    using EntryList = std::list<Entry>;
+    using Index = std::unordered_map<VisibilityKey, EntryList::iterator, VisibilityKeyHash>;
+
+    EntryList m_Entries; // front is the most recently used
+    Index m_Index;
+    EntryList m_Spare; // reserved or removed entries, their buffers are reused before anything new is allocated
+    std::vector<Index::node_type> m_SpareNodes; // one per spare entry
+    size_t m_MemoryCap;
+    size_t m_MemoryUsage = 0;
+    bool m_Full = false; // set by the first eviction, from then on misses recycle entries instead of adding new ones
+    float m_PositionStep;
+    size_t m_Hits = 0;
+    size_t m_Misses = 0;
+private:
+    static inline size_t EntrySize(const Entry& entry)
+    {
+        return sizeof(Entry) + entry.rays.MemoryUsage();
+    }
+
+    inline void EvictUntil(size_t memory)
+    {
+        // spares hold no rays, they go first
+        while (!m_Spare.empty() && m_MemoryUsage > memory)
+        {
+            m_MemoryUsage -= EntrySize(m_Spare.back());
+            m_Spare.pop_back();
+            m_SpareNodes.pop_back();
+        }
+        while (!m_Entries.empty() && m_MemoryUsage > memory)
+        {
+            const Entry& last = m_Entries.back();
+            m_Full = true;
+            m_MemoryUsage -= EntrySize(last);
+            m_Index.erase(last.key);
+            m_Entries.pop_back();
+        }
+    }
+
+    // the entry keeps its buffers and stays in the memory usage
+    inline void MoveToSpare(Index::iterator it)
+    {
+        const EntryList::iterator entry = it->second;
+        m_SpareNodes.push_back(m_Index.extract(it));
+        m_Spare.splice(m_Spare.end(), m_Entries, entry);
+    }
+    static inline void Assign(Entry& entry, const VisibilityKey& key, const CompactRays& rays, size_t lightRays, size_t shadowRays)
+    {
+        entry.key = key;
+        entry.rays.light.assign(rays.light.begin(), rays.light.end());
+        entry.rays.shadow.assign(rays.shadow.begin(), rays.shadow.end());
+        entry.rays.view = rays.view;
+        entry.lightRays = lightRays;
+        entry.shadowRays = shadowRays;
+    }
+public:
+    inline explicit VisibilityCache(size_t memoryCap, float positionStep = 1.f) : m_MemoryCap(memoryCap), m_PositionStep(positionStep) {}
+
+    inline VisibilityKey MakeKey(const sf::Vector2f& lightPosition, uint64_t occluderVersion, size_t rayBudget, bool shadows) const
+    {
+        VisibilityKey key;
+        key.lightX = static_cast<int32_t>(std::lround(lightPosition.x / m_PositionStep));
+        key.lightY = static_cast<int32_t>(std::lround(lightPosition.y / m_PositionStep));
+        key.occluderVersion = occluderVersion;
+        key.rayBudget = static_cast<uint32_t>(rayBudget);
+        key.shadows = shadows;
+        return key;
+    }
+
+    // Allocates empty entries with room for raysPerEntry light and shadow rays each, as many as fit into
+    // the memory cap. Misses fill these before they allocate, warming the cache up front keeps its
+    // growth out of the frames that follow.
+    inline void Reserve(size_t entries, size_t raysPerEntry)
+    {
+        const size_t size = sizeof(Entry) + raysPerEntry * 2 * sizeof(CompactRay);
+        m_Index.reserve(m_Index.size() + m_Spare.size() + entries);
+        for (size_t i = 0; i < entries && m_MemoryUsage + size <= m_MemoryCap; ++i)
+        {
+            Entry& entry = m_Spare.emplace_back();
+            entry.rays.light.reserve(raysPerEntry);
+            entry.rays.shadow.reserve(raysPerEntry);
+            m_MemoryUsage += EntrySize(entry);
+
+            // map nodes can only be made by inserting, the key is overwritten when the node is used
+            VisibilityKey placeholder;
+            placeholder.rayBudget = UINT32_MAX;
+            placeholder.lightX = static_cast<int32_t>(i);
+            m_SpareNodes.push_back(m_Index.extract(m_Index.emplace(placeholder, std::prev(m_Spare.end())).first));
+        }
+    }
+
+    // Returns nullptr on a miss, a hit becomes the most recently used entry
+    inline const Entry* Find(const VisibilityKey& key)
+    {
+        const auto it = m_Index.find(key);
+        if (it == m_Index.end())
+        {
+            ++m_Misses;
+            return nullptr;
+        }
+
+        ++m_Hits;
+        m_Entries.splice(m_Entries.begin(), m_Entries, it->second);
+        return &*it->second;
+    }
+
+    inline void Insert(const VisibilityKey& key, const CompactRays& rays, size_t lightRays, size_t shadowRays)
+    {
+        const auto it = m_Index.find(key);
+        if (it != m_Index.end())
+            MoveToSpare(it);
+
+        const size_t size = sizeof(Entry) + (rays.light.size() + rays.shadow.size()) * sizeof(CompactRay);
+        if (size > m_MemoryCap)
+            return;
+
+        if (!m_Spare.empty())
+        {
+            m_Entries.splice(m_Entries.begin(), m_Spare, m_Spare.begin());
+            Entry& spare = m_Entries.front();
+            m_MemoryUsage -= EntrySize(spare);
+            Assign(spare, key, rays, lightRays, shadowRays);
+            Index::node_type node = std::move(m_SpareNodes.back());
+            m_SpareNodes.pop_back();
+            node.key() = key;
+            node.mapped() = m_Entries.begin();
+            m_Index.insert(std::move(node));
+            m_MemoryUsage += EntrySize(spare);
+            EvictUntil(m_MemoryCap);
+            return;
+        }
+
+        // a full cache recycles its least recently used entry, its buffers and nodes are
+        // reused so that a cache in steady state doesn't allocate per miss
+        if (!m_Entries.empty() && (m_Full || m_MemoryUsage + size > m_MemoryCap))
+        {
+            m_Entries.splice(m_Entries.begin(), m_Entries, std::prev(m_Entries.end()));
+            Entry& recycled = m_Entries.front();
+            m_MemoryUsage -= EntrySize(recycled);
+            auto node = m_Index.extract(recycled.key);
+            Assign(recycled, key, rays, lightRays, shadowRays);
+            node.key() = key;
+            m_Index.insert(std::move(node));
+            m_MemoryUsage += EntrySize(recycled);
+            EvictUntil(m_MemoryCap);
+            return;
+        }
+
+        Entry entry;
+        Assign(entry, key, rays, lightRays, shadowRays); // exact capacity, no slack is kept around
+
+        EvictUntil(m_MemoryCap - size);
+        m_Entries.push_front(std::move(entry));
+        m_Index.emplace(key, m_Entries.begin());
+        m_MemoryUsage += size;
+    }
+
+    // The entries become spares, the next misses refill them without allocating
+    inline void Clear()
+    {
+        while (!m_Index.empty())
+            MoveToSpare(m_Index.begin());
+        m_Full = false;
+    }
+
+    inline void SetMemoryCap(size_t memoryCap)
+    {
+        m_MemoryCap = memoryCap;
+        EvictUntil(m_MemoryCap);
+    }
+
+    inline size_t Hits() const { return m_Hits; }
+    inline size_t Misses() const { return m_Misses; }
+    inline size_t HitRate() const { return m_Hits + m_Misses == 0 ? 0 : m_Hits * 100 / (m_Hits + m_Misses); } // in percent
+    inline size_t Size() const { return m_Entries.size(); } // without the spares
+    inline size_t MemoryUsage() const { return m_MemoryUsage; }
+};
+
+
+// Static scene: restores the rays from the cache or sweeps them again and stores the result.
+// Returns the light and shadow ray counts.
+inline std::pair<size_t, size_t> TraceStaticScene(VisibilityCache& cache, CompactRayCache& rayCache, const sf::Vector2f& light, const sf::Vector2f& circlePosition,
+    float radius, uint64_t occluderVersion, size_t numRays, const SweepStep& step, bool shadows, const sf::FloatRect& view)
+{
+    const VisibilityKey key = cache.MakeKey(light, occluderVersion, numRays, shadows);
+    if (const VisibilityCache::Entry* entry = cache.Find(key))
+    {
+        rayCache.Restore(entry->rays);
+        return { entry->lightRays, entry->shadowRays };
+    }
+
+    // without shadows there's no need to calculate the exit point
+    rayCache.Clear(view);
+    const auto addRays = [&rayCache](const RayPair& lines) { rayCache.Add(lines.light); rayCache.Add(lines.shadow); };
+    const size_t hits = shadows
+        ? SweepCircle<RayQuery::EntryExit>(light, radius, circlePosition, numRays, step, view.height, addRays)
+        : SweepCircle<RayQuery::NearestHit>(light, radius, circlePosition, numRays, step, view.height, addRays);
+
+    const size_t shadowRays = shadows ? hits : 0;
+    cache.Insert(key, rayCache.Rays(), hits, shadowRays);
+    return { hits, shadowRays };
+}
@@ -1,67 +1,110 @@
+#include <algorithm>
 #include <array>
+#include <climits>
 #include <cmath>
 #include <cstdint>
+#include <cstdlib>
+#include <filesystem>
 #include <iostream>
 #include <memory>
+#include <new>
 #include <string>
 #include <string_view>
+#include <thread>
+#include <tuple>
 #include <vector>
 
+#ifdef _WIN32
+    #include <malloc.h>
+#endif
+
 #include "SFML/Graphics.hpp"
 
 #include "Arial.h"
-
-static inline constexpr float sg_TScalar = 10000.f;
-
-struct Ray
+#include "Benchmark.h"
+#include "CommandLine.h"
+#include "Farm.h"
+#include "FileWatcher.h"
+#include "Headless.h"
+#include "InputQueue.h"
+#include "LightMap.h"
+#include "Ray.h"
+#include "RayCache.h"
+#include "SdfEngine.h"
+#include "Simulation.h"
+#include "Stream.h"
+#include "Telemetry.h"
+#include "ThreadPool.h"
+#include "Tuning.h"
+#include "VisibilityCache.h"
+
+// Counts every allocation for the telemetry, the array and nothrow versions forward to these by default.
+// gcc sees the malloc/free inside of the replaced operators after inlining them into a new/delete pair and
+// reports it as -Wmismatched-new-delete at -O2, the pairs below are matched, only their insides differ.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void* operator new(std::size_t size)
 {
-private:
-    static const sf::Color s_LightColor;
-    static const sf::Color s_ShadowColor;
-public:
-    enum class Type { Light, Shadow, None };
+    sg_Allocations.fetch_add(1, std::memory_order_relaxed);
+    while (true)
+    {
+        if (void* ptr = std::malloc(size == 0 ? 1 : size))
+            return ptr;
+        const std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr)
+            throw std::bad_alloc();
+        handler();
+    }
+}
 
-    sf::Vector2f m_Origin;
-    sf::Vector2f m_Intersection;
-    Type m_Type = Type::None;
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
 
-    inline Ray() = default;
-    inline explicit Ray(const sf::Vector2f& origin) : m_Origin(origin) {}
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
 
-    inline void Draw(sf::RenderWindow& window) const
+// over-aligned types (alignas(64) and up) skip the versions above
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    sg_Allocations.fetch_add(1, std::memory_order_relaxed);
+    const std::size_t align = static_cast<std::size_t>(alignment);
+    while (true)
     {
-        if (m_Type == Type::Light)
-        {
-            const std::array<sf::Vertex, 2> line =
-            {
-                sf::Vertex(m_Origin, s_LightColor),
-                sf::Vertex(m_Intersection, s_LightColor)
-            };
-            window.draw(&line[0], 2, sf::Lines);
-        }
-        else
-        {
-            const std::array<sf::Vertex, 2> line =
-            {
-                sf::Vertex(m_Origin, s_ShadowColor),
-                sf::Vertex(m_Intersection, s_ShadowColor)
-            };
-            window.draw(&line[0], 2, sf::Lines);
-        }
+#ifdef _WIN32
+        if (void* ptr = _aligned_malloc(size == 0 ? 1 : size, align))
+#else
+        if (void* ptr = std::aligned_alloc(align, (std::max<std::size_t>(size, 1) + align - 1) / align * align)) // size has to be a multiple of the alignment
+#endif
+            return ptr;
+        const std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr)
+            throw std::bad_alloc();
+        handler();
     }
-};
-const inline sf::Color Ray::s_LightColor = sf::Color(255, 255, 102);
-const inline sf::Color Ray::s_ShadowColor = sf::Color(70, 70, 70);
-
+}
 
-struct RayPair
+void operator delete(void* ptr, std::align_val_t) noexcept
 {
-public:
-    Ray light;
-    Ray shadow;
-    inline explicit RayPair(const sf::Vector2f& origin) : light(origin) {}
-};
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
 
+void operator delete(void* ptr, std::size_t, std::align_val_t alignment) noexcept
+{
+    operator delete(ptr, alignment);
+}
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+    #pragma GCC diagnostic pop
+#endif
 
 struct Text : public sf::Text
 {
@@ -128,7 +171,7 @@ private: // for generating texts
     float m_YPos;
     float m_YOffset;
     size_t m_GeneratedTexts = 0;
-    std::array<Text, 9> m_Texts;
+    std::array<Text, 16> m_Texts;
     sf::RenderWindow& m_Window;
 
     const std::string onStr = "On";
@@ -145,6 +188,13 @@ public:
     TextProperties<bool> shadow;
     TextProperties<bool> whiteTextColor;
     TextProperties<std::pair<unsigned int, std::string>> fpsLimit;
+    TextProperties<bool> simulation;
+    TextProperties<size_t> stepTime;
+    TextProperties<size_t> cacheHitRate;
+    TextProperties<bool> sdf;
+    TextProperties<bool> lightMap;
+    TextProperties<size_t> inputLatency;
+    TextProperties<size_t> drawCalls;
 private:
     inline size_t GenerateText(const std::string& text)
     {
@@ -166,6 +216,7 @@ public:
         : m_WindowSizeX(windowXSize), m_YPos(yPos), m_YOffset(yOffset), m_Window(window)
     {
         m_Font.loadFromMemory(sg_RawArialData, sg_RawArialDataRelativeSize);
+        m_Font.preloadGlyphs(' ', '~', 20); // printable ASCII at the HUD size, the counters never load glyphs mid frame
 
         fps.textId = GenerateText("FPS: ");
         rays.textId = GenerateText("Rays: ");
@@ -176,6 +227,13 @@ public:
         shadow.textId = GenerateText("Shadow(d): ");
         whiteTextColor.textId = GenerateText("Text color(e): ");
         fpsLimit.textId = GenerateText("FPS limit(w/s/f): ");
+        simulation.textId = GenerateText("Simulation(m): ");
+        stepTime.textId = GenerateText("Step(us): ");
+        cacheHitRate.textId = GenerateText("Cache hits(%): ");
+        sdf.textId = GenerateText("SDF engine(g): ");
+        lightMap.textId = GenerateText("Light map(l): ");
+        inputLatency.textId = GenerateText("Input latency(us): ");
+        drawCalls.textId = GenerateText("Draw calls: ");
 
         rays.value = 0;
         lightRays.value = 0;
@@ -184,6 +242,13 @@ public:
         shadow.value = true;
         whiteTextColor.value = true;
         fpsLimit.value = std::make_pair(60, "60");
+        simulation.value = false;
+        stepTime.value = 0;
+        cacheHitRate.value = 0;
+        sdf.value = false;
+        lightMap.value = false;
+        inputLatency.value = 0;
+        drawCalls.value = 0;
     }
 
     inline void DrawTexts() const
@@ -221,6 +286,13 @@ public:
         UpdateText(shadow.textId, onStr, offStr, shadow.value);
         UpdateText(whiteTextColor.textId, whiteStr, blackStr, whiteTextColor.value);
         m_Texts[fpsLimit.textId].Update(fpsLimit.value.second);
+        UpdateText(simulation.textId, onStr, offStr, simulation.value);
+        UpdateText(stepTime);
+        UpdateText(cacheHitRate);
+        UpdateText(sdf.textId, onStr, offStr, sdf.value);
+        UpdateText(lightMap.textId, onStr, offStr, lightMap.value);
+        UpdateText(inputLatency);
+        UpdateText(drawCalls);
 
         lightRays.value = 0;
         shadowRays.value = 0;
@@ -231,7 +303,6 @@ public:
 struct LightSource : public sf::CircleShape
 {
 public:
-    sf::Vector2f m_Direction;
     sf::Vector2f m_Origin;
     inline LightSource(float radius, size_t pointCount) : sf::CircleShape(radius, pointCount) {}
 
@@ -247,24 +318,15 @@ public:
 struct InputHandler
 {
 private:
+    // the scene itself is changed by the simulation thread, see ApplySceneState()
     inline void DecreaseCircleRadius()
     {
-        float radius = circle.getRadius();
-        if (radius != 1.f)
-        {
-            radius -= 1.f;
-            circle.setRadius(radius);
-            texts.radius.value = static_cast<size_t>(radius);
-            circleOrLightMoved = true;
-        }
+        scene.Post(InputEvent::Type::ResizeCircle, { -1.f, 0.f });
     }
 
     inline void IncreaseCircleRadius()
     {
-        const float radius = circle.getRadius() + 1.f;
-        circle.setRadius(radius);
-        texts.radius.value = static_cast<size_t>(radius);
-        circleOrLightMoved = true;
+        scene.Post(InputEvent::Type::ResizeCircle, { 1.f, 0.f });
     }
 
     inline void UpdateFPSLimit()
@@ -300,6 +362,8 @@ private:
         const sf::FloatRect visibleArea(0, 0, static_cast<float>(event.size.width), static_cast<float>(event.size.height));
         window.setView(sf::View(visibleArea));
         texts.UpdateWindowSizeX(window.getSize().x);
+        ++occluderVersion; // cached rays are clipped to the old view
+        circleOrLightMoved = true; // and the sweep stops at its bottom
     }
 
     inline void ToggleRays(DisplayTexts::TextProperties<bool>& ray)
@@ -355,23 +419,58 @@ private:
                 {
                     UpdateTextColor();
                 }
+                else if (event.key.code == sf::Keyboard::M)
+                {
+                    ToggleRays(texts.simulation);
+                }
+                else if (event.key.code == sf::Keyboard::G)
+                {
+                    ToggleRays(texts.sdf);
+                }
+                else if (event.key.code == sf::Keyboard::L)
+                {
+                    ToggleRays(texts.lightMap);
+                }
+                else if (event.key.code == sf::Keyboard::T)
+                {
+                    exportTelemetry = true;
+                }
             }
         }
     }
 
+    // Takes over the newest state of the simulation thread
+    inline void ApplySceneState()
+    {
+        SceneState state;
+        if (!scene.Latest(state))
+            return;
+
+        const float circleRadius = circle.getRadius();
+        const sf::Vector2f circlePosition = circle.getPosition() + sf::Vector2f(circleRadius, circleRadius);
+        if (state.radius != circleRadius || state.circlePosition != circlePosition)
+        {
+            circle.setRadius(state.radius);
+            circle.setPosition(state.circlePosition - sf::Vector2f(state.radius, state.radius));
+            texts.radius.value = static_cast<size_t>(state.radius);
+            ++occluderVersion;
+        }
+        lightSource.SetPosition(state.lightPosition.x - lightSource.getRadius(), state.lightPosition.y - lightSource.getRadius());
+        circleOrLightMoved = true;
+        inputTimestamp = inputTimestamp == 0 ? state.inputTimestamp : std::min(inputTimestamp, state.inputTimestamp);
+    }
+
     inline void HandleFrameInput()
     {
         if (sf::Mouse::isButtonPressed(sf::Mouse::Left) && window.hasFocus())
         {
             const sf::Vector2i mousePos = sf::Mouse::getPosition(window);
-            circle.setPosition(static_cast<float>(mousePos.x) - circle.getRadius(), static_cast<float>(mousePos.y) - circle.getRadius());
-            circleOrLightMoved = true;
+            scene.Post(InputEvent::Type::MoveCircle, sf::Vector2f(static_cast<float>(mousePos.x), static_cast<float>(mousePos.y)));
         }
         if (sf::Mouse::isButtonPressed(sf::Mouse::Right) && window.hasFocus())
         {
             const sf::Vector2i mousePos = sf::Mouse::getPosition(window);
-            lightSource.SetPosition(static_cast<float>(mousePos.x) - lightSource.getRadius(), static_cast<float>(mousePos.y) - lightSource.getRadius());
-            circleOrLightMoved = true;
+            scene.Post(InputEvent::Type::MoveLight, sf::Vector2f(static_cast<float>(mousePos.x), static_cast<float>(mousePos.y)));
         }
         if (sf::Keyboard::isKeyPressed(sf::Keyboard::Up) && window.hasFocus())
         {
@@ -387,112 +486,141 @@ public:
     DisplayTexts& texts;
     sf::CircleShape& circle;
     LightSource& lightSource;
+    SceneThread& scene;
     bool circleOrLightMoved = true;
+    uint64_t occluderVersion = 0; // changes whenever cached visibility results can't be reused anymore
+    bool exportTelemetry = false;
+    int64_t inputTimestamp = 0; // oldest input that changed the scene since the last displayed frame, 0 if there was none
 
-    inline InputHandler(sf::RenderWindow& windowr, DisplayTexts& textsr, sf::CircleShape& circler, LightSource& lightSourcer)
-        : window(windowr), texts(textsr), circle(circler), lightSource(lightSourcer) {}
+    inline InputHandler(sf::RenderWindow& windowr, DisplayTexts& textsr, sf::CircleShape& circler, LightSource& lightSourcer, SceneThread& scener)
+        : window(windowr), texts(textsr), circle(circler), lightSource(lightSourcer), scene(scener) {}
 
     inline void HandleInput()
     {
         HandleEventInput();
         HandleFrameInput();
+        ApplySceneState();
     }
 };
 
 
-inline void SetProperValues(Ray& light, Ray& shadow, const sf::Vector2f& origin, const sf::Vector2f& direction, float t1, float t2);
-inline RayPair CalculateRays(const sf::Vector2f& origin, const sf::Vector2f& direction, float radius, const sf::Vector2f& circlePos);
-
-
-inline void SetProperValues(Ray& light, Ray& shadow, const sf::Vector2f& origin, const sf::Vector2f& direction, float t1, float t2)
+inline sf::FloatRect ViewRect(const sf::View& view)
 {
-    const sf::Vector2f point1 = origin + direction * t1;
-    const sf::Vector2f point2 = origin + direction * t2;
-
-    const sf::Vector2f vec1 = point1 - origin;
-    const sf::Vector2f vec2 = point2 - origin;
-
-    const float length1 = vec1.x * vec1.x + vec1.y * vec1.y;
-    const float length2 = vec2.x * vec2.x + vec2.y * vec2.y;
-
-    if (length1 < length2)
-    {
-        shadow.m_Origin = point2;
-        shadow.m_Intersection = shadow.m_Origin + direction * (t2 * sg_TScalar);
-        light.m_Intersection = point1;
-    }
-    else
-    {
-        shadow.m_Origin = point1;
-        shadow.m_Intersection = shadow.m_Origin + direction * (t1 * sg_TScalar);
-        light.m_Intersection = point2;
-    }
+    return sf::FloatRect(view.getCenter() - view.getSize() / 2.f, view.getSize());
 }
 
 
-inline RayPair CalculateRays(const sf::Vector2f& origin, const sf::Vector2f& direction, float radius, const sf::Vector2f& circlePos)
+int main(int argc, char** argv)
 {
-    RayPair rays(origin);
-
-    const float a = direction.x * direction.x + direction.y * direction.y;
-    const float b = 2.f * origin.x * direction.x - 2.f * direction.x * circlePos.x + 2.f * origin.y * direction.y - 2.f * direction.y * circlePos.y;
-    const float c = origin.x * origin.x - 2.f * origin.x * circlePos.x + circlePos.x * circlePos.x + origin.y * origin.y - 2.f * origin.y * circlePos.y + circlePos.y * circlePos.y - radius * radius;
-
-    float discriminant = b * b - 4.f * a * c;
-    if (discriminant < 0)
-        return rays;
-
-    const float denominator = 2.f * a;
-    if (discriminant > 0)
+    CommandLine commandLine;
+    if (!commandLine.Parse(argc, argv, std::cerr))
     {
-        discriminant = sqrtf(discriminant);
-        const float t1 = (-b + discriminant) / denominator;
-        const float t2 = (-b - discriminant) / denominator;
-        SetProperValues(rays.light, rays.shadow, origin, direction, t1, t2);
+        CommandLine::PrintUsage(std::cerr, argv[0]);
+        return 1;
     }
-    else // discriminant == 0
+
+    if (commandLine.worker)
     {
-        const float t = -b / denominator;
-        rays.light.m_Intersection = origin + direction * t;
-        rays.shadow.m_Origin = rays.light.m_Intersection;
-        rays.shadow.m_Intersection = rays.shadow.m_Origin + direction * (t * sg_TScalar); // arbitrary scalar
+        const size_t threads = commandLine.threads == 0 ? std::max<size_t>(std::thread::hardware_concurrency(), 1) : commandLine.threads;
+        FarmWorker worker(threads, sf::milliseconds(static_cast<sf::Int32>(commandLine.delay)));
+        return worker.Run(sf::IpAddress::LocalHost, static_cast<unsigned short>(commandLine.port), std::cerr);
     }
 
-    rays.light.m_Type = Ray::Type::Light;
-    rays.shadow.m_Type = Ray::Type::Shadow;
-    return rays;
-}
+    StreamServer streamServer;
+    if (commandLine.serve != 0 && !streamServer.Listen(static_cast<unsigned short>(commandLine.serve), std::cerr))
+        return 1;
 
+    if (commandLine.headless || commandLine.farm != 0)
+    {
+        Scene scene;
+        if (!commandLine.scene.empty() && !scene.LoadFromFile(commandLine.scene, std::cerr))
+            return 1;
+        if (commandLine.headless)
+        {
+            Telemetry telemetry(commandLine.frames); // the whole run
+            const int result = HeadlessRunner(scene, streamServer, telemetry, commandLine.cacheMemory * 1024 * 1024).Run(commandLine.frames, commandLine.expectZeroAllocations, std::cout);
+            if (!commandLine.telemetry.empty() && !telemetry.Export(commandLine.telemetry, std::cerr))
+                return 1;
+            return result;
+        }
+        return FarmCoordinator(scene).Run(argv[0], commandLine.farm, commandLine.threads, commandLine.delay, commandLine.frames, std::cout, std::cerr);
+    }
 
-int main()
-{
-    sf::RenderWindow window(sf::VideoMode(1000, 750), "Playing with rays");
+    // the tuning file is optional, without one the built in defaults are used
+    Tuning tuning;
+    std::string configPath = commandLine.config;
+    if (configPath.empty() && std::filesystem::exists("res/tuning.cfg"))
+        configPath = "res/tuning.cfg";
+    if (!configPath.empty() && !tuning.LoadFromFile(configPath, std::cerr))
+        return 1;
+    std::unique_ptr<FileWatcher> configWatcher;
+    if (!configPath.empty())
+        configWatcher = std::make_unique<FileWatcher>(configPath);
+    sg_TScalar = tuning.tScalar;
+    Ray::SetColors(tuning.lightColor, tuning.shadowColor);
+
+    sf::RenderWindow window(sf::VideoMode(tuning.windowSize.x, tuning.windowSize.y), "Playing with rays");
+    window.setBatchingEnabled(true); // the HUD texts and shapes are many small draws
 
     DisplayTexts texts(window.getSize().x, 0.f, 30.f, window);
     window.setFramerateLimit(texts.fpsLimit.value.first);
 
     LightSource lightSoure(20.f, 50);
-    lightSoure.setFillColor(sf::Color(255, 255, 102));
+    lightSoure.setFillColor(tuning.lightColor);
     lightSoure.SetPosition(0.f, 0.f);
 
     sf::CircleShape circle(100.f, 70);
     circle.setPosition((static_cast<float>(window.getSize().x) / 2.f) - circle.getRadius(), (static_cast<float>(window.getSize().y) / 2.f) - circle.getRadius());
-    circle.setFillColor(sf::Color::White);
+    circle.setFillColor(tuning.circleColor);
     texts.radius.value = static_cast<size_t>(circle.getRadius());
 
-    InputHandler ih(window, texts, circle, lightSoure);
-
-    constexpr float YDir = 0.f;
-    constexpr float XDir = 1000.f;
-    constexpr float XOff = 0.228f; // 0.225f
-    constexpr float YOff = 0.228f; // 0.225f
-
-    float YOffset = YOff;
-    float XOffset = XOff;
-    lightSoure.m_Direction = sf::Vector2f(XDir, YDir);
-    constexpr size_t numRays = 4450;
-    std::vector<Ray> rays;
-    rays.reserve(numRays * 2);
+    // input goes through a lock-free queue to the simulation thread which owns the scene and hands back every changed state
+    SceneState initialState;
+    initialState.circlePosition = circle.getPosition() + sf::Vector2f(circle.getRadius(), circle.getRadius());
+    initialState.radius = circle.getRadius();
+    initialState.lightPosition = lightSoure.m_Origin;
+    SceneThread sceneThread(initialState);
+    InputLatency inputLatency;
+
+    InputHandler ih(window, texts, circle, lightSoure, sceneThread);
+
+    CompactRayCache rayCache;
+    VisibilityCache visibilityCache(commandLine.cacheMemory * 1024 * 1024);
+
+    constexpr size_t simOccluders = 2000;
+    constexpr size_t simLights = 4;
+    constexpr size_t simRaysPerLight = 2048;
+    ThreadPool threadPool;
+    Simulation simulation(threadPool);
+    Benchmark benchmark;
+    std::vector<Ray> simRays;
+    sf::VertexArray bodyVertices(sf::Triangles);
+    float frameSeconds = 0.f;
+
+    constexpr size_t sdfRays = 4096;
+    SdfTracer sdfTracer;
+    SdfScene sdfScene = DemoSdfScene();
+    std::vector<sf::Uint8> sdfPixels;
+    sf::Texture sdfTexture;
+    sf::Sprite sdfSprite;
+    uint64_t sdfVersion = UINT64_MAX;
+
+    // per pixel lighting instead of rays, works with the static scene and the simulation
+    LightMap lightMap;
+    std::vector<LightMap::Light> lightMapLights;
+    sf::Texture lightMapTexture;
+    sf::Sprite lightMapSprite;
+    const auto renderLightMap = [&](const auto& occluders)
+    {
+        const Benchmark::ScopedStage stage(benchmark, Benchmark::Stage::Rasterise);
+        const sf::Vector2u size = window.getSize();
+        if (lightMapTexture.getSize() != size)
+        {
+            lightMapTexture.create(size.x, size.y);
+            lightMapSprite.setTexture(lightMapTexture, true);
+        }
+        lightMapTexture.update(lightMap.Render(lightMapLights, occluders, size, threadPool));
+    };
 
     const sf::Clock clock;
     sf::Time previousTime = clock.getElapsedTime();
@@ -501,107 +629,232 @@ int main()
     size_t lastLightRaysValue = 0;
     size_t lastShadowRaysValue = 0;
 
-    const sf::Color backgroundColor(105, 105, 105, 255);
+    Telemetry telemetry;
+    const std::string telemetryPath = commandLine.telemetry.empty() ? "telemetry.csv" : commandLine.telemetry;
+
+    // applies a changed tuning file, only the cached state that depends on a changed value is thrown away
+    const auto reloadTuning = [&]()
+    {
+        Tuning reloaded;
+        if (!reloaded.LoadFromFile(configPath, std::cerr))
+            return; // keep running with the last valid values
+
+        if (reloaded.step != tuning.step || reloaded.tScalar != tuning.tScalar)
+        {
+            // the cached rays were swept with the old values
+            sg_TScalar = reloaded.tScalar;
+            visibilityCache.Clear();
+            ih.circleOrLightMoved = true;
+        }
+        if (reloaded.rays != tuning.rays)
+            ih.circleOrLightMoved = true; // the ray count is part of the cache key, old entries stay valid
+
+        if (reloaded.lightColor != tuning.lightColor || reloaded.shadowColor != tuning.shadowColor || reloaded.circleColor != tuning.circleColor)
+        {
+            // rays get their color when they are drawn, only the light map bakes it in
+            Ray::SetColors(reloaded.lightColor, reloaded.shadowColor);
+            lightSoure.setFillColor(reloaded.lightColor);
+            circle.setFillColor(reloaded.circleColor);
+            if (texts.lightMap.value)
+                ih.circleOrLightMoved = true;
+        }
+
+        if (reloaded.windowSize != tuning.windowSize)
+            window.setSize(reloaded.windowSize); // handled like a resize by the user
+        tuning = reloaded;
+    };
 
     while (window.isOpen())
     {
+        if (configWatcher && configWatcher->Poll())
+            reloadTuning();
         ih.HandleInput();
+        size_t frameRays = 0; // rays calculated this frame
 
-        window.clear(backgroundColor);
-        window.draw(lightSoure);
-        window.draw(circle);
+        window.clear(tuning.backgroundColor);
+        if (!texts.simulation.value && !(texts.lightMap.value && !texts.sdf.value))
+        {
+            window.draw(lightSoure);
+            if (!texts.sdf.value)
+                window.draw(circle);
+        }
 
-        if ((texts.light.value || texts.shadow.value) && ih.circleOrLightMoved)
+        if (texts.simulation.value)
         {
-            ih.circleOrLightMoved = false;
-            rays.clear();
-            const sf::Vector2f circleRealPosition = circle.getPosition();
-            const sf::Vector2f circlePosition(circleRealPosition.x + static_cast<float>(texts.radius.value), circleRealPosition.y + static_cast<float>(texts.radius.value));
+            const sf::Vector2f bounds(static_cast<float>(window.getSize().x), static_cast<float>(window.getSize().y));
+            if (simulation.occluders.empty())
+                simulation.Spawn(simOccluders, simLights, bounds);
+            simulation.SetBounds(bounds);
 
-            lightSoure.m_Direction.x = XDir;
-            lightSoure.m_Direction.y = YDir;
-            YOffset = YOff;
-            XOffset = XOff;
+            const sf::Clock stepClock;
+            if (texts.lightMap.value)
+            {
+                simulation.Advance(frameSeconds, benchmark);
+                lightMapLights.clear();
+                for (const Body& light : simulation.lights)
+                    lightMapLights.push_back({ light.position, Ray::LightColor() });
+                renderLightMap(simulation.occluders);
+                texts.stepTime.value = static_cast<size_t>(stepClock.getElapsedTime().asMicroseconds());
+                lastLightRaysValue = lastShadowRaysValue = 0;
+                ih.circleOrLightMoved = true; // rays have to be traced again when switching back
+            }
+            else if (simulation.Advance(frameSeconds, benchmark) != 0 || ih.circleOrLightMoved)
+            {
+                ih.circleOrLightMoved = false;
+                const size_t hits = texts.shadow.value
+                    ? simulation.Trace<float, RayQuery::EntryExit>(simRaysPerLight, simRays, benchmark)
+                    : simulation.Trace<float, RayQuery::NearestHit>(simRaysPerLight, simRays, benchmark);
+                lastLightRaysValue = hits;
+                lastShadowRaysValue = texts.shadow.value ? hits : 0;
+                rayCache.Assign(simRays, ViewRect(window.getView()));
+                frameRays = simRays.size();
+                texts.stepTime.value = static_cast<size_t>(stepClock.getElapsedTime().asMicroseconds());
+            }
 
-            bool foundInArea = false;
-            for (size_t j = 0; j < 2; ++j)
             {
-                bool found = false;
-                size_t foundIndex = 0;
-                for (size_t i = 0; i < numRays; ++i)
-                {
-                    if ((lightSoure.m_Direction.x < 0.f && lightSoure.m_Direction.y > 750.f)
-                        || (lightSoure.m_Direction.x < 0.f && lightSoure.m_Direction.y < 0.f))
-                        break;
+                const Benchmark::ScopedStage stage(benchmark, Benchmark::Stage::Draw);
+                texts.lightRays.value = texts.light.value ? lastLightRaysValue : 0;
+                texts.shadowRays.value = texts.shadow.value ? lastShadowRaysValue : 0;
+                if (texts.lightMap.value)
+                    window.draw(lightMapSprite);
+                else
+                    rayCache.Draw(window, texts.light.value, texts.shadow.value);
+                bodyVertices.clear();
+                simulation.AppendBodies(bodyVertices);
+                window.draw(bodyVertices);
+            }
+            benchmark.EndFrame(frameSeconds, simRays.size());
+        }
+        else if (texts.sdf.value)
+        {
+            if (ih.circleOrLightMoved)
+            {
+                ih.circleOrLightMoved = false;
+                const float radius = static_cast<float>(texts.radius.value);
+                sdfScene.primitives.back().a = circle.getPosition() + sf::Vector2f(radius, radius);
+                sdfScene.primitives.back().radius = radius;
 
-                    RayPair lines = CalculateRays(lightSoure.m_Origin, lightSoure.m_Direction, static_cast<float>(texts.radius.value), circlePosition);
-                    if (lines.light.m_Type == Ray::Type::Light) // is only true if ray hits the circle
-                    {
-                        if (!found)
-                            foundIndex = i;
-                        found = true;
-
-                        rays.emplace_back(lines.light);
-                        rays.emplace_back(lines.shadow);
-                        if (texts.light.value)
-                        {
-                            lines.light.Draw(window);
-                            ++texts.lightRays.value;
-                        }
-                        if (texts.shadow.value)
-                        {
-                            lines.shadow.Draw(window);
-                            ++texts.shadowRays.value;
-                        }
-                    }
-                    else if (found)
+                if (sdfVersion != ih.occluderVersion)
+                {
+                    const Benchmark::ScopedStage stage(benchmark, Benchmark::Stage::Rasterise);
+                    sdfVersion = ih.occluderVersion;
+                    const sf::Vector2u size = window.getSize();
+                    if (sdfTexture.getSize() != size)
                     {
-                        if (foundIndex != 0)
-                            foundInArea = true;
-                        break;
+                        sdfTexture.create(size.x, size.y);
+                        sdfSprite.setTexture(sdfTexture, true);
                     }
-
-                    lightSoure.m_Direction.y += YOffset;
-                    lightSoure.m_Direction.x -= XOffset;
+                    sdfScene.Rasterise(sdfPixels, size, sf::Color::White, threadPool);
+                    sdfTexture.update(sdfPixels.data());
                 }
-                if (foundInArea)
-                    break;
 
-                lightSoure.m_Direction.x = XDir;
-                lightSoure.m_Direction.y = YDir;
-                YOffset = YOff * -1;
-                XOffset = XOff;
+                const Benchmark::ScopedStage stage(benchmark, Benchmark::Stage::Trace);
+                const size_t hits = sdfTracer.Trace(sdfScene, lightSoure.m_Origin, sdfRays, texts.shadow.value, threadPool, simRays);
+                lastLightRaysValue = hits;
+                lastShadowRaysValue = texts.shadow.value ? hits : 0;
+                rayCache.Assign(simRays, ViewRect(window.getView()));
+                frameRays = simRays.size();
+            }
+
+            const Benchmark::ScopedStage stage(benchmark, Benchmark::Stage::Draw);
+            texts.lightRays.value = texts.light.value ? lastLightRaysValue : 0;
+            texts.shadowRays.value = texts.shadow.value ? lastShadowRaysValue : 0;
+            window.draw(sdfSprite);
+            rayCache.Draw(window, texts.light.value, texts.shadow.value);
+        }
+        else if (texts.lightMap.value)
+        {
+            if (ih.circleOrLightMoved || lightMapTexture.getSize() != window.getSize())
+            {
+                ih.circleOrLightMoved = false;
+                const float radius = static_cast<float>(texts.radius.value);
+                lightMapLights.assign(1, { lightSoure.m_Origin, Ray::LightColor() });
+                const std::array<Body, 1> occluders = { Body{ circle.getPosition() + sf::Vector2f(radius, radius), {}, radius } };
+                renderLightMap(occluders);
             }
 
+            const Benchmark::ScopedStage stage(benchmark, Benchmark::Stage::Draw);
+            texts.lightRays.value = 0;
+            texts.shadowRays.value = 0;
+            lastLightRaysValue = lastShadowRaysValue = 0;
+            window.draw(lightMapSprite);
+            window.draw(lightSoure);
+            window.draw(circle);
+        }
+        else if ((texts.light.value || texts.shadow.value) && ih.circleOrLightMoved)
+        {
+            ih.circleOrLightMoved = false;
+            const float radius = static_cast<float>(texts.radius.value);
+            const sf::Vector2f circlePosition = circle.getPosition() + sf::Vector2f(radius, radius);
+            const size_t misses = visibilityCache.Misses();
+            size_t cachedLightRays = 0;
+            size_t cachedShadowRays = 0;
+            {
+                const Benchmark::ScopedStage stage(benchmark, Benchmark::Stage::Trace);
+                std::tie(cachedLightRays, cachedShadowRays) = TraceStaticScene(visibilityCache, rayCache, lightSoure.m_Origin, circlePosition, radius,
+                    ih.occluderVersion, tuning.rays, tuning.step, texts.shadow.value, ViewRect(window.getView()));
+            }
+            if (visibilityCache.Misses() != misses)
+                frameRays = cachedLightRays + cachedShadowRays;
+            texts.lightRays.value = texts.light.value ? cachedLightRays : 0;
+            texts.shadowRays.value = texts.shadow.value ? cachedShadowRays : 0;
+            texts.cacheHitRate.value = visibilityCache.HitRate();
+
+            const Benchmark::ScopedStage stage(benchmark, Benchmark::Stage::Draw);
+            rayCache.Draw(window, texts.light.value, texts.shadow.value);
             lastLightRaysValue = texts.lightRays.value;
             lastShadowRaysValue = texts.shadowRays.value;
         }
         else
         {
-            for (const Ray& ray : rays)
-            {
-                if (ray.m_Type == Ray::Type::Light && texts.light.value)
-                {
-                    ray.Draw(window);
-                    texts.lightRays.value = lastLightRaysValue;
-                }
-                else if (ray.m_Type == Ray::Type::Shadow && texts.shadow.value)
-                {
-                    ray.Draw(window);
-                    texts.shadowRays.value = lastShadowRaysValue;
-                }
-            }
+            if (texts.light.value)
+                texts.lightRays.value = lastLightRaysValue;
+            if (texts.shadow.value)
+                texts.shadowRays.value = lastShadowRaysValue;
+            const Benchmark::ScopedStage stage(benchmark, Benchmark::Stage::Draw);
+            rayCache.Draw(window, texts.light.value, texts.shadow.value);
+        }
+
+        if (texts.simulation.value)
+            streamServer.Publish(simulation.occluders, simulation.lights, rayCache.Rays());
+        else
+        {
+            const float radius = static_cast<float>(texts.radius.value);
+            streamServer.Publish(std::array<Body, 1>{ Body{ circle.getPosition() + sf::Vector2f(radius, radius), {}, radius } },
+                std::array<Body, 1>{ Body{ lightSoure.m_Origin, {}, lightSoure.getRadius() } }, rayCache.Rays());
         }
 
         texts.Update();
         texts.DrawTexts();
         window.display();
+        texts.drawCalls.value = static_cast<size_t>(window.getStatistics().drawCalls); // shown next frame
+        window.resetStatistics();
+        if (ih.inputTimestamp != 0)
+        {
+            texts.inputLatency.value = static_cast<size_t>(inputLatency.Record(ih.inputTimestamp));
+            ih.inputTimestamp = 0;
+        }
 
         currentTime = clock.getElapsedTime();
-        texts.fps.value = static_cast<size_t>(1.f / (currentTime.asSeconds() - previousTime.asSeconds()));
+        frameSeconds = currentTime.asSeconds() - previousTime.asSeconds();
+        texts.fps.value = static_cast<size_t>(1.f / frameSeconds);
         previousTime = currentTime;
         texts.UpdateText(texts.fps);
+
+        telemetry.EndFrame(benchmark, frameSeconds, frameRays, texts.lightRays.value, texts.shadowRays.value);
+        if (ih.exportTelemetry)
+        {
+            ih.exportTelemetry = false;
+            if (telemetry.Export(telemetryPath, std::cerr))
+                std::cout << "Telemetry of the last " << telemetry.Size() << " frames written to " << telemetryPath << '\n';
+        }
     }
 
+    if (!commandLine.telemetry.empty() && !telemetry.Export(commandLine.telemetry, std::cerr))
+        return 1;
+
+    benchmark.Print(std::cout);
+    inputLatency.Print(std::cout);
+    streamServer.Print(std::cout);
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,96 @@
+project "Viewer"
+    language "C++"
+    cppdialect "C++17"
+    staticruntime "on"
+
+    defines "SFML_STATIC"
+
+    filter "toolset:msc*"
+        warnings "Extra"
+        externalwarnings "Default"
+
+    filter { "toolset:gcc* or toolset:clang*" }
+        warnings "Extra"
+        externalwarnings "Off"
+        enablewarnings {
+            "pedantic",
+            "old-style-cast",
+            "shadow",
+            "sign-conversion",
+            "conversion"
+        }
+
+    filter "toolset:gcc*"
+        linkgroups "on"
+    filter {}
+
+    files {
+        "**.cpp",
+        "**.h"
+    }
+
+    -- the stream protocol and the ray cache are shared with the app
+    includedirs {
+        SfmlDir .. "/include",
+        "../Rays/src"
+    }
+
+    externalincludedirs {
+        SfmlDir .. "/include"
+    }
+
+    filter "system:windows"
+        links {
+            "winmm",
+            "flac",
+            "freetype",
+            "ogg",
+            "openal32",
+            "opengl32",
+            "vorbis",
+            "vorbisenc",
+            "vorbisfile",
+            "gdi32",
+            "SFML",
+            "user32",
+            "advapi32",
+            "psapi",
+            "ws2_32"
+        }
+
+    filter { "system:windows", "platforms:x64" }
+        libdirs {
+            SfmlDir .. "/extlibs/libs-msvc-universal/x64"
+        }
+
+    filter { "system:windows", "platforms:x86" }
+        libdirs {
+            SfmlDir .. "/extlibs/libs-msvc-universal/x86"
+        }
+
+    -- system packages: libx11 libxrandr libudev libgl freetype openal flac vorbis
+    filter "system:linux"
+        links {
+            "SFML",
+            "X11",
+            "Xrandr",
+            "udev",
+            "GL",
+            "freetype",
+            "openal",
+            "FLAC",
+            "vorbisenc",
+            "vorbisfile",
+            "vorbis",
+            "ogg",
+            "pthread",
+            "dl"
+        }
+
+    filter { "configurations:Debug" }
+        kind "ConsoleApp"
+        floatingpoint "default"
+
+    filter { "configurations:Release" }
+        kind "WindowedApp"
+        floatingpoint "fast"
@@ -0,0 +1,214 @@
+#include <cmath>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <string>
+
+#include "SFML/Graphics.hpp"
+#include "SFML/Network.hpp"
+
+#include "RayCache.h"
+#include "Stream.h"
+
+// Receives the snapshots of the stream server (Rays --serve <port>) and acknowledges
+// every one it could decode, those become the base of the following deltas
+struct StreamClient
+{
+private:
+    static inline constexpr size_t s_History = 32;
+
+    sf::TcpSocket m_Socket;
+    std::deque<StreamState> m_States; // back is the newest state
+    size_t m_Bytes = 0;
+    size_t m_Snapshots = 0;
+    size_t m_Keyframes = 0;
+private:
+    inline const StreamState* FindState(sf::Uint32 sequence) const
+    {
+        for (const StreamState& state : m_States)
+            if (state.sequence == sequence)
+                return &state;
+        return nullptr;
+    }
+
+    inline bool Acknowledge(sf::Uint32 sequence)
+    {
+        m_Socket.setBlocking(true); // acks are tiny, don't bother with partial sends
+        sf::Packet ack;
+        ack << static_cast<sf::Uint8>(StreamMessage::Ack) << sequence;
+        const bool sent = m_Socket.send(ack) == sf::Socket::Done;
+        m_Socket.setBlocking(false);
+        return sent;
+    }
+
+    inline bool Handle(sf::Packet& packet)
+    {
+        sf::Uint8 type = 0;
+        sf::Uint32 sequence = 0, baseSequence = 0;
+        if (!(packet >> type >> sequence >> baseSequence) || type != static_cast<sf::Uint8>(StreamMessage::Snapshot))
+            return false;
+
+        const StreamState* base = nullptr;
+        if (baseSequence != sg_StreamNoBase)
+        {
+            base = FindState(baseSequence);
+            if (base == nullptr) // doesn't happen unless the server is far behind, a keyframe fixes it
+                return Acknowledge(sg_StreamNoBase);
+        }
+
+        StreamState state;
+        state.sequence = sequence;
+        if (!state.Decode(packet, base))
+            return false;
+
+        m_Bytes += packet.getDataSize();
+        ++m_Snapshots;
+        m_Keyframes += base == nullptr;
+        m_States.push_back(std::move(state));
+        if (m_States.size() > s_History)
+            m_States.pop_front();
+        return Acknowledge(sequence);
+    }
+public:
+    inline bool Connect(const sf::IpAddress& host, unsigned short port)
+    {
+        if (m_Socket.connect(host, port, sf::seconds(5.f)) != sf::Socket::Done)
+            return false;
+        m_Socket.setBlocking(false);
+        return true;
+    }
+
+    // Handles everything that arrived, returns false once the server is gone or sent garbage
+    inline bool Poll()
+    {
+        while (true)
+        {
+            sf::Packet packet;
+            const sf::Socket::Status status = m_Socket.receive(packet);
+            if (status == sf::Socket::NotReady || status == sf::Socket::Partial)
+                return true;
+            if (status != sf::Socket::Done || !Handle(packet))
+                return false;
+        }
+    }
+
+    inline const StreamState* Latest() const { return m_States.empty() ? nullptr : &m_States.back(); }
+    inline size_t Bytes() const { return m_Bytes; }
+    inline size_t Snapshots() const { return m_Snapshots; }
+    inline size_t Keyframes() const { return m_Keyframes; }
+};
+
+
+inline void AppendCircle(sf::VertexArray& vertices, const StreamBody& body, const sf::Color& color)
+{
+    constexpr size_t segments = 12;
+    constexpr float step = 6.28318530718f / static_cast<float>(segments);
+    const sf::Vector2f center = body.Position();
+    const float radius = body.Radius();
+    sf::Vector2f previous(center.x + radius, center.y);
+    for (size_t i = 1; i <= segments; ++i)
+    {
+        const float angle = step * static_cast<float>(i);
+        const sf::Vector2f current(center.x + radius * std::cos(angle), center.y + radius * std::sin(angle));
+        vertices.append(sf::Vertex(center, color));
+        vertices.append(sf::Vertex(previous, color));
+        vertices.append(sf::Vertex(current, color));
+        previous = current;
+    }
+}
+
+
+// The whole string has to be the number, checked like the ports of the Rays command line
+inline bool ParsePort(const char* str, unsigned short& port)
+{
+    try
+    {
+        size_t end = 0;
+        const unsigned long long parsed = std::stoull(str, &end);
+        if (str[end] != '\0' || str[0] == '-' || parsed == 0 || parsed > 65535)
+            return false;
+        port = static_cast<unsigned short>(parsed);
+        return true;
+    }
+    catch (const std::exception&)
+    {
+        return false;
+    }
+}
+
+
+// Viewer [host] [port]
+int main(int argc, char** argv)
+{
+    unsigned short port = 53000;
+    if (argc > 3 || (argc > 2 && !ParsePort(argv[2], port)))
+    {
+        std::cerr << "Usage: " << argv[0] << " [host] [port]\n"
+                  << "  host   address of the Rays app (default localhost)\n"
+                  << "  port   port it serves the stream on, 1-65535 (default 53000)\n";
+        return 1;
+    }
+    const sf::IpAddress host = argc > 1 ? sf::IpAddress(argv[1]) : sf::IpAddress::LocalHost;
+
+    StreamClient client;
+    if (!client.Connect(host, port))
+    {
+        std::cerr << "Failed to connect to " << host << ':' << port << " (start the app with --serve " << port << ")\n";
+        return 1;
+    }
+
+    sf::RenderWindow window(sf::VideoMode(1000, 750), "Rays viewer");
+    window.setFramerateLimit(60);
+
+    CompactRayCache rayCache;
+    sf::VertexArray bodies(sf::Triangles);
+    const sf::Color backgroundColor(105, 105, 105, 255);
+    sf::Clock titleClock;
+    size_t lastBytes = 0;
+    size_t lastSnapshots = 0;
+
+    while (window.isOpen())
+    {
+        sf::Event event;
+        while (window.pollEvent(event))
+        {
+            if (event.type == sf::Event::Closed)
+                window.close();
+            else if (event.type == sf::Event::Resized)
+                window.setView(sf::View(sf::FloatRect(0, 0, static_cast<float>(event.size.width), static_cast<float>(event.size.height))));
+        }
+
+        if (!client.Poll())
+        {
+            std::cerr << "Connection to the server was lost\n";
+            break;
+        }
+
+        window.clear(backgroundColor);
+        if (const StreamState* state = client.Latest())
+        {
+            rayCache.Restore(state->rays);
+            rayCache.Draw(window, true, true);
+
+            bodies.clear();
+            for (const StreamBody& body : state->bodies)
+                AppendCircle(bodies, body, sf::Color::White);
+            for (const StreamBody& light : state->lights)
+                AppendCircle(bodies, light, Ray::LightColor());
+            window.draw(bodies);
+        }
+        window.display();
+
+        if (titleClock.getElapsedTime() >= sf::seconds(1.f))
+        {
+            const float seconds = titleClock.restart().asSeconds();
+            const std::string snapshots = std::to_string(static_cast<size_t>(static_cast<float>(client.Snapshots() - lastSnapshots) / seconds));
+            const std::string kib = std::to_string(static_cast<size_t>(static_cast<float>(client.Bytes() - lastBytes) / seconds / 1024.f));
+            window.setTitle("Rays viewer - " + snapshots + " snapshots/s, " + kib + " KiB/s, keyframes: " + std::to_string(client.Keyframes()));
+            lastBytes = client.Bytes();
+            lastSnapshots = client.Snapshots();
+        }
+    }
+    return 0;
+}
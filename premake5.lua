@@ -44,4 +44,5 @@ staticruntime "on"
 removeunreferencedcodedata "on"
 
 include "Rays"
+include "Viewer"
 include "Dependencies/SFML"
\ No newline at end of file